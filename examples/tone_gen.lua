@@ -26,13 +26,14 @@ buf:write("data", 37)
 buf:writeUInt32LE(data_size, 41)
 
 -- Write samples
+local pcm = {}
 for i = 0, samples - 1 do
   local t = i / sample_rate
-  local s = math.floor(math.sin(2 * math.pi * freq * t) * 32767)
-  buf:writeInt16LE(s, 45 + i * 2)
+  pcm[i + 1] = math.floor(math.sin(2 * math.pi * freq * t) * 32767)
 end
+buf:writeInt16LEArray(pcm, 45)
 
 local f = assert(io.open("tone.wav", "wb"))
-f:write(buf:tostring())
+buf:writeTo(f)
 f:close()
 print("Generated tone.wav")
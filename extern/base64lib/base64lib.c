@@ -0,0 +1,510 @@
+#include "base64lib.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64LIB_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BASE64LIB_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define B64_INVALID 0x80
+#define B64_SPACE 0x81
+#define B64_PAD 0x82
+
+static const char B64_STD[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char B64_URL[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Sextet value of each character (both alphabets), or one of the B64_* codes.
+static const uint8_t B64_VALUES[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x81, 0x81, 0x81,
+    0x81, 0x81, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x81, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3e, 0x80, 0x3e, 0x80, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x80, 0x80,
+    0x80, 0x82, 0x80, 0x80, 0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+    0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x3f,
+    0x80, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24,
+    0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+    0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80,
+};
+
+size_t base64_encoded_len(size_t len, bool url) {
+  if (url) return len / 3 * 4 + (len % 3 ? len % 3 + 1 : 0);
+  return (len + 2) / 3 * 4;
+}
+
+size_t base64_decoded_maxlen(size_t len) { return (len + 3) / 4 * 3; }
+
+static void encode_scalar(char* out, const uint8_t* data, size_t len,
+                          bool url) {
+  const char* alphabet = url ? B64_URL : B64_STD;
+  size_t i = 0;
+
+  for (; i + 3 <= len; i += 3) {
+    uint32_t v = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 |
+                 data[i + 2];
+    *out++ = alphabet[v >> 18];
+    *out++ = alphabet[(v >> 12) & 0x3f];
+    *out++ = alphabet[(v >> 6) & 0x3f];
+    *out++ = alphabet[v & 0x3f];
+  }
+
+  if (len - i == 1) {
+    uint32_t v = (uint32_t)data[i] << 16;
+    *out++ = alphabet[v >> 18];
+    *out++ = alphabet[(v >> 12) & 0x3f];
+    if (!url) {
+      *out++ = '=';
+      *out++ = '=';
+    }
+  } else if (len - i == 2) {
+    uint32_t v = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8;
+    *out++ = alphabet[v >> 18];
+    *out++ = alphabet[(v >> 12) & 0x3f];
+    *out++ = alphabet[(v >> 6) & 0x3f];
+    if (!url) *out++ = '=';
+  }
+}
+
+// Emits whatever the pending 2 or 3 sextets of a short final group hold.
+static bool flush_partial(base64_state* state, uint8_t* out, size_t* o) {
+  switch (state->count) {
+    case 0:
+      break;
+    case 2:
+      out[(*o)++] = (uint8_t)(state->bits >> 4);
+      break;
+    case 3:
+      out[(*o)++] = (uint8_t)(state->bits >> 10);
+      out[(*o)++] = (uint8_t)(state->bits >> 2);
+      break;
+    default:
+      return false;
+  }
+
+  state->bits = 0;
+  state->count = 0;
+  return true;
+}
+
+static bool decode_char(base64_state* state, uint8_t* out, size_t* o,
+                        unsigned char c) {
+  uint8_t v = B64_VALUES[c];
+
+  if (v < 64) {
+    if (state->padded) return false;
+    state->bits = state->bits << 6 | v;
+    if (++state->count == 4) {
+      out[(*o)++] = (uint8_t)(state->bits >> 16);
+      out[(*o)++] = (uint8_t)(state->bits >> 8);
+      out[(*o)++] = (uint8_t)state->bits;
+      state->bits = 0;
+      state->count = 0;
+    }
+    return true;
+  }
+
+  if (v == B64_SPACE) return true;
+
+  if (v == B64_PAD) {
+    if (state->padded) return true;
+    if (state->count < 2) return false;
+    state->padded = true;
+    return flush_partial(state, out, o);
+  }
+
+  return false;
+}
+
+// Vector kernels: whole blocks of alphabet characters with no whitespace or
+// padding. Each returns the characters it consumed (a multiple of its block),
+// leaving at least one block of slack so the wide stores stay in bounds.
+typedef size_t (*decode_blocks_fn)(uint8_t*, const char*, size_t);
+typedef size_t (*encode_blocks_fn)(char*, const uint8_t*, size_t, bool);
+
+#if BASE64LIB_X86
+
+__attribute__((target("ssse3"))) static inline __m128i encode_ascii_ssse3(
+    __m128i indices, bool url) {
+  const __m128i shift_lut = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, url ? '-' - 62 : '+' - 62,
+      url ? '_' - 63 : '/' - 63, 'A', 0, 0);
+  // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+  __m128i sel = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  sel = _mm_or_si128(sel, _mm_and_si128(less, _mm_set1_epi8(13)));
+  return _mm_add_epi8(indices, _mm_shuffle_epi8(shift_lut, sel));
+}
+
+// Spreads 12 input bytes into 16 sextets, one per byte.
+__attribute__((target("ssse3"))) static inline __m128i encode_split_ssse3(
+    __m128i in) {
+  in = _mm_shuffle_epi8(
+      in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3"))) static size_t encode_blocks_ssse3(
+    char* out, const uint8_t* data, size_t len, bool url) {
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 12) {
+    __m128i in = _mm_loadu_si128((const __m128i*)(data + i));
+    __m128i chars = encode_ascii_ssse3(encode_split_ssse3(in), url);
+    _mm_storeu_si128((__m128i*)(out + i / 3 * 4), chars);
+  }
+
+  return i;
+}
+
+__attribute__((target("avx2"))) static inline __m256i encode_ascii_avx2(
+    __m256i indices, bool url) {
+  const __m256i shift_lut = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, url ? '-' - 62 : '+' - 62,
+      url ? '_' - 63 : '/' - 63, 'A', 0, 0, 'a' - 26, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, url ? '-' - 62 : '+' - 62, url ? '_' - 63 : '/' - 63, 'A', 0,
+      0);
+  __m256i sel = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+  __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+  sel = _mm256_or_si256(sel, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+  return _mm256_add_epi8(indices, _mm256_shuffle_epi8(shift_lut, sel));
+}
+
+__attribute__((target("avx2"))) static size_t encode_blocks_avx2(
+    char* out, const uint8_t* data, size_t len, bool url) {
+  const __m256i split = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,  //
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  size_t i = 0;
+
+  for (; i + 28 <= len; i += 24) {
+    // 12 input bytes per 128-bit lane
+    __m256i in = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(data + i))),
+        _mm_loadu_si128((const __m128i*)(data + i + 12)), 1);
+    in = _mm256_shuffle_epi8(in, split);
+    __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i chars = encode_ascii_avx2(_mm256_or_si256(t1, t3), url);
+    _mm256_storeu_si256((__m256i*)(out + i / 3 * 4), chars);
+  }
+
+  return i + encode_blocks_ssse3(out + i / 3 * 4, data + i, len - i, url);
+}
+
+// Maps 16 characters to sextets; `ok` gets 0xff for every alphabet character.
+__attribute__((target("ssse3"))) static inline __m128i decode_sextets_ssse3(
+    __m128i c, __m128i* ok) {
+#define IN_RANGE(v, n) _mm_cmpeq_epi8(_mm_min_epu8((v), _mm_set1_epi8(n)), (v))
+  __m128i up = _mm_sub_epi8(c, _mm_set1_epi8('A'));
+  __m128i lo = _mm_sub_epi8(c, _mm_set1_epi8('a'));
+  __m128i dg = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  __m128i is_up = IN_RANGE(up, 25);
+  __m128i is_lo = IN_RANGE(lo, 25);
+  __m128i is_dg = IN_RANGE(dg, 9);
+  __m128i is_62 = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('+')),
+                               _mm_cmpeq_epi8(c, _mm_set1_epi8('-')));
+  __m128i is_63 = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('/')),
+                               _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+#undef IN_RANGE
+
+  *ok = _mm_or_si128(_mm_or_si128(is_up, is_lo),
+                     _mm_or_si128(is_dg, _mm_or_si128(is_62, is_63)));
+
+  __m128i v = _mm_and_si128(is_up, up);
+  v = _mm_or_si128(v, _mm_and_si128(is_lo, _mm_add_epi8(lo, _mm_set1_epi8(26))));
+  v = _mm_or_si128(v, _mm_and_si128(is_dg, _mm_add_epi8(dg, _mm_set1_epi8(52))));
+  v = _mm_or_si128(v, _mm_and_si128(is_62, _mm_set1_epi8(62)));
+  v = _mm_or_si128(v, _mm_and_si128(is_63, _mm_set1_epi8(63)));
+  return v;
+}
+
+// Packs 4 sextets per 32-bit group into 3 bytes at the bottom of each lane.
+__attribute__((target("ssse3"))) static inline __m128i decode_pack_ssse3(
+    __m128i v) {
+  __m128i ab_cd = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+  __m128i abcd = _mm_madd_epi16(ab_cd, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(abcd, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+                                              13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("ssse3"))) static size_t decode_blocks_ssse3(
+    uint8_t* out, const char* data, size_t len) {
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 16) {
+    __m128i ok;
+    __m128i v =
+        decode_sextets_ssse3(_mm_loadu_si128((const __m128i*)(data + i)), &ok);
+    if (_mm_movemask_epi8(ok) != 0xffff) break;
+    _mm_storeu_si128((__m128i*)(out + i / 4 * 3), decode_pack_ssse3(v));
+  }
+
+  return i;
+}
+
+__attribute__((target("avx2"))) static size_t decode_blocks_avx2(
+    uint8_t* out, const char* data, size_t len) {
+#define IN_RANGE(v, n) \
+  _mm256_cmpeq_epi8(_mm256_min_epu8((v), _mm256_set1_epi8(n)), (v))
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,  //
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 32) {
+    __m256i c = _mm256_loadu_si256((const __m256i*)(data + i));
+    __m256i up = _mm256_sub_epi8(c, _mm256_set1_epi8('A'));
+    __m256i lo = _mm256_sub_epi8(c, _mm256_set1_epi8('a'));
+    __m256i dg = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i is_up = IN_RANGE(up, 25);
+    __m256i is_lo = IN_RANGE(lo, 25);
+    __m256i is_dg = IN_RANGE(dg, 9);
+    __m256i is_62 =
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('+')),
+                        _mm256_cmpeq_epi8(c, _mm256_set1_epi8('-')));
+    __m256i is_63 =
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('/')),
+                        _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+
+    __m256i ok = _mm256_or_si256(_mm256_or_si256(is_up, is_lo),
+                                 _mm256_or_si256(is_dg,
+                                                 _mm256_or_si256(is_62, is_63)));
+    if (_mm256_movemask_epi8(ok) != -1) break;
+
+    __m256i v = _mm256_and_si256(is_up, up);
+    v = _mm256_or_si256(
+        v, _mm256_and_si256(is_lo, _mm256_add_epi8(lo, _mm256_set1_epi8(26))));
+    v = _mm256_or_si256(
+        v, _mm256_and_si256(is_dg, _mm256_add_epi8(dg, _mm256_set1_epi8(52))));
+    v = _mm256_or_si256(v, _mm256_and_si256(is_62, _mm256_set1_epi8(62)));
+    v = _mm256_or_si256(v, _mm256_and_si256(is_63, _mm256_set1_epi8(63)));
+
+    __m256i ab_cd = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    __m256i abcd = _mm256_madd_epi16(ab_cd, _mm256_set1_epi32(0x00011000));
+    __m256i bytes = _mm256_shuffle_epi8(abcd, pack);
+    _mm256_storeu_si256((__m256i*)(out + i / 4 * 3),
+                        _mm256_permutevar8x32_epi32(bytes, gather));
+  }
+#undef IN_RANGE
+
+  if (i + 64 <= len) return i;  // stopped on a block that needs the slow path
+  return i + decode_blocks_ssse3(out + i / 4 * 3, data + i, len - i);
+}
+
+static encode_blocks_fn encode_blocks;
+static decode_blocks_fn decode_blocks;
+static bool selected;
+
+static void base64_select(void) {
+  __builtin_cpu_init();
+  selected = true;
+  if (__builtin_cpu_supports("avx2")) {
+    encode_blocks = encode_blocks_avx2;
+    decode_blocks = decode_blocks_avx2;
+  } else if (__builtin_cpu_supports("ssse3")) {
+    encode_blocks = encode_blocks_ssse3;
+    decode_blocks = decode_blocks_ssse3;
+  }
+}
+
+static size_t encode_fast(char* out, const uint8_t* data, size_t len,
+                          bool url) {
+  if (!selected) base64_select();
+  return encode_blocks ? encode_blocks(out, data, len, url) : 0;
+}
+
+static size_t decode_fast(uint8_t* out, const char* data, size_t len) {
+  if (!selected) base64_select();
+  return decode_blocks ? decode_blocks(out, data, len) : 0;
+}
+
+#elif BASE64LIB_NEON
+
+static size_t encode_fast(char* out, const uint8_t* data, size_t len,
+                          bool url) {
+  const uint8_t* alphabet = (const uint8_t*)(url ? B64_URL : B64_STD);
+  const uint8x16x4_t lut = vld1q_u8_x4(alphabet);
+  const uint8x16_t mask = vdupq_n_u8(0x3f);
+  size_t i = 0;
+
+  for (; i + 48 <= len; i += 48) {
+    uint8x16x3_t in = vld3q_u8(data + i);
+    uint8x16x4_t idx;
+    idx.val[0] = vshrq_n_u8(in.val[0], 2);
+    idx.val[1] = vandq_u8(
+        vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)), mask);
+    idx.val[2] = vandq_u8(
+        vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)), mask);
+    idx.val[3] = vandq_u8(in.val[2], mask);
+
+    uint8x16x4_t chars;
+    for (int k = 0; k < 4; k++) chars.val[k] = vqtbl4q_u8(lut, idx.val[k]);
+    vst4q_u8((uint8_t*)out + i / 3 * 4, chars);
+  }
+
+  return i;
+}
+
+static inline uint8x16_t decode_sextets_neon(uint8x16_t c, uint8x16_t* ok) {
+  uint8x16_t up = vsubq_u8(c, vdupq_n_u8('A'));
+  uint8x16_t lo = vsubq_u8(c, vdupq_n_u8('a'));
+  uint8x16_t dg = vsubq_u8(c, vdupq_n_u8('0'));
+  uint8x16_t is_up = vcleq_u8(up, vdupq_n_u8(25));
+  uint8x16_t is_lo = vcleq_u8(lo, vdupq_n_u8(25));
+  uint8x16_t is_dg = vcleq_u8(dg, vdupq_n_u8(9));
+  uint8x16_t is_62 =
+      vorrq_u8(vceqq_u8(c, vdupq_n_u8('+')), vceqq_u8(c, vdupq_n_u8('-')));
+  uint8x16_t is_63 =
+      vorrq_u8(vceqq_u8(c, vdupq_n_u8('/')), vceqq_u8(c, vdupq_n_u8('_')));
+
+  *ok = vorrq_u8(vorrq_u8(is_up, is_lo),
+                 vorrq_u8(is_dg, vorrq_u8(is_62, is_63)));
+
+  uint8x16_t v = vandq_u8(is_up, up);
+  v = vorrq_u8(v, vandq_u8(is_lo, vaddq_u8(lo, vdupq_n_u8(26))));
+  v = vorrq_u8(v, vandq_u8(is_dg, vaddq_u8(dg, vdupq_n_u8(52))));
+  v = vorrq_u8(v, vandq_u8(is_62, vdupq_n_u8(62)));
+  v = vorrq_u8(v, vandq_u8(is_63, vdupq_n_u8(63)));
+  return v;
+}
+
+static size_t decode_fast(uint8_t* out, const char* data, size_t len) {
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    uint8x16x4_t in = vld4q_u8((const uint8_t*)data + i);
+    uint8x16_t ok0, ok1, ok2, ok3;
+    uint8x16_t a = decode_sextets_neon(in.val[0], &ok0);
+    uint8x16_t b = decode_sextets_neon(in.val[1], &ok1);
+    uint8x16_t c = decode_sextets_neon(in.val[2], &ok2);
+    uint8x16_t d = decode_sextets_neon(in.val[3], &ok3);
+    uint8x16_t ok = vandq_u8(vandq_u8(ok0, ok1), vandq_u8(ok2, ok3));
+    if (vminvq_u8(ok) != 0xff) break;
+
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8(out + i / 4 * 3, bytes);
+  }
+
+  return i;
+}
+
+#else
+
+static size_t encode_fast(char* out, const uint8_t* data, size_t len,
+                          bool url) {
+  (void)out, (void)data, (void)len, (void)url;
+  return 0;
+}
+
+static size_t decode_fast(uint8_t* out, const char* data, size_t len) {
+  (void)out, (void)data, (void)len;
+  return 0;
+}
+
+#endif
+
+void base64_encode_to(char* out, const uint8_t* data, size_t len, bool url) {
+  size_t done = encode_fast(out, data, len, url);
+  encode_scalar(out + done / 3 * 4, data + done, len - done, url);
+}
+
+void base64_decode_init(base64_state* state) {
+  state->bits = 0;
+  state->count = 0;
+  state->padded = false;
+}
+
+bool base64_decode_update(base64_state* state, uint8_t* out, size_t* out_len,
+                          const char* data, size_t len) {
+  size_t i = 0, o = 0;
+
+  while (i < len) {
+    // Vector kernels only run on group boundaries.
+    if (state->count == 0 && !state->padded) {
+      size_t n = decode_fast(out + o, data + i, len - i);
+      i += n;
+      o += n / 4 * 3;
+      if (i == len) break;
+    }
+
+    // Take at least one block the kernels refused (whitespace, padding,
+    // invalid input or the short tail), then get back to a group boundary.
+    size_t stop = len - i > 64 ? i + 64 : len;
+    while (i < len && (i < stop || state->count != 0)) {
+      if (!decode_char(state, out, &o, (unsigned char)data[i++])) {
+        *out_len = o;
+        return false;
+      }
+    }
+  }
+
+  *out_len = o;
+  return true;
+}
+
+bool base64_decode_final(base64_state* state, uint8_t* out, size_t* out_len) {
+  size_t o = 0;
+  bool ok = flush_partial(state, out, &o);
+  *out_len = o;
+  return ok;
+}
+
+bool base64_decode_to(uint8_t* out, size_t* out_len, const char* data,
+                      size_t len) {
+  base64_state state;
+  size_t n, tail;
+
+  base64_decode_init(&state);
+  if (!base64_decode_update(&state, out, &n, data, len)) return false;
+  if (!base64_decode_final(&state, out + n, &tail)) return false;
+
+  *out_len = n + tail;
+  return true;
+}
+
+uint8_t* base64_decode(const char* data, size_t data_len, size_t* len) {
+  uint8_t* decoded = malloc(base64_decoded_maxlen(data_len) + 1);
+  if (!decoded) return NULL;
+
+  if (!base64_decode_to(decoded, len, data, data_len)) {
+    free(decoded);
+    return NULL;
+  }
+
+  return decoded;
+}
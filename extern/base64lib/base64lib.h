@@ -0,0 +1,42 @@
+#ifndef __BASE64LIB__
+#define __BASE64LIB__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental decoder state. Accepts both the standard and the URL-safe
+// alphabet, skips ASCII whitespace and stops at '=' padding.
+typedef struct {
+  uint32_t bits;    // pending sextets, most recent in the low bits
+  unsigned count;   // number of pending sextets (0..3)
+  bool padded;      // '=' seen, only more '=' or whitespace may follow
+} base64_state;
+
+// Length of the encoding of `len` bytes (padded unless `url`).
+size_t base64_encoded_len(size_t len, bool url);
+
+// Upper bound of the bytes decoded from `len` characters.
+size_t base64_decoded_maxlen(size_t len);
+
+// Writes base64_encoded_len(len, url) characters to `out` (no terminator).
+void base64_encode_to(char* out, const uint8_t* data, size_t len, bool url);
+
+void base64_decode_init(base64_state* state);
+
+// Decodes a chunk into `out`, which must hold base64_decoded_maxlen(len)
+// bytes. `out_len` receives the bytes written. Returns false on bad input.
+bool base64_decode_update(base64_state* state, uint8_t* out, size_t* out_len,
+                          const char* data, size_t len);
+
+// Flushes the last partial group (at most 2 bytes).
+bool base64_decode_final(base64_state* state, uint8_t* out, size_t* out_len);
+
+// One-shot decode into `out` (base64_decoded_maxlen(len) bytes).
+bool base64_decode_to(uint8_t* out, size_t* out_len, const char* data,
+                      size_t len);
+
+// Allocating variant; the result must be released with free().
+uint8_t* base64_decode(const char* data, size_t data_len, size_t* len);
+
+#endif
@@ -1,33 +1,277 @@
 #include "hexlib.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-char* hex_encode(const uint8_t* data, size_t len) {
-  char* hex = malloc(2 * len + 1);
-  if (!hex) return NULL;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEXLIB_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define HEXLIB_NEON 1
+#include <arm_neon.h>
+#endif
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Nibble value of each hex digit, stored biased by 0x10 so the zero-filled
+// rest of the table reads as invalid once hex_value() removes the bias.
+static const uint8_t HEX_VALUES[256] = {
+    ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14,
+    ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19,
+    ['a'] = 0x1a, ['b'] = 0x1b, ['c'] = 0x1c, ['d'] = 0x1d, ['e'] = 0x1e,
+    ['f'] = 0x1f, ['A'] = 0x1a, ['B'] = 0x1b, ['C'] = 0x1c, ['D'] = 0x1d,
+    ['E'] = 0x1e, ['F'] = 0x1f,
+};
 
+static inline uint8_t hex_value(unsigned char c) {
+  return (uint8_t)(HEX_VALUES[c] - 0x10);  // 0xf0 when invalid
+}
+
+static void hex_encode_scalar(char* out, const uint8_t* data, size_t len) {
   for (size_t i = 0; i < len; i++) {
-    snprintf(&hex[2 * i], 3, "%02x", data[i]);
+    out[2 * i] = HEX_DIGITS[data[i] >> 4];
+    out[2 * i + 1] = HEX_DIGITS[data[i] & 0x0f];
+  }
+}
+
+static bool hex_decode_scalar(uint8_t* out, const char* data, size_t len) {
+  for (size_t i = 0; i < len / 2; i++) {
+    uint8_t hi = hex_value((unsigned char)data[2 * i]);
+    uint8_t lo = hex_value((unsigned char)data[2 * i + 1]);
+    if ((hi | lo) & 0xf0) return false;
+    out[i] = (uint8_t)(hi << 4 | lo);
+  }
+  return true;
+}
+
+#if HEXLIB_X86
+
+__attribute__((target("ssse3"))) static void hex_encode_ssse3(
+    char* out, const uint8_t* data, size_t len) {
+  const __m128i digits = _mm_loadu_si128((const __m128i*)HEX_DIGITS);
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(data + i));
+    __m128i hi =
+        _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+    __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(x, mask));
+    _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i*)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+
+  hex_encode_scalar(out + 2 * i, data + i, len - i);
+}
+
+__attribute__((target("avx2"))) static void hex_encode_avx2(
+    char* out, const uint8_t* data, size_t len) {
+  const __m256i digits =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)HEX_DIGITS));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(data + i));
+    __m256i hi = _mm256_shuffle_epi8(
+        digits, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+    __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(x, mask));
+    // unpack works per 128-bit lane, so stitch the halves back in order
+    __m256i a = _mm256_unpacklo_epi8(hi, lo);
+    __m256i b = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256((__m256i*)(out + 2 * i),
+                        _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256((__m256i*)(out + 2 * i + 32),
+                        _mm256_permute2x128_si256(a, b, 0x31));
+  }
+
+  hex_encode_ssse3(out + 2 * i, data + i, len - i);
+}
+
+// Converts 16 hex characters to nibble values; `ok` gets 0xff per valid lane.
+__attribute__((target("ssse3"))) static inline __m128i hex_nibbles_ssse3(
+    __m128i c, __m128i* ok) {
+  __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                           _mm_set1_epi8('a'));
+  __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+  __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+  *ok = _mm_or_si128(is_digit, is_alpha);
+  return _mm_or_si128(
+      _mm_and_si128(is_digit, d),
+      _mm_and_si128(is_alpha, _mm_add_epi8(l, _mm_set1_epi8(10))));
+}
+
+__attribute__((target("ssse3"))) static bool hex_decode_ssse3(
+    uint8_t* out, const char* data, size_t len) {
+  const __m128i weights = _mm_set1_epi16(0x0110);  // hi * 16 + lo * 1
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m128i ok0, ok1;
+    __m128i v0 = hex_nibbles_ssse3(
+        _mm_loadu_si128((const __m128i*)(data + i)), &ok0);
+    __m128i v1 = hex_nibbles_ssse3(
+        _mm_loadu_si128((const __m128i*)(data + i + 16)), &ok1);
+    if (_mm_movemask_epi8(_mm_and_si128(ok0, ok1)) != 0xffff) return false;
+
+    __m128i b0 = _mm_maddubs_epi16(v0, weights);
+    __m128i b1 = _mm_maddubs_epi16(v1, weights);
+    _mm_storeu_si128((__m128i*)(out + i / 2), _mm_packus_epi16(b0, b1));
+  }
+
+  return hex_decode_scalar(out + i / 2, data + i, len - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i hex_nibbles_avx2(
+    __m256i c, __m256i* ok) {
+  __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+  __m256i l = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)),
+                              _mm256_set1_epi8('a'));
+  __m256i is_digit =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+  __m256i is_alpha =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+  *ok = _mm256_or_si256(is_digit, is_alpha);
+  return _mm256_or_si256(
+      _mm256_and_si256(is_digit, d),
+      _mm256_and_si256(is_alpha, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2"))) static bool hex_decode_avx2(
+    uint8_t* out, const char* data, size_t len) {
+  const __m256i weights = _mm256_set1_epi16(0x0110);
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    __m256i ok0, ok1;
+    __m256i v0 = hex_nibbles_avx2(
+        _mm256_loadu_si256((const __m256i*)(data + i)), &ok0);
+    __m256i v1 = hex_nibbles_avx2(
+        _mm256_loadu_si256((const __m256i*)(data + i + 32)), &ok1);
+    if (_mm256_movemask_epi8(_mm256_and_si256(ok0, ok1)) != -1) return false;
+
+    __m256i b0 = _mm256_maddubs_epi16(v0, weights);
+    __m256i b1 = _mm256_maddubs_epi16(v1, weights);
+    // packus interleaves lanes: [b0.lo b1.lo b0.hi b1.hi] -> restore order
+    __m256i packed = _mm256_packus_epi16(b0, b1);
+    _mm256_storeu_si256((__m256i*)(out + i / 2),
+                        _mm256_permute4x64_epi64(packed, 0xd8));
   }
 
+  return hex_decode_ssse3(out + i / 2, data + i, len - i);
+}
+
+typedef void (*hex_encode_fn)(char*, const uint8_t*, size_t);
+typedef bool (*hex_decode_fn)(uint8_t*, const char*, size_t);
+
+static hex_encode_fn hex_encode_impl;
+static hex_decode_fn hex_decode_impl;
+
+static void hex_select(void) {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    hex_encode_impl = hex_encode_avx2;
+    hex_decode_impl = hex_decode_avx2;
+  } else if (__builtin_cpu_supports("ssse3")) {
+    hex_encode_impl = hex_encode_ssse3;
+    hex_decode_impl = hex_decode_ssse3;
+  } else {
+    hex_encode_impl = hex_encode_scalar;
+    hex_decode_impl = hex_decode_scalar;
+  }
+}
+
+void hex_encode_to(char* out, const uint8_t* data, size_t len) {
+  if (!hex_encode_impl) hex_select();
+  hex_encode_impl(out, data, len);
+}
+
+bool hex_decode_to(uint8_t* out, const char* data, size_t len) {
+  if (len % 2 != 0) return false;
+  if (!hex_decode_impl) hex_select();
+  return hex_decode_impl(out, data, len);
+}
+
+#elif HEXLIB_NEON
+
+static inline uint8x16_t hex_nibbles_neon(uint8x16_t c, uint8x16_t* ok) {
+  uint8x16_t d = vsubq_u8(c, vdupq_n_u8('0'));
+  uint8x16_t l = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+  uint8x16_t is_digit = vcleq_u8(d, vdupq_n_u8(9));
+  uint8x16_t is_alpha = vcleq_u8(l, vdupq_n_u8(5));
+  *ok = vorrq_u8(is_digit, is_alpha);
+  return vbslq_u8(is_digit, d, vaddq_u8(l, vdupq_n_u8(10)));
+}
+
+void hex_encode_to(char* out, const uint8_t* data, size_t len) {
+  const uint8x16_t digits = vld1q_u8((const uint8_t*)HEX_DIGITS);
+  const uint8x16_t mask = vdupq_n_u8(0x0f);
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t x = vld1q_u8(data + i);
+    uint8x16x2_t pair;
+    pair.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(x, 4));
+    pair.val[1] = vqtbl1q_u8(digits, vandq_u8(x, mask));
+    vst2q_u8((uint8_t*)out + 2 * i, pair);
+  }
+
+  hex_encode_scalar(out + 2 * i, data + i, len - i);
+}
+
+bool hex_decode_to(uint8_t* out, const char* data, size_t len) {
+  if (len % 2 != 0) return false;
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    uint8x16x2_t pair = vld2q_u8((const uint8_t*)data + i);
+    uint8x16_t ok_hi, ok_lo;
+    uint8x16_t hi = hex_nibbles_neon(pair.val[0], &ok_hi);
+    uint8x16_t lo = hex_nibbles_neon(pair.val[1], &ok_lo);
+    if (vminvq_u8(vandq_u8(ok_hi, ok_lo)) != 0xff) return false;
+    vst1q_u8(out + i / 2, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+  }
+
+  return hex_decode_scalar(out + i / 2, data + i, len - i);
+}
+
+#else
+
+void hex_encode_to(char* out, const uint8_t* data, size_t len) {
+  hex_encode_scalar(out, data, len);
+}
+
+bool hex_decode_to(uint8_t* out, const char* data, size_t len) {
+  if (len % 2 != 0) return false;
+  return hex_decode_scalar(out, data, len);
+}
+
+#endif
+
+char* hex_encode(const uint8_t* data, size_t len) {
+  char* hex = malloc(2 * len + 1);
+  if (!hex) return NULL;
+
+  hex_encode_to(hex, data, len);
+  hex[2 * len] = '\0';
   return hex;
 }
 
-uint8_t* hex_decode(const char* data, size_t* len) {
-  size_t input_len = strlen(data);
-  if (input_len % 2 != 0) return NULL;
+uint8_t* hex_decode(const char* data, size_t data_len, size_t* len) {
+  if (data_len % 2 != 0) return NULL;
 
-  *len = input_len / 2;
-  uint8_t* decoded = malloc(*len);
+  *len = data_len / 2;
+  uint8_t* decoded = malloc(*len ? *len : 1);
   if (!decoded) return NULL;
 
-  for (size_t i = 0; i < *len; i++) {
-    sscanf(&data[2 * i], "%2hhx", &decoded[i]);
+  if (!hex_decode_to(decoded, data, data_len)) {
+    free(decoded);
+    return NULL;
   }
 
   return decoded;
-}
\ No newline at end of file
+}
@@ -1,10 +1,19 @@
 #ifndef __HEXLIB__
 #define __HEXLIB__
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+// Writes exactly 2 * len lowercase hex digits to `out` (no terminator).
+void hex_encode_to(char* out, const uint8_t* data, size_t len);
+
+// Decodes `len` hex digits (either case) into len / 2 bytes at `out`.
+// Returns false if `len` is odd or a character is not a hex digit.
+bool hex_decode_to(uint8_t* out, const char* data, size_t len);
+
+// Allocating variants; the result must be released with free().
 char* hex_encode(const uint8_t* data, size_t len);
-uint8_t* hex_decode(const char* data, size_t* len);
+uint8_t* hex_decode(const char* data, size_t data_len, size_t* len);
 
-#endif
\ No newline at end of file
+#endif
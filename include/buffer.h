@@ -7,6 +7,9 @@
 #define BUFFER_METHODSINDEX "__methods"
 #define BUFFER_INSPECT_MAX_BYTES 50
 
+// Payloads up to this size live in the userdata block itself.
+#define BUFFER_INLINE_MAX 4096
+
 #define SIZE_F32 ((size_t)sizeof(float))
 #define SIZE_F64 ((size_t)sizeof(double))
 #define SIZE_UINT8 ((size_t)sizeof(uint8_t))
@@ -21,11 +24,33 @@
 #define ENCODING_UTF8 "utf8"
 #define ENCODING_BASE16 "hex"
 #define ENCODING_BASE64 "base64"
+#define ENCODING_BASE64URL "base64url"
+#define ENCODING_UTF16LE "utf16le"
+#define ENCODING_LATIN1 "latin1"
+#define ENCODING_ASCII "ascii"
+#define ENCODING_BINARY "binary"
+
+#define SUPPORTED_ENCODINGS                                          \
+  ENCODING_UTF8 ", " ENCODING_BASE16 ", " ENCODING_BASE64 ", "       \
+  ENCODING_BASE64URL ", " ENCODING_UTF16LE ", " ENCODING_LATIN1 ", " \
+  ENCODING_ASCII ", " ENCODING_BINARY
+
+// Who owns the bytes behind `Buffer.buffer`, i.e. what __gc has to do.
+typedef enum {
+  BUFFER_STORAGE_HEAP,    // malloc'd by us, freed on __gc
+  BUFFER_STORAGE_INLINE,  // trails the header in the userdata, owned by Lua
+  BUFFER_STORAGE_POOL,    // size-class block, returned to the pool on __gc
+  BUFFER_STORAGE_VIEW,    // borrowed from the owner held in user value 1
+  BUFFER_STORAGE_MMAP,    // file mapping of `capacity` bytes, munmap'd on __gc
+} BufferStorage;
 
-#define SUPPORTED_ENCODINGS \
-  ENCODING_UTF8 ", " ENCODING_BASE16 ", " ENCODING_BASE64
+struct AsyncEngine;
 
 typedef struct {
   uint8_t* buffer;
   size_t size;
+  size_t capacity;  // bytes actually allocated for owned storage
+  BufferStorage storage;
+  struct AsyncEngine* engine;  // engine holding requests on these bytes
+  size_t async_pending;        // those requests, until poll() returns them
 } Buffer;
@@ -1,7 +1,23 @@
 #pragma once
 
 #include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer.h"
+
+Buffer* buffer_new(lua_State* L, size_t size, bool zeroed);
+Buffer* buffer_adopt(lua_State* L, uint8_t* data, size_t size);
+Buffer* buffer_view(lua_State* L, int idx, size_t offset, size_t len);
+void buffer_fill_pattern(uint8_t* dst, size_t len, const uint8_t* pat,
+                         size_t pat_len);
 
 int l_buffer_from(lua_State* L);
 int l_buffer_alloc(lua_State* L);
-int l_buffer_alloc_unsafe(lua_State* L);
\ No newline at end of file
+int l_buffer_alloc_unsafe(lua_State* L);
+int l_buffer_fill(lua_State* L);
+int l_buffer_slice(lua_State* L);
+int l_buffer_concat(lua_State* L);
+int l_buffer_copy(lua_State* L);
+int l_buffer_copy_within(lua_State* L);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <lua.h>
+
+#include "buffer.h"
+
+#define BUFFER_ENGINE_MT "BufferEngine*"
+
+// Worker threads of the thread-pool backend.
+#define BUFFER_ENGINE_DEFAULT_THREADS 4
+#define BUFFER_ENGINE_MAX_THREADS 64
+
+// Submission queue depth of the io_uring backend.
+#define BUFFER_ENGINE_URING_ENTRIES 256
+
+void buffer_async_open(lua_State* L);
+
+// Cancels the queued requests on `buf` and waits for the running ones, so
+// its bytes can be freed. Buffers with pending requests stay pinned, so only
+// lua_close() can finalize one.
+void buffer_async_drain(Buffer* buf);
+
+int l_buffer_engine(lua_State* L);
+int l_buffer_read_async(lua_State* L);
+int l_buffer_write_async(lua_State* L);
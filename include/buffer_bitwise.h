@@ -0,0 +1,14 @@
+#pragma once
+
+#include <lua.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of set bits in `len` bytes at `p`.
+uint64_t buffer_popcount(const uint8_t* p, size_t len);
+
+int l_buffer_xor(lua_State* L);
+int l_buffer_band(lua_State* L);
+int l_buffer_bor(lua_State* L);
+int l_buffer_bnot(lua_State* L);
+int l_buffer_popcount(lua_State* L);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <lua.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Running checksums in zlib style: pass the previous result (0 for the CRCs,
+// 1 for Adler-32 on the first chunk) to continue across chunks.
+uint32_t buffer_crc32(uint32_t crc, const uint8_t* p, size_t len);
+uint32_t buffer_crc32c(uint32_t crc, const uint8_t* p, size_t len);
+uint32_t buffer_adler32(uint32_t adler, const uint8_t* p, size_t len);
+
+int l_buffer_crc32(lua_State* L);
+int l_buffer_crc32c(lua_State* L);
+int l_buffer_adler32(lua_State* L);
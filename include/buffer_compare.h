@@ -0,0 +1,13 @@
+#pragma once
+
+#include <lua.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Index of the first byte where `a` and `b` differ, `len` when they don't.
+size_t buffer_mismatch(const uint8_t* a, const uint8_t* b, size_t len);
+
+int l_buffer_compare(lua_State* L);
+int l_buffer_compare_method(lua_State* L);
+int l_buffer_equals(lua_State* L);
+int l_buffer_timing_safe_equal(lua_State* L);
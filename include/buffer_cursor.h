@@ -0,0 +1,32 @@
+#pragma once
+
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUFFER_READER_MT "BufferReader*"
+#define BUFFER_WRITER_MT "BufferWriter*"
+
+// Default capacity of a growable writer created without one.
+#define BUFFER_WRITER_DEFAULT_CAPACITY 256
+
+// Position over a window of bytes. Cursors created from a Buffer pin it in
+// user value 1 and borrow its bytes; growable writers own `base`, allocated
+// through buffer_mem and doubled whenever a write doesn't fit.
+typedef struct {
+  uint8_t* base;  // first byte of the window
+  uint8_t* cur;   // next byte to read or write
+  uint8_t* end;   // one past the last usable byte
+  bool growable;
+} BufferCursor;
+
+void buffer_cursor_open(lua_State* L);
+
+BufferCursor* buffer_writer_new(lua_State* L, size_t capacity);
+uint8_t* cursor_reserve(lua_State* L, BufferCursor* c, size_t n);
+int cursor_finish(lua_State* L, BufferCursor* c);
+
+int l_buffer_reader(lua_State* L);
+int l_buffer_writer(lua_State* L);
+int l_buffer_new_writer(lua_State* L);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <lua.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUFFER_HASHER_MT "BufferHasher*"
+
+typedef struct {
+  uint64_t lo;
+  uint64_t hi;
+} BufferHash128;
+
+// XXH3 64/128-bit hashes. Results match the reference implementation
+// (XXH3_64bits_withSeed / XXH3_128bits_withSeed) on every platform.
+uint64_t buffer_hash64(const uint8_t* p, size_t len, uint64_t seed);
+BufferHash128 buffer_hash128(const uint8_t* p, size_t len, uint64_t seed);
+
+void buffer_hash_open(lua_State* L);
+
+int l_buffer_hash64(lua_State* L);
+int l_buffer_hash128(lua_State* L);
+int l_buffer_new_hasher(lua_State* L);
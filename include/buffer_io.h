@@ -0,0 +1,8 @@
+#pragma once
+
+#include <lua.h>
+
+int l_buffer_write_to(lua_State* L);
+int l_buffer_read_from(lua_State* L);
+int l_buffer_writev(lua_State* L);
+int l_buffer_readv(lua_State* L);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BUFFER_LAYOUT_MT "BufferLayout*"
+
+typedef enum {
+  FIELD_INT,
+  FIELD_UINT,
+  FIELD_FLOAT,
+  FIELD_DOUBLE,
+  FIELD_CHARS,
+  FIELD_PAD,
+} FieldKind;
+
+typedef struct {
+  FieldKind kind;
+  size_t size;
+  size_t offset;  // from the start of the record
+  bool little;
+} LayoutField;
+
+typedef struct {
+  size_t size;     // bytes per record
+  size_t nvalues;  // fields that produce a value (everything but padding)
+  size_t nfields;
+  LayoutField fields[];
+} Layout;
+
+void buffer_layout_open(lua_State* L);
+int l_buffer_compile(lua_State* L);
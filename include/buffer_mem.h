@@ -0,0 +1,53 @@
+#pragma once
+
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Power-of-two size classes served by the payload pool: 64 B .. 16 KiB.
+#define BUFFER_POOL_MIN_SHIFT 6
+#define BUFFER_POOL_MAX_SHIFT 14
+#define BUFFER_POOL_MIN ((size_t)1 << BUFFER_POOL_MIN_SHIFT)
+#define BUFFER_POOL_MAX ((size_t)1 << BUFFER_POOL_MAX_SHIFT)
+#define BUFFER_POOL_CLASSES (BUFFER_POOL_MAX_SHIFT - BUFFER_POOL_MIN_SHIFT + 1)
+
+// Unreported external growth that triggers a collector step.
+#define BUFFER_GC_PACE ((size_t)256 * 1024)
+
+typedef struct PoolBlock {
+  struct PoolBlock* next;
+} PoolBlock;
+
+// Per-lua_State allocator bookkeeping, kept in the registry.
+typedef struct {
+  lua_Alloc allocf;
+  void* ud;
+  size_t external;  // payload bytes allocated outside of Lua objects
+  size_t debt;      // growth not yet reported to the collector
+  PoolBlock* free[BUFFER_POOL_CLASSES];
+  size_t count[BUFFER_POOL_CLASSES];
+  size_t limit;   // max bytes kept on the freelists, 0 disables the pool
+  size_t cached;  // bytes currently on the freelists
+  size_t hits;
+  size_t misses;
+  bool closed;
+} BufferMem;
+
+void buffer_mem_open(lua_State* L);
+BufferMem* buffer_mem(lua_State* L);
+
+void* buffer_mem_alloc(BufferMem* mem, size_t size);
+void* buffer_mem_realloc(BufferMem* mem, void* ptr, size_t osize,
+                         size_t nsize);
+void buffer_mem_free(BufferMem* mem, void* ptr, size_t size);
+void buffer_mem_pace(lua_State* L, BufferMem* mem);
+
+bool buffer_pool_accepts(const BufferMem* mem, size_t size);
+uint8_t* buffer_pool_acquire(BufferMem* mem, size_t size, size_t* capacity);
+void buffer_pool_release(BufferMem* mem, uint8_t* block, size_t capacity);
+
+int l_buffer_pool_stats(lua_State* L);
+int l_buffer_pool_trim(lua_State* L);
+int l_buffer_pool_limit(lua_State* L);
+int l_buffer_external_memory(lua_State* L);
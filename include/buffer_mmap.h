@@ -0,0 +1,11 @@
+#pragma once
+
+#include <lua.h>
+
+#include "buffer.h"
+
+void buffer_mmap_release(Buffer* buf);
+
+int l_buffer_mmap(lua_State* L);
+int l_buffer_sync(lua_State* L);
+int l_buffer_advise(lua_State* L);
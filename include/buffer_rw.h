@@ -1,25 +1,126 @@
 #pragma once
 
+#include <lauxlib.h>
 #include <lua.h>
+#include <stddef.h>
+
+#include "buffer.h"
+#include "errors.h"
+
+static inline void buffer_check(lua_State* L, const Buffer* buf,
+                                lua_Integer offset, size_t len) {
+  if (offset < 0)
+    luaL_error(L, "offset is out of range (expected >= 1, got %I)", offset + 1);
+
+  if ((size_t)offset + len > buf->size)
+    luaL_error(L,
+               "attempt to access memory outside buffer bounds (offset=%I, "
+               "size=%I, len=%I)",
+               offset + 1, (lua_Integer)buf->size, (lua_Integer)len);
+}
+
+// Truncates `n` like the C cast, which is undefined for NaN, infinities and
+// anything outside [-2^63, 2^63), so those are raised as errors instead.
+static inline lua_Integer number_to_int(lua_State* L, lua_Number n) {
+  if (!(n >= -0x1p63 && n < 0x1p63))
+    luaL_error(L, ERR_INT_OUT_OF_RANGE, "value", (lua_Integer)LUA_MININTEGER,
+               (lua_Integer)LUA_MAXINTEGER, n);
+  return (lua_Integer)n;
+}
+
+// Integer argument for the writers; floats are truncated like the C cast.
+static inline lua_Integer check_int_value(lua_State* L, int arg) {
+  int isint;
+  lua_Integer v = lua_tointegerx(L, arg, &isint);
+  return isint ? v : number_to_int(L, luaL_checknumber(L, arg));
+}
 
 int l_buffer_tostring(lua_State* L);
 int l_buffer_write_string(lua_State* L);
 
-int l_buffer_read_i16be(lua_State* L);
-int l_buffer_write_i16be(lua_State* L);
+int l_buffer_read_u8(lua_State* L);
+int l_buffer_write_u8(lua_State* L);
+int l_buffer_read_i8(lua_State* L);
+int l_buffer_write_i8(lua_State* L);
 int l_buffer_read_u16le(lua_State* L);
 int l_buffer_write_u16le(lua_State* L);
+int l_buffer_read_u16be(lua_State* L);
+int l_buffer_write_u16be(lua_State* L);
 int l_buffer_read_i16le(lua_State* L);
 int l_buffer_write_i16le(lua_State* L);
+int l_buffer_read_i16be(lua_State* L);
+int l_buffer_write_i16be(lua_State* L);
 int l_buffer_read_u32le(lua_State* L);
-int l_buffer_read_u32be(lua_State* L);
 int l_buffer_write_u32le(lua_State* L);
+int l_buffer_read_u32be(lua_State* L);
 int l_buffer_write_u32be(lua_State* L);
+int l_buffer_read_i32le(lua_State* L);
+int l_buffer_write_i32le(lua_State* L);
+int l_buffer_read_i32be(lua_State* L);
+int l_buffer_write_i32be(lua_State* L);
+int l_buffer_read_u64le(lua_State* L);
+int l_buffer_write_u64le(lua_State* L);
+int l_buffer_read_u64be(lua_State* L);
+int l_buffer_write_u64be(lua_State* L);
+int l_buffer_read_i64le(lua_State* L);
+int l_buffer_write_i64le(lua_State* L);
+int l_buffer_read_i64be(lua_State* L);
+int l_buffer_write_i64be(lua_State* L);
 int l_buffer_read_f32le(lua_State* L);
-int l_buffer_read_f32be(lua_State* L);
 int l_buffer_write_f32le(lua_State* L);
+int l_buffer_read_f32be(lua_State* L);
 int l_buffer_write_f32be(lua_State* L);
 int l_buffer_read_f64le(lua_State* L);
-int l_buffer_read_f64be(lua_State* L);
 int l_buffer_write_f64le(lua_State* L);
-int l_buffer_write_f64be(lua_State* L);
\ No newline at end of file
+int l_buffer_read_f64be(lua_State* L);
+int l_buffer_write_f64be(lua_State* L);
+int l_buffer_read_uintle(lua_State* L);
+int l_buffer_read_uintbe(lua_State* L);
+int l_buffer_read_intle(lua_State* L);
+int l_buffer_read_intbe(lua_State* L);
+int l_buffer_write_intle(lua_State* L);
+int l_buffer_write_intbe(lua_State* L);
+
+int l_buffer_read_u8_array(lua_State* L);
+int l_buffer_write_u8_array(lua_State* L);
+int l_buffer_read_i8_array(lua_State* L);
+int l_buffer_write_i8_array(lua_State* L);
+int l_buffer_read_u16le_array(lua_State* L);
+int l_buffer_write_u16le_array(lua_State* L);
+int l_buffer_read_u16be_array(lua_State* L);
+int l_buffer_write_u16be_array(lua_State* L);
+int l_buffer_read_i16le_array(lua_State* L);
+int l_buffer_write_i16le_array(lua_State* L);
+int l_buffer_read_i16be_array(lua_State* L);
+int l_buffer_write_i16be_array(lua_State* L);
+int l_buffer_read_u32le_array(lua_State* L);
+int l_buffer_write_u32le_array(lua_State* L);
+int l_buffer_read_u32be_array(lua_State* L);
+int l_buffer_write_u32be_array(lua_State* L);
+int l_buffer_read_i32le_array(lua_State* L);
+int l_buffer_write_i32le_array(lua_State* L);
+int l_buffer_read_i32be_array(lua_State* L);
+int l_buffer_write_i32be_array(lua_State* L);
+int l_buffer_read_u64le_array(lua_State* L);
+int l_buffer_write_u64le_array(lua_State* L);
+int l_buffer_read_u64be_array(lua_State* L);
+int l_buffer_write_u64be_array(lua_State* L);
+int l_buffer_read_i64le_array(lua_State* L);
+int l_buffer_write_i64le_array(lua_State* L);
+int l_buffer_read_i64be_array(lua_State* L);
+int l_buffer_write_i64be_array(lua_State* L);
+int l_buffer_read_f32le_array(lua_State* L);
+int l_buffer_write_f32le_array(lua_State* L);
+int l_buffer_read_f32be_array(lua_State* L);
+int l_buffer_write_f32be_array(lua_State* L);
+int l_buffer_read_f64le_array(lua_State* L);
+int l_buffer_write_f64le_array(lua_State* L);
+int l_buffer_read_f64be_array(lua_State* L);
+int l_buffer_write_f64be_array(lua_State* L);
+
+int l_buffer_read_varuint(lua_State* L);
+int l_buffer_write_varuint(lua_State* L);
+int l_buffer_read_varint(lua_State* L);
+int l_buffer_write_varint(lua_State* L);
+int l_buffer_read_varuint_array(lua_State* L);
+int l_buffer_read_varint_array(lua_State* L);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <lua.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// First/last occurrence of `needle` in `hay`, NULL when absent. An empty
+// needle matches at the start (find) or at the last position (rfind).
+const uint8_t* buffer_find(const uint8_t* hay, size_t hay_len,
+                           const uint8_t* needle, size_t needle_len);
+const uint8_t* buffer_rfind(const uint8_t* hay, size_t hay_len,
+                            const uint8_t* needle, size_t needle_len);
+
+int l_buffer_index_of(lua_State* L);
+int l_buffer_last_index_of(lua_State* L);
+int l_buffer_includes(lua_State* L);
+int l_buffer_split(lua_State* L);
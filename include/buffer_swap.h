@@ -0,0 +1,13 @@
+#pragma once
+
+#include <lua.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Reverses the byte order of each `width`-byte (2, 4 or 8) element of the
+// `len` bytes at `p`; `len` must be a multiple of `width`.
+void buffer_swap(uint8_t* p, size_t len, size_t width);
+
+int l_buffer_swap16(lua_State* L);
+int l_buffer_swap32(lua_State* L);
+int l_buffer_swap64(lua_State* L);
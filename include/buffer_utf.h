@@ -0,0 +1,29 @@
+#pragma once
+
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// True when the `len` bytes at `p` are well-formed UTF-8: no overlong forms,
+// surrogates, truncated sequences or code points above U+10FFFF.
+bool buffer_utf8_valid(const uint8_t* p, size_t len);
+
+// Bytes -> UTF-8 text. `out` must hold 2 * len bytes for latin1 and
+// 3 * (len / 2) for UTF-16LE; the number of bytes written is returned.
+// Unpaired surrogates become U+FFFD and an odd trailing byte is dropped.
+size_t buffer_latin1_to_utf8(char* out, const uint8_t* data, size_t len);
+size_t buffer_utf16le_to_utf8(char* out, const uint8_t* data, size_t len);
+
+// Writes `len` bytes with the high bit of each cleared.
+void buffer_ascii_to_utf8(char* out, const uint8_t* data, size_t len);
+
+// UTF-8 text -> bytes; false when `data` is not well-formed UTF-8. `out` must
+// hold len bytes for latin1 (code points above U+00FF keep their low byte)
+// and 2 * len for UTF-16LE.
+bool buffer_utf8_to_latin1(uint8_t* out, size_t* out_len, const char* data,
+                           size_t len);
+bool buffer_utf8_to_utf16le(uint8_t* out, size_t* out_len, const char* data,
+                            size_t len);
+
+int l_buffer_is_utf8(lua_State* L);
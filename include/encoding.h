@@ -0,0 +1,48 @@
+#pragma once
+
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  ENCODING_ID_UTF8,
+  ENCODING_ID_HEX,
+  ENCODING_ID_BASE64,
+  ENCODING_ID_BASE64URL,
+  ENCODING_ID_UTF16LE,
+  ENCODING_ID_LATIN1,
+  ENCODING_ID_ASCII,
+  ENCODING_ID_BINARY,
+  ENCODING_COUNT,
+} EncodingId;
+
+typedef struct {
+  const char* name;
+  const char* constant;  // exported as buffer.<constant>
+  const char* invalid;   // error raised when decoding fails
+  bool identity;         // bytes map 1:1 to string characters
+
+  // `out` must hold encoded_len(len) bytes, encode() returns the count used
+  size_t (*encoded_len)(size_t len);
+  size_t (*encode)(char* out, const uint8_t* data, size_t len);
+
+  // `out` must hold decoded_maxlen(len) bytes
+  size_t (*decoded_maxlen)(size_t len);
+  bool (*decode)(uint8_t* out, size_t* out_len, const char* data, size_t len);
+} Codec;
+
+extern const Codec CODECS[ENCODING_COUNT];
+
+void encoding_push_lookup(lua_State* L);
+void encoding_set_constants(lua_State* L, int idx);
+
+// Resolves argument `arg` (name or buffer.<CONSTANT>, utf8 when absent).
+// Needs the lookup table from encoding_push_lookup() as upvalue 1.
+const Codec* check_encoding(lua_State* L, int arg);
+
+// Decodes `data` with `codec` into a temporary that must be released with
+// free(), or returns `data` itself for identity codecs.
+const uint8_t* codec_decode_alloc(lua_State* L, const Codec* codec,
+                                  const char* data, size_t len,
+                                  size_t* out_len);
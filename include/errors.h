@@ -6,14 +6,21 @@
 #include "buffer.h"
 
 #define ERR_INVALID_HEX_STRING "Invalid hex string"
+#define ERR_INVALID_BASE64_STRING "Invalid base64 string"
+#define ERR_INVALID_UTF8_STRING "Invalid UTF-8 string"
 #define ERR_OFFSET_OUT_OF_RANGE "Offset out of range"
 
 #define ERR_OUT_OF_RANGE                                                     \
   "The value of \"%s\" is out of range. It must be >= 0 && <= %I. Received " \
   "\"%I\""
 
+// For numbers that have no lua_Integer equivalent (NaN, inf, |x| >= 2^63).
+#define ERR_INT_OUT_OF_RANGE                                         \
+  "The value of \"%s\" is out of range. It must be >= %I && <= %I. " \
+  "Received %f"
+
 #define ERR_UNSUPPORTED_ENCODING \
   "Unsupported encoding: \"%s\" (supported: " SUPPORTED_ENCODINGS ")"
 
-int push_lua_errno(lua_State* L);
-int throw_lua_oom(lua_State* L, size_t size);
+int push_luaerrno(lua_State* L);
+int throw_luaoom(lua_State* L, size_t size);
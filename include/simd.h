@@ -0,0 +1,12 @@
+#pragma once
+
+// SIMD availability for the kernels in src/. x86 kernels are compiled per
+// function with target attributes and picked at runtime with
+// __builtin_cpu_supports(); NEON is part of the aarch64 baseline.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BUFFER_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BUFFER_NEON 1
+#include <arm_neon.h>
+#endif
@@ -1,6 +1,98 @@
 #pragma once
 
+#include <lua.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
-void reverse_bytes(uint8_t* b, size_t n);
\ No newline at end of file
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_LITTLE_ENDIAN 0
+#else
+#define HOST_LITTLE_ENDIAN 1
+#endif
+
+size_t resolve_range(size_t size, lua_Integer start, lua_Integer end,
+                     size_t* offset);
+
+// Unaligned fixed-width loads/stores in either byte order. With a constant
+// `little` these compile down to a plain load/store plus at most one bswap.
+
+static inline uint8_t load_u8(const uint8_t* p, bool little) {
+  (void)little;
+  return *p;
+}
+
+static inline uint16_t load_u16(const uint8_t* p, bool little) {
+  uint16_t v;
+  memcpy(&v, p, sizeof(v));
+  return little == HOST_LITTLE_ENDIAN ? v : __builtin_bswap16(v);
+}
+
+static inline uint32_t load_u32(const uint8_t* p, bool little) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return little == HOST_LITTLE_ENDIAN ? v : __builtin_bswap32(v);
+}
+
+static inline uint64_t load_u64(const uint8_t* p, bool little) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return little == HOST_LITTLE_ENDIAN ? v : __builtin_bswap64(v);
+}
+
+static inline void store_u8(uint8_t* p, uint8_t v, bool little) {
+  (void)little;
+  *p = v;
+}
+
+static inline void store_u16(uint8_t* p, uint16_t v, bool little) {
+  if (little != HOST_LITTLE_ENDIAN) v = __builtin_bswap16(v);
+  memcpy(p, &v, sizeof(v));
+}
+
+static inline void store_u32(uint8_t* p, uint32_t v, bool little) {
+  if (little != HOST_LITTLE_ENDIAN) v = __builtin_bswap32(v);
+  memcpy(p, &v, sizeof(v));
+}
+
+static inline void store_u64(uint8_t* p, uint64_t v, bool little) {
+  if (little != HOST_LITTLE_ENDIAN) v = __builtin_bswap64(v);
+  memcpy(p, &v, sizeof(v));
+}
+
+// Reverses `n` bytes in place; 2, 4 and 8 bytes are a single bswap.
+static inline void reverse_bytes(uint8_t* b, size_t n) {
+  switch (n) {
+    case 2:
+      store_u16(b, load_u16(b, true), false);
+      return;
+    case 4:
+      store_u32(b, load_u32(b, true), false);
+      return;
+    case 8:
+      store_u64(b, load_u64(b, true), false);
+      return;
+  }
+
+  for (size_t i = 0; i < n / 2; ++i) {
+    uint8_t tmp = b[i];
+    b[i] = b[n - 1 - i];
+    b[n - 1 - i] = tmp;
+  }
+}
+
+// Variable-width (1..8 byte) unsigned load/store, zero-extended. Goes through
+// a 64-bit scratch word so odd widths (24, 48 bit) still cost one bswap.
+
+static inline uint64_t load_uint(const uint8_t* p, size_t n, bool little) {
+  uint8_t tmp[8] = {0};
+  memcpy(little ? tmp : tmp + 8 - n, p, n);
+  return load_u64(tmp, little);
+}
+
+static inline void store_uint(uint8_t* p, uint64_t v, size_t n, bool little) {
+  uint8_t tmp[8];
+  store_u64(tmp, v, little);
+  memcpy(p, little ? tmp : tmp + 8 - n, n);
+}
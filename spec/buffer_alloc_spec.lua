@@ -21,6 +21,71 @@ describe("Buffer allocation", function()
     it("throws on too large size", function()
       assert.has_error(function() buffer.alloc(math.maxinteger) end)
     end)
+
+    it("fills with a base64 pattern", function()
+      local buf = buffer.alloc(5, "aGk=", "base64")
+      assert.are.equal(buf:tostring(), "hihih")
+    end)
+
+    it("repeats string and buffer patterns", function()
+      assert.are.equal(buffer.alloc(7, "abc"):tostring(), "abcabca")
+      assert.are.equal(buffer.alloc(2, "abc"):tostring(), "ab")
+      assert.are.equal(buffer.alloc(5, buffer.from("xy")):tostring(), "xyxyx")
+      local big = buffer.alloc(100000, "0123456")
+      assert.are.equal(big:tostring(), string.rep("0123456", 14286):sub(1, 100000))
+    end)
+
+    it("zero-fills with an empty pattern", function()
+      assert.are.equal(buffer.alloc(3, ""):tostring(), "\0\0\0")
+      assert.are.equal(buffer.alloc(3, buffer.alloc(0)):tostring(), "\0\0\0")
+    end)
+
+    it("zero-fills both small and large buffers", function()
+      for _, size in ipairs({ 1, 4096, 4097, 65536 }) do
+        local buf = buffer.alloc(size)
+        assert.are.equal(#buf, size)
+        assert.are.equal(buf[1], 0)
+        assert.are.equal(buf[size], 0)
+      end
+    end)
+  end)
+
+  describe("buf:fill(value, start, end, encoding)", function()
+    it("refills the whole buffer and returns it", function()
+      local buf = buffer.from("hello world")
+      assert.are.equal(buf:fill("ab"), buf)
+      assert.are.equal(buf:tostring(), "abababababa")
+      assert.are.equal(buf:fill(0x41):tostring(), "AAAAAAAAAAA")
+      assert.are.equal(buf:fill(""):tostring(), string.rep("\0", 11))
+    end)
+
+    it("fills a range", function()
+      local buf = buffer.from("..........")
+      buf:fill("xyz", 3, 7)
+      assert.are.equal(buf:tostring(), "..xyzxy...")
+      buf:fill(0x2D, -2)
+      assert.are.equal(buf:tostring(), "..xyzxy.--")
+      buf:fill("#", 9, 3)
+      assert.are.equal(buf:tostring(), "..xyzxy.--")
+    end)
+
+    it("decodes the pattern", function()
+      local buf = buffer.alloc(6)
+      buf:fill("6869", "hex")
+      assert.are.equal(buf:tostring(), "hihihi")
+      buf:fill("aGk=", 1, 3, "base64")
+      assert.are.equal(buf:tostring(), "hihihi")
+    end)
+
+    it("fills from an overlapping view", function()
+      local buf = buffer.from("abcdefgh")
+      buf:fill(buf:slice(2, 4), 3)
+      assert.are.equal(buf:tostring(), "abbcdbcd")
+    end)
+
+    it("rejects other values", function()
+      assert.has_error(function() buffer.alloc(2):fill({}) end)
+    end)
   end)
 
   describe("buffer.allocUnsafe(size)", function()
@@ -56,7 +121,7 @@ describe("Buffer allocation", function()
       end
     end)
 
-    pending("creates buffer from string with base64 encoding", function()
+    it("creates buffer from string with base64 encoding", function()
       local buf = buffer.from("aGVsbG8=", "base64")
       assert.are.equal(#buf, 5)
       local str = "hello"
@@ -65,6 +130,13 @@ describe("Buffer allocation", function()
       end
     end)
 
+    it("round-trips strings on either side of the inline limit", function()
+      for _, size in ipairs({ 4095, 4096, 4097 }) do
+        local str = string.rep("x", size)
+        assert.are.equal(buffer.from(str):tostring(), str)
+      end
+    end)
+
     it("creates buffer from another buffer", function()
       local src = buffer.from("abc")
       local buf = buffer.from(src)
@@ -118,4 +190,101 @@ describe("Buffer allocation", function()
       assert.has_error(function() buffer.from(123) end)
     end)
   end)
+
+  describe("buf:slice([start], [end])", function()
+    it("returns a view over the given inclusive range", function()
+      local buf = buffer.from("abcdef")
+      local view = buf:slice(2, 4)
+      assert.are.equal(#view, 3)
+      assert.are.equal(view:tostring(), "bcd")
+    end)
+
+    it("shares memory with the parent", function()
+      local buf = buffer.from("abcdef")
+      local view = buf:subarray(2, 4)
+      view[1] = string.byte("X")
+      assert.are.equal(buf:tostring(), "aXcdef")
+      buf[4] = string.byte("Y")
+      assert.are.equal(view:tostring(), "XcY")
+    end)
+
+    it("supports negative and out-of-range indexes", function()
+      local buf = buffer.from("abcdef")
+      assert.are.equal(buf:slice(-3):tostring(), "def")
+      assert.are.equal(buf:slice(-3, -2):tostring(), "de")
+      assert.are.equal(#buf:slice(10, 20), 0)
+      assert.are.equal(buf:slice():tostring(), "abcdef")
+    end)
+
+    it("keeps the parent alive while views exist", function()
+      local view
+      do
+        local buf = buffer.from("payload")
+        view = buf:slice(1, 3):slice(2)
+      end
+      collectgarbage()
+      collectgarbage()
+      assert.are.equal(view:tostring(), "ay")
+    end)
+  end)
+
+  describe("concat", function()
+    it("joins buffers and strings", function()
+      local buf = buffer.concat({ buffer.from("ab"), "cd", buffer.alloc(1, 0x65) })
+      assert.are.equal(buf:tostring(), "abcde")
+      assert.are.equal(#buffer.concat({}), 0)
+    end)
+
+    it("truncates or zero-fills to totalLength", function()
+      assert.are.equal(buffer.concat({ "abc", "def" }, 4):tostring(), "abcd")
+      assert.are.equal(buffer.concat({ "ab" }, 4):tostring("hex"), "61620000")
+    end)
+
+    it("rejects other values", function()
+      assert.has_error(function() buffer.concat({ "a", 1 }) end)
+    end)
+  end)
+
+  describe("copy", function()
+    it("copies between buffers and returns the count", function()
+      local src, dst = buffer.from("abcdef"), buffer.from("........")
+      assert.are.equal(src:copy(dst), 6)
+      assert.are.equal(dst:tostring(), "abcdef..")
+      assert.are.equal(src:copy(dst, 7, 2, 4), 2)
+      assert.are.equal(dst:tostring(), "abcdefbc")
+    end)
+
+    it("clamps ranges", function()
+      local src, dst = buffer.from("abcdef"), buffer.from("....")
+      assert.are.equal(src:copy(dst, -2, 4), 2)
+      assert.are.equal(dst:tostring(), "..de")
+      assert.are.equal(src:copy(dst, 9), 0)
+      assert.are.equal(src:copy(dst, 1, 5, 2), 0)
+      assert.are.equal(dst:tostring(), "..de")
+    end)
+
+    it("handles overlapping views", function()
+      local buf = buffer.from("0123456789")
+      assert.are.equal(buf:slice(1, 6):copy(buf:slice(3)), 6)
+      assert.are.equal(buf:tostring(), "0101234589")
+    end)
+  end)
+
+  describe("copyWithin", function()
+    it("moves bytes forwards and backwards", function()
+      local buf = buffer.from("0123456789")
+      assert.are.equal(buf:copyWithin(3, 1, 4), buf)
+      assert.are.equal(buf:tostring(), "0101236789")
+      buf:copyWithin(1, 7)
+      assert.are.equal(buf:tostring(), "6789236789")
+    end)
+
+    it("truncates at the end of the buffer", function()
+      local buf = buffer.from("abcdef")
+      buf:copyWithin(-2, 1)
+      assert.are.equal(buf:tostring(), "abcdab")
+      buf:copyWithin(10, 1)
+      assert.are.equal(buf:tostring(), "abcdab")
+    end)
+  end)
 end)
@@ -0,0 +1,147 @@
+local buffer = require("buffer")
+
+-- The interpreter running the specs, for checks that need their own state.
+local function interpreter()
+  local i = -1
+  while arg and arg[i - 1] do i = i - 1 end
+  return arg and arg[i] or "lua"
+end
+
+local function wait_all(engine)
+  local done = {}
+  while engine:pending() > 0 do
+    for _, c in ipairs(engine:wait()) do
+      done[c.id] = c
+    end
+  end
+  return done
+end
+
+describe("Async buffer I/O", function()
+  local path, engine
+
+  before_each(function()
+    path = os.tmpname()
+    engine = buffer.engine(2)
+  end)
+
+  after_each(function()
+    engine:close()
+    os.remove(path)
+  end)
+
+  it("reports its backend", function()
+    local backend = engine:backend()
+    assert.is_true(backend == "threads" or backend == "io_uring")
+  end)
+
+  it("writes and reads at explicit positions", function()
+    local f = assert(io.open(path, "w+b"))
+
+    local a = engine:pending()
+    local w1 = buffer.from("hello "):writeAsync(engine, f, 0)
+    local w2 = buffer.from("world"):writeAsync(engine, f, 6)
+    assert.are.equal(engine:pending(), a + 2)
+
+    local done = wait_all(engine)
+    assert.are.equal(done[w1].bytes, 6)
+    assert.are.equal(done[w2].bytes, 5)
+
+    local buf = buffer.alloc(16, 0x2E)
+    local r1 = buf:readAsync(engine, f, 6, 1, 5)
+    local r2 = buf:readAsync(engine, f, 0, 7, 10)
+
+    done = wait_all(engine)
+    assert.are.equal(done[r1].bytes, 5)
+    assert.are.equal(done[r2].bytes, 10)
+    assert.are.equal(buf:tostring(), "world.hello worl")
+    f:close()
+  end)
+
+  it("queues requests without a position in file order", function()
+    -- io_uring reads the file position when a request runs instead.
+    if engine:backend() ~= "threads" then return end
+    local pool = buffer.engine(8)
+    local f = assert(io.open(path, "w+b"))
+    local size = 64 * 1024
+
+    for i = 0, 255 do
+      buffer.alloc(size, i):writeAsync(pool, f)
+    end
+    wait_all(pool)
+    assert.are.equal(f:seek("cur"), 256 * size)
+
+    f:seek("set", 0)
+    local bufs = {}
+    for i = 0, 255 do
+      bufs[i] = buffer.alloc(size)
+      bufs[i]:readAsync(pool, f)
+    end
+    wait_all(pool)
+    for i = 0, 255 do
+      assert.are.same(bufs[i], buffer.alloc(size, i))
+    end
+    pool:close()
+    f:close()
+  end)
+
+  it("keeps buffers alive while requests are in flight", function()
+    local f = assert(io.open(path, "w+b"))
+    f:write(string.rep("x", 1 << 16))
+    f:flush()
+
+    for i = 1, 16 do
+      buffer.alloc(1 << 16):readAsync(engine, f, 0)
+    end
+    collectgarbage()
+    collectgarbage()
+
+    local total = 0
+    for _, c in pairs(wait_all(engine)) do
+      total = total + c.bytes
+    end
+    assert.are.equal(total, 16 << 16)
+    f:close()
+  end)
+
+  it("returns errors per request", function()
+    local id = buffer.alloc(4):readAsync(engine, 1000000, 0)
+    local c = wait_all(engine)[id]
+    assert.is_nil(c.bytes)
+    assert.is_string(c.error)
+    assert.is_number(c.errno)
+  end)
+
+  it("drains pending requests when the state is closed", function()
+    -- The buffers are created after the engine, so lua_close finalizes them
+    -- first while the worker is still reading into them.
+    local script = os.tmpname()
+    local f = assert(io.open(script, "w"))
+    f:write(string.format([[
+      package.cpath = %q
+      local buffer = require("buffer")
+      local engine = buffer.engine(1)
+      local src = assert(io.open("/dev/zero", "rb"))
+      for _ = 1, 4 do
+        buffer.allocUnsafe(40 << 20):readAsync(engine, src, 0)
+      end
+    ]], package.cpath))
+    f:close()
+
+    local ok, how, code = os.execute(interpreter() .. " " .. script)
+    os.remove(script)
+    assert.are.same({ true, "exit", 0 }, { ok, how, code })
+  end)
+
+  it("poll does not block and close drains the queue", function()
+    assert.are.same(engine:poll(), {})
+    assert.are.same(engine:wait(), {})
+    assert.has_error(function() buffer.alloc(4):readAsync(engine, 1, 0, 2, 4) end)
+
+    local f = assert(io.open(path, "w+b"))
+    buffer.alloc(8):writeAsync(engine, f, 0)
+    engine:close()
+    assert.has_error(function() engine:poll() end)
+    f:close()
+  end)
+end)
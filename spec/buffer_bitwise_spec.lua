@@ -0,0 +1,94 @@
+local buffer = require("buffer")
+
+local function ref(s, mask, op)
+  local out = {}
+  for i = 1, #s do
+    local m = mask:byte((i - 1) % #mask + 1)
+    out[i] = string.char(op(s:byte(i), m))
+  end
+  return table.concat(out)
+end
+
+local function random_bytes(n)
+  local t = {}
+  for i = 1, n do t[i] = string.char(math.random(0, 255)) end
+  return table.concat(t)
+end
+
+describe("Buffer bitwise ops", function()
+  it("unmasks a WebSocket payload with a 4-byte key", function()
+    local key = "\x37\xfa\x21\x3d"
+    local masked = buffer.from("Hello"):xor(key)
+    assert.are.equal(masked:tostring("hex"), "7f9f4d5158")
+    assert.are.equal(masked:xor(key):tostring(), "Hello")
+  end)
+
+  it("matches a byte-by-byte reference", function()
+    math.randomseed(7)
+    for _, n in ipairs({ 1, 7, 31, 32, 33, 100, 257, 1000 }) do
+      local data = random_bytes(n)
+      for _, mlen in ipairs({ 1, 3, 4, 64, 129, n }) do
+        local mask = random_bytes(mlen)
+        assert.are.equal(buffer.from(data):xor(mask):tostring(), ref(data, mask, function(a, b) return a ~ b end))
+        assert.are.equal(buffer.from(data):band(mask):tostring(), ref(data, mask, function(a, b) return a & b end))
+        assert.are.equal(buffer.from(data):bor(buffer.from(mask)):tostring(), ref(data, mask, function(a, b) return a | b end))
+      end
+      assert.are.equal(buffer.from(data):bnot():tostring(), ref(data, "\xff", function(a, b) return a ~ b end))
+    end
+  end)
+
+  it("takes a byte operand and a range", function()
+    local buf = buffer.from("abcdef")
+    assert.are.equal(buf:xor(0x20, 2, 4), buf)
+    assert.are.equal(buf:tostring(), "aBCDef")
+    assert.are.equal(buf:bor(0x20, -2):tostring(), "aBCDef")
+    assert.are.equal(buf:band(0xDF, -2):tostring(), "aBCDEF")
+    assert.are.equal(buf:bnot(1, 1):bnot(1, 1):tostring(), "aBCDEF")
+  end)
+
+  it("writes to a target without touching the source", function()
+    local src = buffer.from("\x0f\xf0\xff")
+    local out = buffer.alloc(4, 0xAA)
+    assert.are.equal(src:bnot(nil, nil, out), out)
+    assert.are.equal(out:tostring("hex"), "f00f00aa")
+    assert.are.equal(src:tostring("hex"), "0ff0ff")
+    src:xor("\x01", 2, 3, out)
+    assert.are.equal(out:tostring("hex"), "f1fe00aa")
+    assert.has_error(function() src:xor(1, 1, 3, buffer.alloc(2)) end)
+  end)
+
+  it("writes to a target overlapping the source", function()
+    local data = random_bytes(80)
+    local mask = random_bytes(5)
+    local xor = function(a, b) return a ~ b end
+    local buf = buffer.from(data)
+    buf:xor(1, 1, 40, buf:subarray(2))
+    assert.are.equal(buf:tostring(), data:sub(1, 1) .. ref(data:sub(1, 40), "\1", xor) .. data:sub(42))
+    buf = buffer.from(data)
+    buf:xor(mask, 3, 80, buf)
+    assert.are.equal(buf:tostring(), ref(data:sub(3), mask, xor) .. data:sub(-2))
+  end)
+
+  it("uses the source itself as a mask", function()
+    local buf = buffer.from(random_bytes(300))
+    assert.are.equal(buf:xor(buf):popcount(), 0)
+  end)
+
+  it("rejects empty operands", function()
+    assert.has_error(function() buffer.from("ab"):xor("") end)
+    assert.are.equal(buffer.alloc(0):xor(""):tostring(), "")
+  end)
+end)
+
+describe("Buffer popcount", function()
+  it("counts set bits", function()
+    assert.are.equal(buffer.from("\xff\x01\x80\x00"):popcount(), 10)
+    assert.are.equal(buffer.from("\xff\x01\x80\x00"):popcount(2, 3), 2)
+    assert.are.equal(buffer.alloc(0):popcount(), 0)
+  end)
+
+  it("counts large buffers", function()
+    assert.are.equal(buffer.alloc(5000, 0xFF):popcount(), 40000)
+    assert.are.equal(buffer.alloc(4097, 0x11):popcount(2), 8192)
+  end)
+end)
@@ -0,0 +1,38 @@
+local buffer = require("buffer")
+
+describe("Buffer checksums", function()
+  local check = buffer.from("123456789")
+
+  it("matches the standard check values", function()
+    assert.are.equal(check:crc32(), 0xCBF43926)
+    assert.are.equal(check:crc32c(), 0xE3069283)
+    assert.are.equal(buffer.from("Wikipedia"):adler32(), 0x11E60398)
+  end)
+
+  it("handles empty input", function()
+    local empty = buffer.alloc(0)
+    assert.are.equal(empty:crc32(), 0)
+    assert.are.equal(empty:crc32c(), 0)
+    assert.are.equal(empty:adler32(), 1)
+  end)
+
+  it("checksums a range", function()
+    local framed = buffer.from("##123456789##")
+    assert.are.equal(framed:crc32(3, 11), 0xCBF43926)
+    assert.are.equal(framed:crc32c(3, -3), 0xE3069283)
+  end)
+
+  it("continues from a seed across chunks", function()
+    local parts = {}
+    for i = 1, 500 do parts[i] = string.char(i % 256, (i * 7) % 256) end
+    local data = buffer.from(table.concat(parts))
+
+    for _, method in ipairs({ "crc32", "crc32c", "adler32" }) do
+      local whole = data[method](data)
+      for _, cut in ipairs({ 1, 63, 64, 65, 500, 999 }) do
+        local first = data[method](data, 1, cut)
+        assert.are.equal(data[method](data, cut + 1, #data, first), whole)
+      end
+    end
+  end)
+end)
@@ -0,0 +1,69 @@
+local buffer = require("buffer")
+
+describe("Buffer compare", function()
+  it("orders buffers and strings", function()
+    local a, b = buffer.from("apple"), buffer.from("apply")
+    assert.are.same({ buffer.compare(a, b) }, { -1, 5 })
+    assert.are.same({ buffer.compare(b, a) }, { 1, 5 })
+    assert.are.same({ buffer.compare(a, "apple") }, { 0, nil })
+    assert.are.same({ buffer.compare("app", a) }, { -1, 4 })
+    assert.are.same({ buffer.compare(a, "") }, { 1, 1 })
+  end)
+
+  it("sorts keys", function()
+    local keys = { buffer.from("b"), buffer.from("ab"), buffer.from("a"), buffer.from("\xff") }
+    table.sort(keys, function(x, y)
+      return buffer.compare(x, y) < 0
+    end)
+    assert.are.same({ "a", "ab", "b", "\xff" }, {
+      keys[1]:tostring(), keys[2]:tostring(), keys[3]:tostring(), keys[4]:tostring(),
+    })
+  end)
+
+  it("finds the first difference in long inputs", function()
+    local base = string.rep("0123456789abcdef", 20)
+    for _, at in ipairs({ 1, 31, 32, 33, 64, 65, 100, 319, 320 }) do
+      local other = base:sub(1, at - 1) .. "#" .. base:sub(at + 1)
+      local order, where = buffer.compare(buffer.from(base), buffer.from(other))
+      assert.are.equal(where, at)
+      assert.are.equal(order, 1)
+    end
+  end)
+
+  it("compares sub-ranges as a method", function()
+    local buf = buffer.from("xxhelloyy")
+    assert.are.same({ buf:compare("hello", 1, 5, 3, 7) }, { 0, nil })
+    assert.are.same({ buf:compare("help", nil, nil, 3, 7) }, { -1, 4 })
+  end)
+end)
+
+describe("Buffer equals", function()
+  local buf = buffer.from("xxhelloyy")
+
+  it("compares whole buffers", function()
+    assert.is_true(buf:equals(buffer.from("xxhelloyy")))
+    assert.is_false(buf:equals("xxhello"))
+  end)
+
+  it("compares ranges without slicing", function()
+    assert.is_true(buf:equals("hello", 1, 5, 3, 7))
+    assert.is_true(buf:equals("--hello--", 3, 7, 3, 7))
+    assert.is_true(buf:equals("yy", nil, nil, -2))
+    assert.is_false(buf:equals("hellO", 1, 5, 3, 7))
+    assert.is_true(buf:equals("", 1, 0, 5, 4))
+  end)
+end)
+
+describe("timingSafeEqual", function()
+  it("compares equal-length inputs", function()
+    assert.is_true(buffer.timingSafeEqual(buffer.from("secret"), "secret"))
+    assert.is_false(buffer.timingSafeEqual(buffer.from("secret"), "secreT"))
+    assert.is_true(buffer.timingSafeEqual("", buffer.alloc(0)))
+  end)
+
+  it("rejects inputs of different lengths", function()
+    assert.has_error(function()
+      buffer.timingSafeEqual("a", "ab")
+    end)
+  end)
+end)
@@ -0,0 +1,96 @@
+local buffer = require("buffer")
+
+describe("Buffer cursors", function()
+  it("reads fields in sequence", function()
+    local buf = buffer.from("0102030405060708090a0b", "hex")
+    local r = buf:reader()
+
+    assert.are.equal(r:u8(), 0x01)
+    assert.are.equal(r:u16be(), 0x0203)
+    assert.are.equal(r:u32le(), 0x07060504)
+    assert.are.equal(r:tell(), 8)
+    assert.are.equal(r:remaining(), 4)
+    assert.are.equal(r:bytes(2), "\8\9")
+    assert.are.equal(r:skip(1):u8(), 0x0b)
+    assert.are.equal(r:remaining(), 0)
+  end)
+
+  it("starts at the given offset and can seek", function()
+    local buf = buffer.from({ 0xFF, 0xFE, 0x80 })
+    local r = buf:reader(2)
+
+    assert.are.equal(r:i8(), -2)
+    r:seek(1)
+    assert.are.equal(r:i16le(), -257)
+    assert.has_error(function() r:seek(5) end)
+    assert.has_error(function() buf:reader(5) end)
+  end)
+
+  it("refuses to read past the end", function()
+    local r = buffer.alloc(3):reader()
+    assert.has_error(function() r:u32le() end)
+    assert.are.equal(r:tell(), 1)
+    assert.has_error(function() r:bytes(4) end)
+  end)
+
+  it("writes into an existing buffer", function()
+    local buf = buffer.alloc(14)
+    local w = buf:writer()
+
+    w:u16le(0x0102):i32be(-2):f64le(1.5)
+    assert.are.equal(w:remaining(), 0)
+    assert.has_error(function() w:u8(0) end)
+
+    local r = buf:reader()
+    assert.are.equal(r:u16le(), 0x0102)
+    assert.are.equal(r:i32be(), -2)
+    assert.are.equal(r:f64le(), 1.5)
+    assert.has_error(function() w:finish() end)
+  end)
+
+  it("grows on demand and hands its storage to a buffer", function()
+    local w = buffer.writer(2)
+
+    for i = 1, 1000 do
+      w:u32be(i)
+    end
+    w:bytes("end"):skip(2)
+
+    local buf = w:finish()
+    assert.are.equal(#buf, 4005)
+    assert.are.equal(buf:readUInt32BE(4 * 999 + 1), 1000)
+    assert.are.equal(buf:tostring("utf8", 4001, 4003), "end")
+    assert.are.equal(buf:readUInt16LE(4004), 0)
+
+    assert.are.equal(#w:finish(), 0)
+    assert.are.equal(#w:u8(7):finish(), 1)
+  end)
+
+  it("accepts buffers in bytes()", function()
+    local w = buffer.writer()
+    w:bytes(buffer.from("abc")):bytes("def")
+    assert.are.equal(w:finish():tostring(), "abcdef")
+  end)
+
+  it("builds messages with append", function()
+    local b = buffer.builder(4)
+
+    b:append("GET"):append(0x20, "u8"):append(buffer.from("/"))
+    b:append(-1, "i16be"):append(0.5, "f32le")
+    assert.has_error(function() b:append(1) end)
+    assert.has_error(function() b:append(1, "u128") end)
+
+    local msg = b:finish()
+    assert.are.equal(#msg, 3 + 1 + 1 + 2 + 4)
+    assert.are.equal(msg:tostring("utf8", 1, 5), "GET /")
+    assert.are.equal(msg:readInt16BE(6), -1)
+    assert.are.equal(msg:readFloatLE(8), 0.5)
+  end)
+
+  it("reserve makes room without advancing", function()
+    local b = buffer.builder(0)
+    b:reserve(1000)
+    assert.are.equal(b:tell(), 1)
+    assert.is_true(b:remaining() >= 1000)
+  end)
+end)
@@ -0,0 +1,71 @@
+local buffer = require("buffer")
+
+-- Reference values from the xxHash command line / python-xxhash (XXH3).
+local function hex64(x)
+  return string.format("%016x", x)
+end
+
+describe("Buffer hashing", function()
+  local seq = {}
+  for i = 0, 511 do seq[#seq + 1] = string.char(i % 256) end
+  local long = buffer.from(table.concat(seq))
+
+  it("matches XXH3 64-bit", function()
+    assert.are.equal(hex64(buffer.alloc(0):hash64()), "2d06800538d394c2")
+    assert.are.equal(hex64(buffer.from("abc"):hash64()), "78af5f94892f3950")
+    assert.are.equal(hex64(buffer.from("hello world"):hash64(42)), "972a5725e93d338e")
+    assert.are.equal(hex64(long:hash64(7)), "82381142f3703860")
+  end)
+
+  it("matches XXH3 128-bit", function()
+    local lo, hi = buffer.from("abc"):hash128()
+    assert.are.equal(hex64(hi) .. hex64(lo), "06b05ab6733a618578af5f94892f3950")
+    lo, hi = buffer.alloc(0):hash128()
+    assert.are.equal(hex64(hi) .. hex64(lo), "99aa06d3014798d86001c324468d497f")
+    lo, hi = long:hash128(7)
+    assert.are.equal(hex64(hi) .. hex64(lo), "9e063ecfe8ec33e082381142f3703860")
+  end)
+
+  it("hashes a range without copying", function()
+    local framed = buffer.from("--abc--")
+    assert.are.equal(framed:hash64(0, 3, 5), buffer.from("abc"):hash64())
+    assert.are.equal(framed:hash64(5, -5, -3), buffer.from("abc"):hash64(5))
+  end)
+
+  it("distinguishes seeds and lengths", function()
+    local a = buffer.from("payload")
+    assert.are_not.equal(a:hash64(1), a:hash64(2))
+    assert.are_not.equal(a:hash64(), a:hash64(0, 1, 6))
+  end)
+end)
+
+describe("Buffer hasher", function()
+  local parts = {}
+  for i = 1, 400 do parts[i] = string.format("chunk %d;", i) end
+  local whole = buffer.from(table.concat(parts))
+
+  it("matches the one-shot hashes across chunk boundaries", function()
+    local h = buffer.hasher(99)
+    for i = 1, #parts do
+      h:update(i % 2 == 0 and parts[i] or buffer.from(parts[i]))
+    end
+    assert.are.equal(h:digest(), whole:hash64(99))
+    local lo, hi = whole:hash128(99)
+    assert.are.same({ h:digest128() }, { lo, hi })
+  end)
+
+  it("handles short inputs and empty updates", function()
+    local h = buffer.hasher():update(""):update("ab"):update(""):update("c")
+    assert.are.equal(h:digest(), buffer.from("abc"):hash64())
+    assert.are.equal(buffer.hasher():digest(), buffer.alloc(0):hash64())
+  end)
+
+  it("can digest repeatedly and be reset", function()
+    local h = buffer.hasher():update(whole)
+    assert.are.equal(h:digest(), h:digest())
+    h:update("more")
+    assert.are_not.equal(h:digest(), whole:hash64())
+    assert.are.equal(h:reset():update(whole):digest(), whole:hash64())
+    assert.are.equal(h:reset(5):update("abc"):digest(), buffer.from("abc"):hash64(5))
+  end)
+end)
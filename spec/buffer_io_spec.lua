@@ -0,0 +1,69 @@
+local buffer = require("buffer")
+
+local function read_file(path)
+  local f = assert(io.open(path, "rb"))
+  local data = f:read("a")
+  f:close()
+  return data
+end
+
+describe("Buffer file I/O", function()
+  local path
+
+  before_each(function()
+    path = os.tmpname()
+  end)
+
+  after_each(function()
+    os.remove(path)
+  end)
+
+  it("writes a range to a file handle", function()
+    local f = assert(io.open(path, "wb"))
+    local buf = buffer.from("hello world")
+    assert.are.equal(buf:writeTo(f), 11)
+    assert.are.equal(buf:writeTo(f, 1, 5), 5)
+    f:close()
+    assert.are.equal(read_file(path), "hello worldhello")
+  end)
+
+  it("reads into the buffer at an offset", function()
+    local f = assert(io.open(path, "wb"))
+    f:write("abcdef")
+    f:close()
+
+    f = assert(io.open(path, "rb"))
+    local buf = buffer.alloc(8, 0x2E)
+    assert.are.equal(buf:readFrom(f, 3, 4), 4)
+    assert.are.equal(buf:tostring(), "..abcd..")
+    assert.are.equal(buf:readFrom(f, 1), 2)
+    assert.are.equal(buf:readFrom(f), 0)
+    assert.are.equal(buf:readFrom(f, 1, 3, 1), 3)
+    assert.are.equal(buf:tostring(), "bcdbcd..")
+    f:close()
+
+    assert.has_error(function() buf:readFrom(f) end)
+    assert.has_error(function() buf:readFrom(io.stdin, 7, 4) end)
+  end)
+
+  it("gathers and scatters buffer lists", function()
+    local f = assert(io.open(path, "w+b"))
+    assert.are.equal(buffer.writev(f, { buffer.from("abc"), "", "de" }), 5)
+    f:flush()
+
+    local a, b = buffer.alloc(2), buffer.alloc(4)
+    assert.are.equal(buffer.readv(f, { a, b }, 0), 5)
+    assert.are.equal(a:tostring(), "ab")
+    assert.are.equal(b:tostring("utf8", 1, 3), "cde")
+    f:close()
+
+    assert.has_error(function() buffer.readv(io.stdin, { "x" }) end)
+  end)
+
+  it("reports errors on bad descriptors", function()
+    local n, err, code = buffer.alloc(4):writeTo(1000000)
+    assert.is_nil(n)
+    assert.is_string(err)
+    assert.is_number(code)
+  end)
+end)
@@ -0,0 +1,71 @@
+local buffer = require("buffer")
+
+describe("Buffer layouts", function()
+  it("reports the record size", function()
+    assert.are.equal(#buffer.compile("<I2 i4 d c3 x"), 2 + 4 + 8 + 3 + 1)
+    assert.are.equal(#buffer.compile(""), 0)
+  end)
+
+  it("rejects invalid formats", function()
+    assert.has_error(function() buffer.compile("q") end)
+    assert.has_error(function() buffer.compile("i9") end)
+    assert.has_error(function() buffer.compile("c") end)
+    assert.has_error(function() buffer.compile("f2") end)
+  end)
+
+  it("packs and unpacks a record", function()
+    local rec = buffer.compile("<H i3 >I4 f8 c4 x2 b")
+    local buf = buffer.alloc(#rec + 1)
+
+    assert.are.equal(rec:pack(buf, 2, 0xBEEF, -5, 0x01020304, 1.5, "ab", -1), 2 + #rec)
+    assert.are.equal(buf:readUInt32BE(7), 0x01020304)
+
+    local a, b, c, d, e, f, nxt = rec:unpack(buf, 2)
+    assert.are.equal(a, 0xBEEF)
+    assert.are.equal(b, -5)
+    assert.are.equal(c, 0x01020304)
+    assert.are.equal(d, 1.5)
+    assert.are.equal(e, "ab\0\0")
+    assert.are.equal(f, -1)
+    assert.are.equal(nxt, 2 + #rec)
+  end)
+
+  it("matches string.pack", function()
+    local fmt = "<i2 I4 >j d"
+    local rec = buffer.compile(fmt)
+    local buf = buffer.from(string.pack(fmt, -2, 7, -3, 0.25))
+    local a, b, c, d = rec:unpack(buf)
+    assert.are.same({ a, b, c, d }, { -2, 7, -3, 0.25 })
+  end)
+
+  it("unpacks many records into columns", function()
+    local rec = buffer.compile("<B x h")
+    local buf = buffer.alloc(#rec * 3)
+    local offset = 1
+    for i = 1, 3 do
+      offset = rec:pack(buf, offset, i, -i * 100)
+    end
+
+    local cols, nxt = rec:unpackMany(buf, 1, 3)
+    assert.are.same(cols[1], { 1, 2, 3 })
+    assert.are.same(cols[2], { -100, -200, -300 })
+    assert.are.equal(nxt, #buf + 1)
+  end)
+
+  it("bounds checks the whole run", function()
+    local rec = buffer.compile("I4")
+    local buf = buffer.alloc(10)
+    assert.has_error(function() rec:unpack(buf, 8) end)
+    assert.has_error(function() rec:unpackMany(buf, 1, 3) end)
+    assert.has_error(function() rec:pack(buf, 9, 1) end)
+  end)
+
+  it("leaves the record untouched when an argument is bad", function()
+    local rec = buffer.compile("<I2 c2 I2")
+    local buf = buffer.alloc(6)
+    assert.has_error(function() rec:pack(buf, 1, 7, "abc", 9) end)
+    assert.has_error(function() rec:pack(buf, 1, 7, "ab", "x") end)
+    assert.has_error(function() rec:pack(buf, 1, 7, "ab", 1e20) end)
+    assert.are.equal(buf:tostring("hex"), "000000000000")
+  end)
+end)
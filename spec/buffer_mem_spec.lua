@@ -0,0 +1,88 @@
+local buffer = require("buffer")
+
+describe("Buffer payload pool", function()
+  after_each(function()
+    buffer.poolLimit(0)
+    buffer.poolTrim()
+  end)
+
+  it("is disabled by default", function()
+    assert.are.equal(buffer.poolStats().limit, 0)
+  end)
+
+  it("poolLimit returns the previous limit", function()
+    assert.are.equal(buffer.poolLimit(1024 * 1024), 0)
+    assert.are.equal(buffer.poolLimit(), 1024 * 1024)
+    assert.has_error(function() buffer.poolLimit(-1) end)
+  end)
+
+  it("recycles blocks released by __gc", function()
+    buffer.poolLimit(1024 * 1024)
+
+    do
+      local _ = buffer.allocUnsafe(1000)
+    end
+    collectgarbage()
+    collectgarbage()
+
+    local stats = buffer.poolStats()
+    assert.are.equal(stats.classes[1024], 1)
+    assert.are.equal(stats.cached, 1024)
+
+    local buf = buffer.allocUnsafe(600)
+    assert.are.equal(#buf, 600)
+    assert.are.equal(buffer.poolStats().hits, stats.hits + 1)
+    assert.are.equal(buffer.poolStats().cached, 0)
+  end)
+
+  it("zero-fills recycled blocks for alloc", function()
+    buffer.poolLimit(1024 * 1024)
+
+    do
+      local _ = buffer.alloc(256, 0xFF)
+    end
+    collectgarbage()
+    collectgarbage()
+
+    local buf = buffer.alloc(256)
+    for i = 1, #buf do
+      assert.are.equal(buf[i], 0)
+    end
+  end)
+
+  it("poolTrim empties the freelists", function()
+    buffer.poolLimit(1024 * 1024)
+
+    do
+      local _ = buffer.alloc(64) .. buffer.alloc(64)
+    end
+    collectgarbage()
+    collectgarbage()
+
+    assert.is_true(buffer.poolTrim() > 0)
+    assert.are.equal(buffer.poolStats().cached, 0)
+  end)
+end)
+
+describe("buffer.externalMemory()", function()
+  it("tracks large payloads until they are collected", function()
+    collectgarbage()
+    collectgarbage()
+    local before = buffer.externalMemory()
+
+    local buf = buffer.alloc(1024 * 1024)
+    assert.are.equal(buffer.externalMemory(), before + #buf)
+
+    buf = nil
+    collectgarbage()
+    collectgarbage()
+    assert.are.equal(buffer.externalMemory(), before)
+  end)
+
+  it("does not count inline payloads", function()
+    local before = buffer.externalMemory()
+    local buf = buffer.alloc(16)
+    assert.are.equal(#buf, 16)
+    assert.are.equal(buffer.externalMemory(), before)
+  end)
+end)
@@ -0,0 +1,72 @@
+local buffer = require("buffer")
+
+local function write_file(path, data)
+  local f = assert(io.open(path, "wb"))
+  f:write(data)
+  f:close()
+end
+
+local function read_file(path)
+  local f = assert(io.open(path, "rb"))
+  local data = f:read("a")
+  f:close()
+  return data
+end
+
+describe("Memory-mapped buffers", function()
+  local path
+
+  before_each(function()
+    path = os.tmpname()
+    write_file(path, "\1\2\3\4hello world")
+  end)
+
+  after_each(function()
+    collectgarbage()
+    os.remove(path)
+  end)
+
+  it("maps a whole file read-only", function()
+    local buf = buffer.mmap(path)
+    assert.are.equal(#buf, 15)
+    assert.are.equal(buf:readUInt32BE(), 0x01020304)
+    assert.are.equal(buf:tostring("utf8", 5), "hello world")
+  end)
+
+  it("keeps private writes out of the file", function()
+    local buf = buffer.mmap(path, "r")
+    buf:writeUInt8(0xFF, 1)
+    assert.are.equal(buf:readUInt8(1), 0xFF)
+    assert.are.equal(read_file(path):byte(1), 1)
+  end)
+
+  it("writes through shared mappings", function()
+    local buf = buffer.mmap(path, "rw", 3, 5)
+    assert.are.equal(buf:tostring(), "\4hell")
+    buf:write("HELL", 2)
+    assert.is_true(buf:sync())
+    assert.are.equal(read_file(path), "\1\2\3\4HELLo world")
+  end)
+
+  it("accepts access pattern hints", function()
+    local buf = buffer.mmap(path)
+    assert.is_true(buf:advise("sequential"))
+    assert.is_true(buf:slice(5):advise("willneed"))
+    assert.has_error(function() buf:advise("sometimes") end)
+    assert.has_error(function() buffer.alloc(4):advise("random") end)
+  end)
+
+  it("validates the requested range", function()
+    assert.has_error(function() buffer.mmap(path, "r", 16) end)
+    assert.has_error(function() buffer.mmap(path, "r", 0, 16) end)
+    assert.has_error(function() buffer.mmap(path, "x") end)
+    assert.are.equal(#buffer.mmap(path, "r", 15), 0)
+  end)
+
+  it("reports missing files like io.open", function()
+    local buf, err, code = buffer.mmap(path .. ".missing")
+    assert.is_nil(buf)
+    assert.is_string(err)
+    assert.is_number(code)
+  end)
+end)
@@ -99,9 +99,217 @@ describe("Buffer read/write methods", function()
       buf:writeInt16BE(-32768, 1)
       assert.are.equal(buf:readInt16BE(1), -32768)
     end)
+
+    it("stores Int16LE in little-endian order", function()
+      local buf = buffer.alloc(2)
+      buf:writeInt16LE(0x0102)
+      assert.are.equal(buf:tostring("hex"), "0201")
+    end)
+
+    it("writes and reads 8-bit values", function()
+      local buf = buffer.alloc(2)
+      assert.are.equal(buf:writeUInt8(0xFF, 1), 2)
+      buf:writeInt8(-128, 2)
+      assert.are.equal(buf:readUInt8(1), 0xFF)
+      assert.are.equal(buf:readInt8(1), -1)
+      assert.are.equal(buf:readInt8(2), -128)
+    end)
+
+    it("writes and reads the rest of the 16/32-bit matrix", function()
+      local buf = buffer.alloc(4)
+
+      buf:writeUInt16BE(0xABCD)
+      assert.are.equal(buf:readUInt16BE(), 0xABCD)
+      assert.are.equal(buf:readUInt16LE(), 0xCDAB)
+
+      buf:writeInt32LE(-2)
+      assert.are.equal(buf:readInt32LE(), -2)
+      assert.are.equal(buf:readUInt32LE(), 0xFFFFFFFE)
+
+      buf:writeInt32BE(-0x12345678)
+      assert.are.equal(buf:readInt32BE(), -0x12345678)
+    end)
+
+    it("maps 64-bit values onto Lua integers", function()
+      local buf = buffer.alloc(8)
+
+      assert.are.equal(buf:writeBigInt64LE(math.mininteger), 9)
+      assert.are.equal(buf:readBigInt64LE(), math.mininteger)
+
+      buf:writeBigInt64BE(0x0102030405060708)
+      assert.are.equal(buf:tostring("hex"), "0102030405060708")
+      assert.are.equal(buf:readBigUInt64BE(), 0x0102030405060708)
+      assert.are.equal(buf:readBigInt64LE(), 0x0807060504030201)
+
+      buf:writeBigUInt64LE(-1)
+      assert.are.equal(buf:readBigUInt64LE(), -1)
+    end)
+
+    it("writes and reads variable-width integers", function()
+      local buf = buffer.alloc(6)
+
+      assert.are.equal(buf:writeUIntLE(0x123456, 1, 3), 4)
+      assert.are.equal(buf:tostring("hex", 1, 3), "563412")
+      assert.are.equal(buf:readUIntLE(1, 3), 0x123456)
+
+      buf:writeIntBE(-0x123456789A, 1, 6)
+      assert.are.equal(buf:readIntBE(1, 6), -0x123456789A)
+      assert.are.equal(buf:readUIntBE(1, 6), 0x1000000000000 - 0x123456789A)
+
+      buf:writeIntLE(-1, 1, 3)
+      assert.are.equal(buf:readIntLE(1, 3), -1)
+      assert.are.equal(buf:readUIntLE(1, 3), 0xFFFFFF)
+
+      assert.has_error(function() buf:readUIntLE(1, 9) end)
+      assert.has_error(function() buf:readUIntLE(5, 3) end)
+    end)
+  end)
+
+  describe("bulk array operations", function()
+    it("writes and reads Int16LE arrays", function()
+      local buf = buffer.alloc(8)
+      local next_offset = buf:writeInt16LEArray({ 1, -2, 32767, -32768 })
+      assert.are.equal(next_offset, 9)
+      assert.are.same(buf:readInt16LEArray(), { 1, -2, 32767, -32768 })
+      assert.are.equal(buf:readInt16LE(3), -2)
+    end)
+
+    it("matches the single-value accessors for every type", function()
+      local cases = {
+        { "UInt8", 1, { 0, 0x7F, 0xFF } },
+        { "Int8", 1, { -1, 127, -128 } },
+        { "UInt16LE", 2, { 0, 1, 0xFFFF } },
+        { "Int16BE", 2, { -1, 2, -32768 } },
+        { "UInt32LE", 4, { 0, 0x12345678, 0xFFFFFFFF } },
+        { "UInt32BE", 4, { 1, 0x89ABCDEF, 7 } },
+        { "FloatLE", 4, { 0.5, -2.25, 1024 } },
+        { "FloatBE", 4, { 0.5, -2.25, 1024 } },
+        { "BigUInt64LE", 8, { 0, 0x123456789ABCDEF, -1 } },
+        { "BigUInt64BE", 8, { 1, math.maxinteger, math.mininteger } },
+        { "DoubleLE", 8, { 1.5, -1e300, 3.25 } },
+        { "DoubleBE", 8, { 1.5, -1e300, 3.25 } },
+      }
+
+      for _, case in ipairs(cases) do
+        local name, width, values = case[1], case[2], case[3]
+        local buf = buffer.alloc(width * #values + 1)
+        buf["write" .. name .. "Array"](buf, values, 2)
+
+        local got = buf["read" .. name .. "Array"](buf, 2, #values)
+        assert.are.same(got, values)
+        for i, v in ipairs(values) do
+          assert.are.equal(buf["read" .. name](buf, 2 + (i - 1) * width), v)
+        end
+      end
+    end)
+
+    it("supports partial ranges", function()
+      local buf = buffer.alloc(8)
+      buf:writeUInt16LEArray({ 10, 20, 30, 40 }, 3, 2, 3)
+      assert.are.same(buf:readUInt16LEArray(1), { 0, 20, 30, 0 })
+      assert.are.same(buf:readUInt16LEArray(3, 1), { 20 })
+      assert.are.same(buf:readUInt16LEArray(9), {})
+    end)
+
+    it("checks bounds and element types", function()
+      local buf = buffer.alloc(4)
+      assert.has_error(function() buf:writeUInt32LEArray({ 1, 2 }) end)
+      assert.has_error(function() buf:readUInt16LEArray(1, 3) end)
+      assert.has_error(function() buf:readUInt16LEArray(0) end)
+      assert.has_error(function() buf:writeUInt16LEArray({ 1, "x" }) end)
+    end)
+  end)
+
+  describe("varints", function()
+    local cases = {
+      { 0, "00" },
+      { 1, "01" },
+      { 127, "7f" },
+      { 128, "8001" },
+      { 300, "ac02" },
+      { math.maxinteger, "ffffffffffffffff7f" },
+      { -1, "ffffffffffffffffff01" },
+    }
+
+    it("encodes and decodes LEB128", function()
+      for _, case in ipairs(cases) do
+        local value, hex = case[1], case[2]
+        local buf = buffer.alloc(#hex // 2 + 2)
+        assert.are.equal(buf:writeVarUInt(value, 2), #hex // 2 + 2)
+        assert.are.equal(buf:tostring("hex", 2, #hex // 2 + 1), hex)
+        assert.are.same({ buf:readVarUInt(2) }, { value, #hex // 2 + 2 })
+      end
+    end)
+
+    it("zigzag-encodes signed values", function()
+      local buf = buffer.alloc(10)
+      for _, pair in ipairs({ { 0, "00" }, { -1, "01" }, { 1, "02" }, { -64, "7f" }, { 64, "8001" } }) do
+        local next_offset = buf:writeVarInt(pair[1])
+        assert.are.equal(buf:tostring("hex", 1, next_offset - 1), pair[2])
+        assert.are.equal((buf:readVarInt()), pair[1])
+      end
+      buf:writeVarInt(math.mininteger)
+      assert.are.equal((buf:readVarInt()), math.mininteger)
+    end)
+
+    it("rejects truncated and overlong input", function()
+      assert.has_error(function() buffer.from("\x80\x80"):readVarUInt() end)
+      assert.has_error(function() buffer.from(string.rep("\xff", 10) .. "\x01"):readVarUInt() end)
+      assert.has_error(function() buffer.from("ffffffffffffffffff7f", "hex"):readVarUInt() end)
+      assert.has_error(function() buffer.from("ffffffffffffffffff02", "hex"):readVarUIntArray() end)
+      assert.are.equal((buffer.from("ffffffffffffffffff01", "hex"):readVarUInt()), -1)
+      assert.has_error(function() buffer.alloc(1):writeVarUInt(300) end)
+      assert.has_error(function() buffer.alloc(1):readVarUInt(2) end)
+    end)
+
+    it("decodes packed runs in one call", function()
+      local values = {}
+      for i = 1, 200 do
+        values[i] = (i % 3 == 0) and i * 1000003 or (i % 5 == 0 and -i or i % 100)
+      end
+      local w = buffer.writer()
+      for _, v in ipairs(values) do
+        local tmp = buffer.alloc(10)
+        w:bytes(tmp:slice(1, tmp:writeVarInt(v) - 1))
+      end
+      local packed = w:finish()
+
+      local got, next_offset = packed:readVarIntArray()
+      assert.are.same(got, values)
+      assert.are.equal(next_offset, #packed + 1)
+
+      local first, after = packed:readVarIntArray(1, 3)
+      assert.are.same(first, { 1, 2, values[3] })
+      assert.are.same({ packed:readVarInt(after) }, { 4, after + 1 })
+    end)
+
+    it("decodes unsigned runs and reports truncation", function()
+      local buf = buffer.from("0102030405060708090a8001ac02", "hex")
+      assert.are.same({ buf:readVarUIntArray() }, { { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 128, 300 }, 15 })
+      assert.are.same({ buf:readVarUIntArray(15) }, { {}, 15 })
+      assert.has_error(function() buffer.from("0180", "hex"):readVarUIntArray() end)
+      assert.has_error(function() buffer.from("01", "hex"):readVarUIntArray(1, 2) end)
+      assert.has_error(function() buffer.from("0102", "hex"):readVarUIntArray(1, 2e8) end,
+                       'The value of "count" is out of range. It must be >= 0 && <= 2. Received "200000000"')
+    end)
   end)
 
   describe("error handling", function()
+    it("rejects numbers with no integer equivalent", function()
+      local buf = buffer.alloc(8)
+      local bad = { 1e20, -1e20, 0 / 0, math.huge, -math.huge, 2 ^ 63 }
+      for _, v in ipairs(bad) do
+        assert.has_error(function() buf:writeUInt32LE(v) end)
+        assert.has_error(function() buf:writeIntLE(v, 1, 3) end)
+        assert.has_error(function() buf:writeInt32LEArray({ v }) end)
+      end
+      assert.are.equal(buf:tostring("hex"), "0000000000000000")
+      buf:writeBigInt64LE(-2 ^ 63)
+      assert.are.equal(buf:readBigInt64LE(), math.mininteger)
+      buf:writeUInt32LE(7.9)
+      assert.are.equal(buf:readUInt32LE(), 7)
+    end)
+
     it("throws on out-of-bounds read/write operations", function()
       local buf = buffer.alloc(4)
       assert.has_error(function() buf:writeUInt32LE(1, 2) end)
@@ -135,7 +343,65 @@ describe("Buffer read/write methods", function()
 
       -- Error cases
       local buf4 = buffer.from("abc")
-      assert.has_error(function() buf4:tostring("base64") end)
+      assert.has_error(function() buf4:tostring("ebcdic") end)
+    end)
+
+    it("round-trips long hex strings in either case", function()
+      local bytes = {}
+      for i = 1, 1000 do bytes[i] = (i * 37) % 256 end
+      local buf = buffer.from(bytes)
+
+      local hex = buf:tostring("hex")
+      assert.are.equal(#hex, 2000)
+      assert.are.equal(hex, hex:lower())
+      assert.is_true(buffer.from(hex, "hex") == buf)
+      assert.is_true(buffer.from(hex:upper(), "HEX") == buf)
+    end)
+
+    it("encodes base64 and base64url", function()
+      local buf = buffer.from("foobar")
+      assert.are.equal(buf:tostring("base64"), "Zm9vYmFy")
+      assert.are.equal(buf:tostring("base64", 1, 4), "Zm9vYg==")
+      assert.are.equal(buffer.from({ 0xfb, 0xff }):tostring("base64"), "+/8=")
+      assert.are.equal(buffer.from({ 0xfb, 0xff }):tostring("base64url"), "-_8")
+    end)
+
+    it("round-trips long base64 strings", function()
+      local bytes = {}
+      for i = 1, 1000 do bytes[i] = (i * 131) % 256 end
+      local buf = buffer.from(bytes)
+
+      for _, enc in ipairs({ "base64", "base64url" }) do
+        local str = buf:tostring(enc)
+        assert.is_true(buffer.from(str, enc) == buf)
+      end
+    end)
+
+    it("decodes base64 with whitespace and either alphabet", function()
+      assert.are.equal(buffer.from("Zm9v\nYmFy", "base64"):tostring(), "foobar")
+      assert.are.equal(buffer.from("Zm9vYg", "base64"):tostring(), "foob")
+      assert.are.same({ buffer.from("-_8", "base64")[1] }, { 0xfb })
+      assert.has_error(function() buffer.from("Zm9v!", "base64") end)
+      assert.has_error(function() buffer.from("Z", "base64") end)
+    end)
+
+    it("accepts encoding constants and any casing", function()
+      local buf = buffer.from("hi")
+      assert.are.equal(buf:tostring(buffer.HEX), "6869")
+      assert.are.equal(buf:tostring("Hex"), "6869")
+      assert.are.equal(buf:tostring(buffer.BASE64), "aGk=")
+      assert.are.equal(buffer.from("6869", buffer.HEX):tostring(buffer.UTF8), "hi")
+      assert.are.equal(buffer.alloc(4):write("aGk=", 1, nil, buffer.BASE64), 2)
+      assert.has_error(function() buf:tostring(42) end)
+    end)
+
+    it("rejects invalid hex digits", function()
+      assert.has_error(function() buffer.from("zz", "hex") end)
+      assert.has_error(function() buffer.from("abc", "hex") end)
+      assert.has_error(function()
+        buffer.from(string.rep("ab", 40) .. "g0", "hex")
+      end)
+      assert.has_error(function() buffer.alloc(4):write("0x", 1, nil, "hex") end)
     end)
   end)
 
@@ -186,6 +452,16 @@ describe("Buffer read/write methods", function()
         )
       end)
 
+      it("writes base64 input", function()
+        local buf = buffer.alloc(4)
+        assert.are.equal(buf:write("aGk=", 1, nil, "base64"), 2)
+        assert.are.equal(buf:tostring("utf8", 1, 2), "hi")
+
+        -- truncated to the space left in the buffer
+        assert.are.equal(buf:write("Zm9vYmFy", 2, nil, "base64"), 3)
+        assert.are.equal(buf:tostring(), "hfoo")
+      end)
+
       it("handles special cases correctly", function()
         -- Hex encoding
         local buf = buffer.alloc(4)
@@ -223,7 +499,7 @@ describe("Buffer read/write methods", function()
 
       it("handles invalid encodings correctly", function()
         local buf = buffer.alloc(8)
-        assert.has_error(function() buf:write("abc", 1, nil, "base64") end)
+        assert.has_error(function() buf:write("abc", 1, nil, "ebcdic") end)
       end)
     end)
   end)
@@ -0,0 +1,73 @@
+local buffer = require("buffer")
+
+describe("Buffer search", function()
+  local buf = buffer.from("GET / HTTP/1.1\r\nHost: x\r\n\r\nbody")
+
+  it("finds bytes, strings and buffers", function()
+    assert.are.equal(buf:indexOf(0x2F), 5)
+    assert.are.equal(buf:indexOf("\r\n"), 15)
+    assert.are.equal(buf:indexOf(buffer.from("\r\n\r\n")), 24)
+    assert.are.equal(buf:indexOf("0d0a", 16, "hex"), 24)
+    assert.is_nil(buf:indexOf("nope"))
+    assert.is_nil(buf:indexOf(0x7F))
+  end)
+
+  it("honours start, including negative offsets", function()
+    assert.are.equal(buf:indexOf("\r\n", 16), 24)
+    assert.are.equal(buf:indexOf("o", -4), 29)
+    assert.are.equal(buf:indexOf("", 3), 3)
+    assert.are.equal(buf:indexOf("", 100), #buf + 1)
+  end)
+
+  it("finds the last occurrence", function()
+    assert.are.equal(buf:lastIndexOf("\r\n"), 26)
+    assert.are.equal(buf:lastIndexOf("\r\n", 25), 24)
+    assert.are.equal(buf:lastIndexOf(0x47), 1)
+    assert.are.equal(buf:lastIndexOf("GET", 1), 1)
+    assert.is_nil(buf:lastIndexOf("body", 27))
+    assert.are.equal(buf:lastIndexOf("body", 28), 28)
+  end)
+
+  it("includes", function()
+    assert.is_true(buf:includes("Host"))
+    assert.is_false(buf:includes("Host", 20))
+  end)
+
+  it("agrees with string.find on long inputs", function()
+    local parts = {}
+    for i = 1, 300 do
+      parts[i] = string.rep(string.char(97 + i % 26), i % 7) .. "--bound"
+    end
+    local s = table.concat(parts) .. "--boundary--"
+    local long = buffer.from(s)
+
+    for _, needle in ipairs({ "--boundary--", "--bound", "d--b", "zz", "q" }) do
+      assert.are.equal(long:indexOf(needle), s:find(needle, 1, true))
+
+      local last
+      local init = 1
+      while true do
+        local i = s:find(needle, init, true)
+        if not i then break end
+        last, init = i, i + 1
+      end
+      assert.are.equal(long:lastIndexOf(needle), last)
+    end
+  end)
+
+  it("splits into views", function()
+    local lines = {}
+    for line in buf:split("\r\n") do
+      lines[#lines + 1] = line:tostring()
+    end
+    assert.are.same(lines, { "GET / HTTP/1.1", "Host: x", "", "body" })
+
+    local parts = {}
+    for part in buffer.from("a,,b,"):split(0x2C) do
+      parts[#parts + 1] = part:tostring()
+    end
+    assert.are.same(parts, { "a", "", "b", "" })
+
+    assert.has_error(function() buf:split("") end)
+  end)
+end)
@@ -0,0 +1,48 @@
+local buffer = require("buffer")
+
+local function reversed_groups(s, width)
+  local out = {}
+  for i = 1, #s, width do out[#out + 1] = s:sub(i, i + width - 1):reverse() end
+  return table.concat(out)
+end
+
+describe("Buffer byte swapping", function()
+  it("swaps 16, 32 and 64-bit elements", function()
+    local buf = buffer.from("0102030405060708", "hex")
+    assert.are.equal(buf:swap16(), buf)
+    assert.are.equal(buf:tostring("hex"), "0201040306050807")
+    assert.are.equal(buf:swap16():swap32():tostring("hex"), "0403020108070605")
+    assert.are.equal(buf:swap32():swap64():tostring("hex"), "0807060504030201")
+  end)
+
+  it("converts big-endian samples in bulk", function()
+    local w = buffer.writer()
+    for i = 1, 100 do w:f32be(i / 4) end
+    local buf = w:finish():swap32()
+    for i = 1, 100 do assert.are.equal(buf:readFloatLE((i - 1) * 4 + 1), i / 4) end
+  end)
+
+  it("matches a reference on long inputs", function()
+    local parts = {}
+    for i = 1, 1000 do parts[i] = string.char((i * 37) % 256) end
+    local data = table.concat(parts)
+    for _, width in ipairs({ 2, 4, 8 }) do
+      local n = #data - #data % width
+      local buf = buffer.from(data:sub(1, n))
+      buf["swap" .. width * 8](buf)
+      assert.are.equal(buf:tostring(), reversed_groups(data:sub(1, n), width))
+    end
+  end)
+
+  it("swaps a range", function()
+    local buf = buffer.from("xx\1\2\3\4yy")
+    assert.are.equal(buf:swap32(3, 6):tostring(), "xx\4\3\2\1yy")
+  end)
+
+  it("rejects lengths that are not a multiple of the width", function()
+    assert.has_error(function() buffer.from("abc"):swap16() end)
+    assert.has_error(function() buffer.from("abcdef"):swap32() end)
+    assert.has_error(function() buffer.from("abcd"):swap64() end)
+    assert.are.equal(buffer.alloc(0):swap64():tostring(), "")
+  end)
+end)
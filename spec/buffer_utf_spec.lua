@@ -0,0 +1,85 @@
+local buffer = require("buffer")
+
+describe("Buffer text encodings", function()
+  local text = "héllo wörld € 😀"
+
+  describe("buffer.isUtf8(input)", function()
+    it("accepts well-formed UTF-8", function()
+      assert.is_true(buffer.isUtf8(""))
+      assert.is_true(buffer.isUtf8(text))
+      assert.is_true(buffer.isUtf8(buffer.from(text:rep(20))))
+      assert.is_true(buffer.isUtf8("\xF4\x8F\xBF\xBF"))
+    end)
+
+    it("rejects malformed sequences", function()
+      local bad = {
+        "\x80", "\xC3", "\xC0\xAF", "\xE0\x80\x80", "\xED\xA0\x80",
+        "\xF0\x80\x80\x80", "\xF4\x90\x80\x80", "\xFF", "\xE2\x82",
+      }
+      for _, s in ipairs(bad) do
+        assert.is_false(buffer.isUtf8(s))
+        -- the same error past a long ASCII run, and cut off at the end
+        assert.is_false(buffer.isUtf8(("a"):rep(70) .. s .. ("b"):rep(5)))
+        assert.is_false(buffer.isUtf8(("a"):rep(64) .. s))
+      end
+    end)
+  end)
+
+  describe("utf16le", function()
+    it("round-trips through UTF-8", function()
+      local buf = buffer.from(text, "utf16le")
+      assert.are.equal(#buf, 2 * 14 + 4)
+      assert.are.equal(buf:tostring("hex"):sub(1, 8), "6800e900")
+      assert.are.equal(buf:tostring(buffer.UTF16LE), text)
+      assert.are.equal(buffer.from(text:rep(10), "ucs2"):tostring("utf-16le"),
+                       text:rep(10))
+    end)
+
+    it("replaces unpaired surrogates and drops an odd byte", function()
+      local buf = buffer.from("00d841003dd800de42", "hex")
+      assert.are.equal(buf:tostring("utf16le"), "\u{FFFD}A😀")
+    end)
+
+    it("rejects malformed UTF-8 input", function()
+      assert.has_error(function() buffer.from("\xFF", "utf16le") end,
+                       "Invalid UTF-8 string")
+    end)
+
+    it("writes into an existing buffer", function()
+      local buf = buffer.alloc(6)
+      assert.are.equal(buf:write("hé", 1, nil, "utf16le"), 4)
+      assert.are.equal(buf:tostring("hex"), "6800e9000000")
+    end)
+  end)
+
+  describe("latin1 and ascii", function()
+    it("maps each byte to one code point", function()
+      local buf = buffer.from("41e9ff", "hex")
+      assert.are.equal(buf:tostring("latin1"), "Aé\u{FF}")
+      assert.are.equal(buf:tostring(buffer.LATIN1, 2), "é\u{FF}")
+      assert.are.equal(buffer.from("Aé\u{FF}", "latin1"):tostring("hex"),
+                       "41e9ff")
+    end)
+
+    it("rejects malformed UTF-8 input", function()
+      assert.has_error(function() buffer.from("\xE9", "latin1") end,
+                       "Invalid UTF-8 string")
+    end)
+
+    it("keeps the low byte of wider code points", function()
+      assert.are.equal(buffer.from("€", "latin1"):tostring("hex"), "ac")
+    end)
+
+    it("keeps raw bytes as binary", function()
+      local buf = buffer.from("\xFF\xE9\0", "binary")
+      assert.are.equal(buf:tostring("hex"), "ffe900")
+      assert.are.equal(buf:tostring(buffer.BINARY), "\xFF\xE9\0")
+    end)
+
+    it("clears the high bit when decoding ascii", function()
+      local buf = buffer.from(("\xC1"):rep(40))
+      assert.are.equal(buf:tostring("ascii"), ("A"):rep(40))
+      assert.are.equal(buffer.from("é", "ascii"):tostring("hex"), "e9")
+    end)
+  end)
+end)
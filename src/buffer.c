@@ -5,31 +5,145 @@
 #include <lualib.h>
 
 #include "buffer_alloc.h"
+#include "buffer_async.h"
+#include "buffer_bitwise.h"
+#include "buffer_checksum.h"
+#include "buffer_compare.h"
+#include "buffer_cursor.h"
+#include "buffer_hash.h"
+#include "buffer_io.h"
+#include "buffer_layout.h"
+#include "buffer_mem.h"
 #include "buffer_meta.h"
+#include "buffer_mmap.h"
 #include "buffer_rw.h"
+#include "buffer_search.h"
+#include "buffer_swap.h"
+#include "buffer_utf.h"
+#include "encoding.h"
 
 static const luaL_Reg buffer_methods[] = {
     //
     {"write", l_buffer_write_string},
     {"tostring", l_buffer_tostring},
-    {"readUInt32LE", l_buffer_read_u32le},
-    {"readUInt32BE", l_buffer_read_u32be},
+    {"slice", l_buffer_slice},
+    {"subarray", l_buffer_slice},
+    {"fill", l_buffer_fill},
+    {"copy", l_buffer_copy},
+    {"copyWithin", l_buffer_copy_within},
+    {"compare", l_buffer_compare_method},
+    {"equals", l_buffer_equals},
+    {"crc32", l_buffer_crc32},
+    {"crc32c", l_buffer_crc32c},
+    {"adler32", l_buffer_adler32},
+    {"swap16", l_buffer_swap16},
+    {"swap32", l_buffer_swap32},
+    {"swap64", l_buffer_swap64},
+    {"xor", l_buffer_xor},
+    {"band", l_buffer_band},
+    {"bor", l_buffer_bor},
+    {"bnot", l_buffer_bnot},
+    {"popcount", l_buffer_popcount},
+    {"hash64", l_buffer_hash64},
+    {"hash128", l_buffer_hash128},
+    {"indexOf", l_buffer_index_of},
+    {"lastIndexOf", l_buffer_last_index_of},
+    {"includes", l_buffer_includes},
+    {"split", l_buffer_split},
+    {"reader", l_buffer_reader},
+    {"writer", l_buffer_writer},
+    {"writeTo", l_buffer_write_to},
+    {"readFrom", l_buffer_read_from},
+    {"readAsync", l_buffer_read_async},
+    {"writeAsync", l_buffer_write_async},
+    {"sync", l_buffer_sync},
+    {"advise", l_buffer_advise},
+    {"readUInt8", l_buffer_read_u8},
+    {"writeUInt8", l_buffer_write_u8},
+    {"readInt8", l_buffer_read_i8},
+    {"writeInt8", l_buffer_write_i8},
     {"readUInt16LE", l_buffer_read_u16le},
     {"writeUInt16LE", l_buffer_write_u16le},
-    {"readInt16BE", l_buffer_read_i16be},
-    {"writeInt16BE", l_buffer_write_i16be},
+    {"readUInt16BE", l_buffer_read_u16be},
+    {"writeUInt16BE", l_buffer_write_u16be},
     {"readInt16LE", l_buffer_read_i16le},
     {"writeInt16LE", l_buffer_write_i16le},
-    {"readFloatLE", l_buffer_read_f32le},
-    {"readFloatBE", l_buffer_read_f32be},
-    {"readDoubleLE", l_buffer_read_f64le},
-    {"readDoubleBE", l_buffer_read_f64be},
+    {"readInt16BE", l_buffer_read_i16be},
+    {"writeInt16BE", l_buffer_write_i16be},
+    {"readUInt32LE", l_buffer_read_u32le},
     {"writeUInt32LE", l_buffer_write_u32le},
+    {"readUInt32BE", l_buffer_read_u32be},
     {"writeUInt32BE", l_buffer_write_u32be},
+    {"readInt32LE", l_buffer_read_i32le},
+    {"writeInt32LE", l_buffer_write_i32le},
+    {"readInt32BE", l_buffer_read_i32be},
+    {"writeInt32BE", l_buffer_write_i32be},
+    {"readBigUInt64LE", l_buffer_read_u64le},
+    {"writeBigUInt64LE", l_buffer_write_u64le},
+    {"readBigUInt64BE", l_buffer_read_u64be},
+    {"writeBigUInt64BE", l_buffer_write_u64be},
+    {"readBigInt64LE", l_buffer_read_i64le},
+    {"writeBigInt64LE", l_buffer_write_i64le},
+    {"readBigInt64BE", l_buffer_read_i64be},
+    {"writeBigInt64BE", l_buffer_write_i64be},
+    {"readFloatLE", l_buffer_read_f32le},
     {"writeFloatLE", l_buffer_write_f32le},
+    {"readFloatBE", l_buffer_read_f32be},
     {"writeFloatBE", l_buffer_write_f32be},
+    {"readDoubleLE", l_buffer_read_f64le},
     {"writeDoubleLE", l_buffer_write_f64le},
+    {"readDoubleBE", l_buffer_read_f64be},
     {"writeDoubleBE", l_buffer_write_f64be},
+    {"readUIntLE", l_buffer_read_uintle},
+    {"readUIntBE", l_buffer_read_uintbe},
+    {"readIntLE", l_buffer_read_intle},
+    {"readIntBE", l_buffer_read_intbe},
+    {"writeUIntLE", l_buffer_write_intle},
+    {"writeUIntBE", l_buffer_write_intbe},
+    {"writeIntLE", l_buffer_write_intle},
+    {"writeIntBE", l_buffer_write_intbe},
+    {"readUInt8Array", l_buffer_read_u8_array},
+    {"writeUInt8Array", l_buffer_write_u8_array},
+    {"readInt8Array", l_buffer_read_i8_array},
+    {"writeInt8Array", l_buffer_write_i8_array},
+    {"readUInt16LEArray", l_buffer_read_u16le_array},
+    {"writeUInt16LEArray", l_buffer_write_u16le_array},
+    {"readUInt16BEArray", l_buffer_read_u16be_array},
+    {"writeUInt16BEArray", l_buffer_write_u16be_array},
+    {"readInt16LEArray", l_buffer_read_i16le_array},
+    {"writeInt16LEArray", l_buffer_write_i16le_array},
+    {"readInt16BEArray", l_buffer_read_i16be_array},
+    {"writeInt16BEArray", l_buffer_write_i16be_array},
+    {"readUInt32LEArray", l_buffer_read_u32le_array},
+    {"writeUInt32LEArray", l_buffer_write_u32le_array},
+    {"readUInt32BEArray", l_buffer_read_u32be_array},
+    {"writeUInt32BEArray", l_buffer_write_u32be_array},
+    {"readInt32LEArray", l_buffer_read_i32le_array},
+    {"writeInt32LEArray", l_buffer_write_i32le_array},
+    {"readInt32BEArray", l_buffer_read_i32be_array},
+    {"writeInt32BEArray", l_buffer_write_i32be_array},
+    {"readBigUInt64LEArray", l_buffer_read_u64le_array},
+    {"writeBigUInt64LEArray", l_buffer_write_u64le_array},
+    {"readBigUInt64BEArray", l_buffer_read_u64be_array},
+    {"writeBigUInt64BEArray", l_buffer_write_u64be_array},
+    {"readBigInt64LEArray", l_buffer_read_i64le_array},
+    {"writeBigInt64LEArray", l_buffer_write_i64le_array},
+    {"readBigInt64BEArray", l_buffer_read_i64be_array},
+    {"writeBigInt64BEArray", l_buffer_write_i64be_array},
+    {"readFloatLEArray", l_buffer_read_f32le_array},
+    {"writeFloatLEArray", l_buffer_write_f32le_array},
+    {"readFloatBEArray", l_buffer_read_f32be_array},
+    {"writeFloatBEArray", l_buffer_write_f32be_array},
+    {"readDoubleLEArray", l_buffer_read_f64le_array},
+    {"writeDoubleLEArray", l_buffer_write_f64le_array},
+    {"readDoubleBEArray", l_buffer_read_f64be_array},
+    {"writeDoubleBEArray", l_buffer_write_f64be_array},
+    {"readVarUInt", l_buffer_read_varuint},
+    {"writeVarUInt", l_buffer_write_varuint},
+    {"readVarInt", l_buffer_read_varint},
+    {"writeVarInt", l_buffer_write_varint},
+    {"readVarUIntArray", l_buffer_read_varuint_array},
+    {"readVarIntArray", l_buffer_read_varint_array},
     {NULL, NULL}};
 
 static const luaL_Reg buffer_meta[] = {
@@ -48,17 +162,47 @@ static const luaL_Reg buffer_module[] = {
     {"from", l_buffer_from},
     {"alloc", l_buffer_alloc},
     {"allocUnsafe", l_buffer_alloc_unsafe},
+    {"compile", l_buffer_compile},
+    {"writer", l_buffer_new_writer},
+    {"builder", l_buffer_new_writer},
+    {"concat", l_buffer_concat},
+    {"compare", l_buffer_compare},
+    {"timingSafeEqual", l_buffer_timing_safe_equal},
+    {"isUtf8", l_buffer_is_utf8},
+    {"hasher", l_buffer_new_hasher},
+    {"mmap", l_buffer_mmap},
+    {"writev", l_buffer_writev},
+    {"readv", l_buffer_readv},
+    {"engine", l_buffer_engine},
+    {"poolStats", l_buffer_pool_stats},
+    {"poolTrim", l_buffer_pool_trim},
+    {"poolLimit", l_buffer_pool_limit},
+    {"externalMemory", l_buffer_external_memory},
     {NULL, NULL}};
 
 int luaopen_buffer(lua_State* L) {
+  buffer_mem_open(L);
+  buffer_layout_open(L);
+  buffer_cursor_open(L);
+  buffer_hash_open(L);
+  buffer_async_open(L);
+
+  // Every method and module function shares the encoding lookup table as
+  // upvalue 1, see check_encoding().
+  encoding_push_lookup(L);
+
   luaL_newmetatable(L, BUFFER_MT);
   luaL_setfuncs(L, buffer_meta, 0);
 
   lua_newtable(L);
-  luaL_setfuncs(L, buffer_methods, 0);
+  lua_pushvalue(L, -3);
+  luaL_setfuncs(L, buffer_methods, 1);
   lua_setfield(L, -2, BUFFER_METHODSINDEX);
   lua_pop(L, 1);
 
-  luaL_newlib(L, buffer_module);
+  luaL_newlibtable(L, buffer_module);
+  lua_insert(L, -2);
+  luaL_setfuncs(L, buffer_module, 1);
+  encoding_set_constants(L, -1);
   return 1;
 }
@@ -9,9 +9,11 @@
 #include <strings.h>
 
 #include "buffer.h"
+#include "buffer_mem.h"
 #include "common.h"
+#include "encoding.h"
 #include "errors.h"
-#include "hexlib.h"
+#include "utils.h"
 
 #define ERR_INVALID_BUFFERLEN                                                  \
   "The value of \"size\" is out of range. It must be >= 0 && <= %I. Received " \
@@ -24,6 +26,69 @@ static int buffer_alloc_fstream(lua_State* L);
 static int buffer_alloc_fstring(lua_State* L);
 static int buffer_alloc_fbuffer(lua_State* L);
 
+// Pushes a new Buffer of `size` bytes. When the pool is enabled, sizes in its
+// class range are served from recycled blocks. Otherwise small payloads are
+// placed right after the header in the same userdata block, and larger ones
+// get their own heap allocation so a big buffer doesn't have to fit in one Lua
+// object.
+Buffer* buffer_new(lua_State* L, size_t size, bool zeroed) {
+  BufferMem* mem = buffer_mem(L);
+  Buffer* buf;
+
+  if (buffer_pool_accepts(mem, size)) {
+    buf = lua_newuserdatauv(L, sizeof(Buffer), 1);
+    buf->buffer = buffer_pool_acquire(mem, size, &buf->capacity);
+    buf->size = size;
+    buf->storage = BUFFER_STORAGE_POOL;
+    if (!buf->buffer) {
+      buf->size = buf->capacity = 0;
+      throw_luaoom(L, size);
+    }
+    if (zeroed) memset(buf->buffer, 0, size);
+  } else if (size <= BUFFER_INLINE_MAX) {
+    buf = lua_newuserdatauv(L, sizeof(Buffer) + size, 1);
+    buf->buffer = (uint8_t*)(buf + 1);
+    buf->size = buf->capacity = size;
+    buf->storage = BUFFER_STORAGE_INLINE;
+    if (zeroed) memset(buf->buffer, 0, size);
+  } else {
+    buf = lua_newuserdatauv(L, sizeof(Buffer), 1);
+    buf->buffer = buffer_mem_alloc(mem, size);
+    buf->size = buf->capacity = size;
+    buf->storage = BUFFER_STORAGE_HEAP;
+    if (!buf->buffer) {
+      buf->size = buf->capacity = 0;
+      throw_luaoom(L, size);
+    }
+    if (zeroed) memset(buf->buffer, 0, size);
+  }
+
+  buf->engine = NULL;
+  buf->async_pending = 0;
+
+  luaL_getmetatable(L, BUFFER_MT);
+  lua_setmetatable(L, -2);
+
+  buffer_mem_pace(L, mem);
+  return buf;
+}
+
+// Pushes a Buffer that takes ownership of `data`, which must come from
+// buffer_mem_alloc() and span `size` bytes.
+Buffer* buffer_adopt(lua_State* L, uint8_t* data, size_t size) {
+  Buffer* buf = lua_newuserdatauv(L, sizeof(Buffer), 1);
+  buf->buffer = data;
+  buf->size = buf->capacity = size;
+  buf->storage = BUFFER_STORAGE_HEAP;
+  buf->engine = NULL;
+  buf->async_pending = 0;
+
+  luaL_getmetatable(L, BUFFER_MT);
+  lua_setmetatable(L, -2);
+
+  return buf;
+}
+
 int l_buffer_from(lua_State* L) {
   int type = lua_type(L, 1);
 
@@ -68,22 +133,13 @@ static int buffer_alloc_fstream(lua_State* L) {
 
   if (size <= 0) return luaL_error(L, "Cannot create zero-length buffer");
 
-  uint8_t* data = malloc((size_t)size);
-  if (!data) return throw_luaoom(L, size);
+  Buffer* buf = buffer_new(L, (size_t)size, false);
 
-  size_t got = fread(data, 1, (size_t)size, stream->f);
-  if (got == 0) {
-    FREE(data);
+  size_t got = fread(buf->buffer, 1, (size_t)size, stream->f);
+  if (got == 0)
     return luaL_error(L, "Failed to read from file (empty or unreadable)");
-  }
 
-  Buffer* buf = lua_newuserdata(L, sizeof(Buffer));
-  buf->buffer = data;
   buf->size = got;
-
-  luaL_getmetatable(L, BUFFER_MT);
-  lua_setmetatable(L, -2);
-
   return 1;
 }
 
@@ -91,10 +147,7 @@ static int buffer_alloc_ftable(lua_State* L) {
   luaL_checktype(L, 1, LUA_TTABLE);
   size_t len = (size_t)lua_rawlen(L, 1);
 
-  Buffer* buf = lua_newuserdata(L, sizeof(Buffer));
-  buf->size = len;
-  buf->buffer = malloc(len);
-  if (!buf->buffer) return throw_luaoom(L, len);
+  Buffer* buf = buffer_new(L, len, false);
 
   for (size_t i = 1; i <= len; i++) {
     lua_rawgeti(L, 1, (lua_Integer)i);
@@ -110,24 +163,14 @@ static int buffer_alloc_ftable(lua_State* L) {
     lua_pop(L, 1);
   }
 
-  luaL_getmetatable(L, BUFFER_MT);
-  lua_setmetatable(L, -2);
   return 1;
 }
 
 static int buffer_alloc_fbuffer(lua_State* L) {
   Buffer* src = luaL_checkudata(L, 1, BUFFER_MT);
-  Buffer* buf = lua_newuserdata(L, sizeof(Buffer));
-
-  buf->size = src->size;
-  buf->buffer = malloc(src->size);
-  if (!buf->buffer) return throw_luaoom(L, src->size);
+  Buffer* buf = buffer_new(L, src->size, false);
 
   memcpy(buf->buffer, src->buffer, src->size);
-
-  luaL_getmetatable(L, BUFFER_MT);
-  lua_setmetatable(L, -2);
-
   return 1;
 }
 
@@ -135,29 +178,11 @@ static int buffer_alloc_fbuffer(lua_State* L) {
 static int buffer_alloc_fstring(lua_State* L) {
   size_t in_len;
   const char* input = luaL_checklstring(L, 1, &in_len);
-  const char* encoding = luaL_optstring(L, 2, ENCODING_UTF8);
-
-  uint8_t* decoded = NULL;
-  size_t out_len = 0;
-
-  if (strcasecmp(encoding, ENCODING_UTF8) == 0) {
-    decoded = malloc(in_len);
-    if (!decoded) return throw_luaoom(L, in_len);
-    memcpy(decoded, input, in_len);
-    out_len = in_len;
-  } else if (strcasecmp(encoding, ENCODING_BASE16) == 0) {
-    decoded = hex_decode((const char*)input, &out_len);
-    if (!decoded) return luaL_error(L, ERR_INVALID_HEX_STRING);
-  } else {
-    return luaL_error(L, ERR_UNSUPPORTED_ENCODING, encoding);
-  }
+  const Codec* codec = check_encoding(L, 2);
 
-  Buffer* buf = lua_newuserdata(L, sizeof(Buffer));
-  buf->buffer = decoded;
-  buf->size = out_len;
-
-  luaL_getmetatable(L, BUFFER_MT);
-  lua_setmetatable(L, -2);
+  Buffer* buf = buffer_new(L, codec->decoded_maxlen(in_len), false);
+  if (!codec->decode(buf->buffer, &buf->size, input, in_len))
+    return luaL_error(L, "%s", codec->invalid);
 
   return 1;
 }
@@ -168,82 +193,245 @@ int l_buffer_alloc_unsafe(lua_State* L) {
   if (size < 0)
     return luaL_error(L, ERR_INVALID_BUFFERLEN, LUA_MAXINTEGER, size);
 
-  Buffer* buf = lua_newuserdata(L, sizeof(Buffer));
-  buf->size = (size_t)size;
-  buf->buffer = malloc(buf->size);
+  buffer_new(L, (size_t)size, false);
+  return 1;
+}
 
-  if (!buf->buffer) return throw_luaoom(L, buf->size);
+// Fills `len` bytes at `dst` with repeats of `pat`. After the first copy the
+// filled prefix is copied onto itself, doubling each round, so a fill costs
+// about log2(len / pat_len) memcpy calls rather than a division per byte.
+// `pat` may overlap `dst`; an empty pattern zero-fills.
+void buffer_fill_pattern(uint8_t* dst, size_t len, const uint8_t* pat,
+                         size_t pat_len) {
+  if (len == 0) return;
+
+  if (pat_len <= 1) {
+    memset(dst, pat_len ? pat[0] : 0, len);
+    return;
+  }
 
-  luaL_getmetatable(L, BUFFER_MT);
-  lua_setmetatable(L, -2);
+  size_t done = pat_len < len ? pat_len : len;
+  memmove(dst, pat, done);
 
-  return 1;
+  while (done < len) {
+    size_t n = done < len - done ? done : len - done;
+    memcpy(dst + done, dst, n);
+    done += n;
+  }
+}
+
+// Fills `len` bytes at `dst` from the number, string or Buffer at `arg`.
+static void fill_from_value(lua_State* L, uint8_t* dst, size_t len, int arg,
+                            const Codec* codec) {
+  switch (lua_type(L, arg)) {
+    case LUA_TUSERDATA: {
+      Buffer* src = luaL_checkudata(L, arg, BUFFER_MT);
+      buffer_fill_pattern(dst, len, src->buffer, src->size);
+      break;
+    }
+
+    case LUA_TNUMBER: {
+      lua_Number d = luaL_checknumber(L, arg);
+      memset(dst, (uint8_t)(((int)d) & 0xFF), len);
+      break;
+    }
+
+    case LUA_TSTRING: {
+      size_t fill_len;
+      const char* fill_str = luaL_checklstring(L, arg, &fill_len);
+
+      size_t data_len = 0;
+      const uint8_t* data =
+          codec_decode_alloc(L, codec, fill_str, fill_len, &data_len);
+
+      buffer_fill_pattern(dst, len, data, data_len);
+
+      if (data != (const uint8_t*)fill_str) free((void*)data);
+      break;
+    }
+
+    default:
+      luaL_error(L, "Invalid fill type: must be number, string, or buffer");
+  }
 }
 
 int l_buffer_alloc(lua_State* L) {
   lua_Integer size = luaL_checkinteger(L, 1);
   bool canfill = (size > 0 && !lua_isnoneornil(L, 2));
-  const char* encoding = luaL_optstring(L, 3, ENCODING_UTF8);
+  const Codec* codec = check_encoding(L, 3);
 
   if (size < 0)
     return luaL_error(L, ERR_INVALID_BUFFERLEN, LUA_MAXINTEGER, size);
 
-  Buffer* buf = lua_newuserdata(L, sizeof(Buffer));
-  buf->size = (size_t)size;
-  buf->buffer = calloc(buf->size, 1);
-
-  if (!buf->buffer) return throw_luaoom(L, buf->size);
-
-  if (canfill) {
-    int type = lua_type(L, 2);
-
-    switch (type) {
-      case LUA_TUSERDATA: {
-        Buffer* src = luaL_checkudata(L, 2, BUFFER_MT);
-        for (size_t i = 0; i < buf->size; i++)
-          buf->buffer[i] = src->buffer[i % src->size];
-        break;
-      }
-
-      case LUA_TNUMBER: {
-        lua_Number d = luaL_checknumber(L, 2);
-        uint8_t fill = (uint8_t)(((int)d) & 0xFF);
-        memset(buf->buffer, fill, buf->size);
-        break;
-      }
-
-      case LUA_TSTRING: {
-        size_t fill_len;
-        const char* fill_str = luaL_checklstring(L, 2, &fill_len);
-
-        uint8_t* data = NULL;
-        size_t data_len = 0;
-
-        if (strcasecmp(encoding, ENCODING_UTF8) == 0) {
-          data = (uint8_t*)fill_str;
-          data_len = fill_len;
-        } else if (strcasecmp(encoding, ENCODING_BASE16) == 0) {
-          data = hex_decode(fill_str, &data_len);
-          if (!data) return luaL_error(L, ERR_INVALID_HEX_STRING);
-        } else {
-          return luaL_error(L, ERR_UNSUPPORTED_ENCODING, encoding);
-        }
-
-        for (size_t i = 0; i < buf->size; i++)
-          buf->buffer[i] = data[i % data_len];
-
-        if (data != (uint8_t*)fill_str) FREE(data);
-        break;
-      }
-
-      default:
-        return luaL_error(
-            L, "Invalid fill type: must be number, string, or buffer");
-    }
+  Buffer* buf = buffer_new(L, (size_t)size, !canfill);
+
+  if (canfill) fill_from_value(L, buf->buffer, buf->size, 2, codec);
+
+  return 1;
+}
+
+// buf:fill(value, [start], [end], [encoding]) -> buf
+// buf:fill(value, encoding) -> buf
+int l_buffer_fill(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  luaL_checkany(L, 2);
+
+  lua_Integer start = 1, end = (lua_Integer)buf->size;
+  const Codec* codec;
+
+  if (lua_type(L, 3) == LUA_TSTRING) {
+    codec = check_encoding(L, 3);
+  } else {
+    start = luaL_optinteger(L, 3, start);
+    end = luaL_optinteger(L, 4, end);
+    codec = check_encoding(L, 5);
   }
 
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+  fill_from_value(L, buf->buffer + offset, len, 2, codec);
+
+  lua_settop(L, 1);
+  return 1;
+}
+
+// Pushes a Buffer sharing `len` bytes at `offset` of the Buffer at `idx`.
+Buffer* buffer_view(lua_State* L, int idx, size_t offset, size_t len) {
+  idx = lua_absindex(L, idx);
+  Buffer* src = lua_touserdata(L, idx);
+
+  Buffer* view = lua_newuserdatauv(L, sizeof(Buffer), 1);
+  view->buffer = src->buffer + offset;
+  view->size = len;
+  view->capacity = 0;
+  view->storage = BUFFER_STORAGE_VIEW;
+  view->engine = NULL;
+  view->async_pending = 0;
+
+  // Pin the storage owner, never an intermediate view, so chains of slices
+  // don't keep each other alive.
+  if (src->storage == BUFFER_STORAGE_VIEW)
+    lua_getiuservalue(L, idx, 1);
+  else
+    lua_pushvalue(L, idx);
+  lua_setiuservalue(L, -2, 1);
+
   luaL_getmetatable(L, BUFFER_MT);
   lua_setmetatable(L, -2);
 
+  return view;
+}
+
+int l_buffer_slice(lua_State* L) {
+  Buffer* src = luaL_checkudata(L, 1, BUFFER_MT);
+  lua_Integer start = luaL_optinteger(L, 2, 1);
+  lua_Integer end = luaL_optinteger(L, 3, (lua_Integer)src->size);
+
+  size_t offset;
+  size_t len = resolve_range(src->size, start, end, &offset);
+
+  buffer_view(L, 1, offset, len);
+  return 1;
+}
+
+// buffer.concat(list, [totalLength]) -> Buffer
+// Joins Buffers and strings with a single allocation. A totalLength shorter
+// than the sum truncates, a longer one zero-fills the tail.
+int l_buffer_concat(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_Integer n = (lua_Integer)lua_rawlen(L, 1);
+  size_t sum = 0;
+
+  for (lua_Integer i = 1; i <= n; i++) {
+    lua_rawgeti(L, 1, i);
+    Buffer* item = luaL_testudata(L, -1, BUFFER_MT);
+    if (item) {
+      sum += item->size;
+    } else if (lua_type(L, -1) == LUA_TSTRING) {
+      sum += lua_rawlen(L, -1);
+    } else {
+      const char* tname = luaL_typename(L, -1);
+      return luaL_error(
+          L, "Invalid value at index %I (buffer or string expected, got %s)", i,
+          tname);
+    }
+    lua_pop(L, 1);
+  }
+
+  size_t total = sum;
+  if (!lua_isnoneornil(L, 2)) {
+    lua_Integer len = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, len >= 0, 2, "length must be >= 0");
+    total = (size_t)len;
+  }
+
+  Buffer* buf = buffer_new(L, total, false);
+  size_t pos = 0;
+
+  for (lua_Integer i = 1; i <= n && pos < total; i++) {
+    lua_rawgeti(L, 1, i);
+    Buffer* item = luaL_testudata(L, -1, BUFFER_MT);
+    size_t len;
+    const void* src;
+    if (item) {
+      src = item->buffer;
+      len = item->size;
+    } else {
+      src = lua_tolstring(L, -1, &len);
+    }
+    if (len > total - pos) len = total - pos;
+    memcpy(buf->buffer + pos, src, len);
+    pos += len;
+    lua_pop(L, 1);
+  }
+
+  if (pos < total) memset(buf->buffer + pos, 0, total - pos);
+  return 1;
+}
+
+// 0-based offset of the 1-based `pos` (negative counts from the end), clamped
+// to [0, size].
+static size_t resolve_position(size_t size, lua_Integer pos) {
+  if (pos < 0) pos = (lua_Integer)size + pos + 1;
+  if (pos < 1) return 0;
+  if (pos > (lua_Integer)size) return size;
+  return (size_t)(pos - 1);
+}
+
+// src:copy(target, [targetStart], [sourceStart], [sourceEnd]) -> copied
+// Copies src[sourceStart..sourceEnd] into target at targetStart, truncated to
+// the room left in target. The buffers may share storage.
+int l_buffer_copy(lua_State* L) {
+  Buffer* src = luaL_checkudata(L, 1, BUFFER_MT);
+  Buffer* dst = luaL_checkudata(L, 2, BUFFER_MT);
+  size_t at = resolve_position(dst->size, luaL_optinteger(L, 3, 1));
+  lua_Integer start = luaL_optinteger(L, 4, 1);
+  lua_Integer end = luaL_optinteger(L, 5, (lua_Integer)src->size);
+
+  size_t offset;
+  size_t len = resolve_range(src->size, start, end, &offset);
+  if (len > dst->size - at) len = dst->size - at;
+
+  if (len) memmove(dst->buffer + at, src->buffer + offset, len);
+
+  lua_pushinteger(L, (lua_Integer)len);
+  return 1;
+}
+
+// buf:copyWithin(target, [start], [end]) -> buf
+// Moves buf[start..end] to position target, truncated at the end of buf.
+int l_buffer_copy_within(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  size_t at = resolve_position(buf->size, luaL_checkinteger(L, 2));
+  lua_Integer start = luaL_optinteger(L, 3, 1);
+  lua_Integer end = luaL_optinteger(L, 4, (lua_Integer)buf->size);
+
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+  if (len > buf->size - at) len = buf->size - at;
+
+  if (len && at != offset) memmove(buf->buffer + at, buf->buffer + offset, len);
+
+  lua_settop(L, 1);
   return 1;
 }
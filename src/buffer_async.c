@@ -0,0 +1,635 @@
+#define _DEFAULT_SOURCE
+
+#include "buffer_async.h"
+
+#include <errno.h>
+#include <lauxlib.h>
+#include <lua.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef BUFFER_WITH_URING
+#include <liburing.h>
+#endif
+
+#include "buffer.h"
+#include "errors.h"
+#include "utils.h"
+
+// Registry table mapping each engine (light userdata) to the table of
+// buffers it has in flight, keyed by request id. It lives in the registry
+// rather than in the engine's user value so that in-flight buffers stay
+// reachable even after the engine itself became garbage: its __gc drains the
+// outstanding requests before letting go of them. lua_close() finalizes
+// reachable objects as well, newest first, so a buffer can still be
+// collected before its engine there; Buffer.engine lets its __gc drain the
+// requests itself.
+static const char BUFFER_ENGINE_PINS = 0;
+
+typedef struct AsyncOp {
+  struct AsyncOp* next;
+  lua_Integer id;
+  Buffer* buf;
+  int fd;
+  bool writing;
+  uint8_t* data;
+  size_t len;
+  int64_t pos;     // file position, -1 for the current one (io_uring, pipes)
+  int64_t result;  // bytes transferred, or -errno
+} AsyncOp;
+
+typedef struct AsyncEngine {
+  pthread_mutex_t lock;
+  pthread_cond_t work;  // ops queued, or stopping
+  pthread_cond_t done;  // ops completed
+  AsyncOp* queue;       // submitted, not yet picked up by a worker
+  AsyncOp* queue_tail;
+  AsyncOp* completed;  // finished, not yet returned by poll()
+  AsyncOp* returning;  // taken by poll(), left over when it raised
+  pthread_t threads[BUFFER_ENGINE_MAX_THREADS];
+  int nthreads;
+  bool stopping;
+#ifdef BUFFER_WITH_URING
+  struct io_uring ring;
+  bool uring;
+#endif
+  size_t inflight;  // submitted and not yet returned by poll()
+  lua_Integer next_id;
+  bool closed;
+} AsyncEngine;
+
+// Runs one request to completion: writes everything, reads until `len` bytes
+// or EOF.
+static int64_t run_op(AsyncOp* op) {
+  size_t done = 0;
+
+  while (done < op->len) {
+    uint8_t* p = op->data + done;
+    size_t left = op->len - done;
+    off_t at = (off_t)op->pos + (off_t)done;
+    ssize_t n;
+
+    if (op->writing)
+      n = op->pos >= 0 ? pwrite(op->fd, p, left, at) : write(op->fd, p, left);
+    else
+      n = op->pos >= 0 ? pread(op->fd, p, left, at) : read(op->fd, p, left);
+
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return done > 0 ? (int64_t)done : -(int64_t)errno;
+    }
+    if (n == 0) break;
+    done += (size_t)n;
+  }
+
+  return (int64_t)done;
+}
+
+static void* engine_worker(void* arg) {
+  AsyncEngine* eng = arg;
+
+  pthread_mutex_lock(&eng->lock);
+  for (;;) {
+    while (!eng->queue && !eng->stopping)
+      pthread_cond_wait(&eng->work, &eng->lock);
+    if (!eng->queue) break;  // stopping and drained
+
+    AsyncOp* op = eng->queue;
+    eng->queue = op->next;
+    if (!eng->queue) eng->queue_tail = NULL;
+    pthread_mutex_unlock(&eng->lock);
+
+    op->result = run_op(op);
+
+    pthread_mutex_lock(&eng->lock);
+    op->next = eng->completed;
+    eng->completed = op;
+    pthread_cond_broadcast(&eng->done);
+  }
+  pthread_mutex_unlock(&eng->lock);
+
+  return NULL;
+}
+
+#ifdef BUFFER_WITH_URING
+// Moves every available CQE onto the completed list.
+static void uring_reap(AsyncEngine* eng, bool wait) {
+  struct io_uring_cqe* cqe;
+
+  if (wait && !eng->completed) {
+    while (io_uring_wait_cqe(&eng->ring, &cqe) == -EINTR) {
+    }
+  }
+
+  while (io_uring_peek_cqe(&eng->ring, &cqe) == 0) {
+    AsyncOp* op = io_uring_cqe_get_data(cqe);
+    op->result = cqe->res;
+    op->next = eng->completed;
+    eng->completed = op;
+    io_uring_cqe_seen(&eng->ring, cqe);
+  }
+}
+#endif
+
+static bool engine_submit(AsyncEngine* eng, AsyncOp* op) {
+#ifdef BUFFER_WITH_URING
+  if (eng->uring) {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&eng->ring);
+    if (!sqe) {
+      io_uring_submit(&eng->ring);
+      sqe = io_uring_get_sqe(&eng->ring);
+      if (!sqe) {
+        errno = EBUSY;
+        return false;
+      }
+    }
+
+    // With an offset of -1 io_uring reads or writes at the file position
+    // when the request runs and advances it; requests in flight together on
+    // one file run in no particular order.
+    __u64 at = op->pos >= 0 ? (__u64)op->pos : (__u64)-1;
+    if (op->writing)
+      io_uring_prep_write(sqe, op->fd, op->data, (unsigned)op->len, at);
+    else
+      io_uring_prep_read(sqe, op->fd, op->data, (unsigned)op->len, at);
+    io_uring_sqe_set_data(sqe, op);
+
+    int r = io_uring_submit(&eng->ring);
+    if (r < 0) {
+      errno = -r;
+      return false;
+    }
+    return true;
+  }
+#endif
+
+  pthread_mutex_lock(&eng->lock);
+  op->next = NULL;
+  if (eng->queue_tail)
+    eng->queue_tail->next = op;
+  else
+    eng->queue = op;
+  eng->queue_tail = op;
+  pthread_cond_signal(&eng->work);
+  pthread_mutex_unlock(&eng->lock);
+  return true;
+}
+
+// Takes the completed list, blocking until there is one when `wait` is set
+// and requests are outstanding.
+static AsyncOp* engine_take(AsyncEngine* eng, bool wait) {
+  AsyncOp* ops;
+
+#ifdef BUFFER_WITH_URING
+  if (eng->uring) {
+    uring_reap(eng, wait && eng->inflight > 0);
+    ops = eng->completed;
+    eng->completed = NULL;
+    return ops;
+  }
+#endif
+
+  pthread_mutex_lock(&eng->lock);
+  while (wait && !eng->completed && eng->inflight > 0)
+    pthread_cond_wait(&eng->done, &eng->lock);
+  ops = eng->completed;
+  eng->completed = NULL;
+  pthread_mutex_unlock(&eng->lock);
+  return ops;
+}
+
+// Drops the claim of `op` on its buffer and frees it.
+static void op_free(AsyncOp* op) {
+  Buffer* buf = op->buf;
+  if (--buf->async_pending == 0) buf->engine = NULL;
+  free(op);
+}
+
+// Requests on `buf` that finished but poll() hasn't returned yet.
+static size_t count_finished(const AsyncEngine* eng, const Buffer* buf) {
+  size_t n = 0;
+  for (const AsyncOp* op = eng->completed; op; op = op->next)
+    if (op->buf == buf) n++;
+  for (const AsyncOp* op = eng->returning; op; op = op->next)
+    if (op->buf == buf) n++;
+  return n;
+}
+
+void buffer_async_drain(Buffer* buf) {
+  AsyncEngine* eng = buf->engine;
+  if (!eng || eng->closed) return;
+
+#ifdef BUFFER_WITH_URING
+  if (eng->uring) {
+    for (;;) {
+      uring_reap(eng, false);
+      if (count_finished(eng, buf) >= buf->async_pending) return;
+
+      struct io_uring_cqe* cqe;
+      while (io_uring_wait_cqe(&eng->ring, &cqe) == -EINTR) {
+      }
+    }
+  }
+#endif
+
+  pthread_mutex_lock(&eng->lock);
+
+  // Requests no worker picked up yet complete as cancelled.
+  AsyncOp** link = &eng->queue;
+  eng->queue_tail = NULL;
+  while (*link) {
+    AsyncOp* op = *link;
+    if (op->buf == buf) {
+      *link = op->next;
+      op->result = -ECANCELED;
+      op->next = eng->completed;
+      eng->completed = op;
+    } else {
+      eng->queue_tail = op;
+      link = &op->next;
+    }
+  }
+
+  while (count_finished(eng, buf) < buf->async_pending)
+    pthread_cond_wait(&eng->done, &eng->lock);
+
+  pthread_mutex_unlock(&eng->lock);
+}
+
+// Waits for every outstanding request, then releases the backend.
+static void engine_close(lua_State* L, AsyncEngine* eng) {
+  if (eng->closed) return;
+  eng->closed = true;
+
+  while (eng->returning) {
+    AsyncOp* op = eng->returning;
+    eng->returning = op->next;
+    op_free(op);
+    eng->inflight--;
+  }
+
+#ifdef BUFFER_WITH_URING
+  if (eng->uring) {
+    while (eng->inflight > 0) {
+      AsyncOp* op = engine_take(eng, true);
+      while (op) {
+        AsyncOp* next = op->next;
+        op_free(op);
+        eng->inflight--;
+        op = next;
+      }
+    }
+    io_uring_queue_exit(&eng->ring);
+  }
+#endif
+
+  pthread_mutex_lock(&eng->lock);
+  eng->stopping = true;
+  pthread_cond_broadcast(&eng->work);
+  pthread_mutex_unlock(&eng->lock);
+
+  for (int i = 0; i < eng->nthreads; i++) pthread_join(eng->threads[i], NULL);
+
+  AsyncOp* op = eng->completed;
+  while (op) {
+    AsyncOp* next = op->next;
+    op_free(op);
+    op = next;
+  }
+  eng->completed = NULL;
+  eng->inflight = 0;
+
+  pthread_cond_destroy(&eng->done);
+  pthread_cond_destroy(&eng->work);
+  pthread_mutex_destroy(&eng->lock);
+
+  // Nothing is in flight anymore, the buffers may go.
+  lua_rawgetp(L, LUA_REGISTRYINDEX, &BUFFER_ENGINE_PINS);
+  lua_pushnil(L);
+  lua_rawsetp(L, -2, eng);
+  lua_pop(L, 1);
+}
+
+static AsyncEngine* check_engine(lua_State* L, int arg) {
+  AsyncEngine* eng = luaL_checkudata(L, arg, BUFFER_ENGINE_MT);
+  if (eng->closed) luaL_error(L, "attempt to use a closed engine");
+  return eng;
+}
+
+// Pushes the pin table of `eng`.
+static void push_pins(lua_State* L, AsyncEngine* eng) {
+  lua_rawgetp(L, LUA_REGISTRYINDEX, &BUFFER_ENGINE_PINS);
+  lua_rawgetp(L, -1, eng);
+  lua_remove(L, -2);
+}
+
+// buffer.engine([threads]) -> engine
+// Uses io_uring when built with BUFFER_WITH_URING and the kernel allows it,
+// otherwise a pool of `threads` workers doing pread/pwrite.
+int l_buffer_engine(lua_State* L) {
+  lua_Integer threads = luaL_optinteger(L, 1, BUFFER_ENGINE_DEFAULT_THREADS);
+  luaL_argcheck(L, threads >= 1 && threads <= BUFFER_ENGINE_MAX_THREADS, 1,
+                "thread count out of range");
+
+  AsyncEngine* eng = lua_newuserdatauv(L, sizeof(AsyncEngine), 0);
+  memset(eng, 0, sizeof(AsyncEngine));
+  eng->next_id = 1;
+  eng->closed = true;  // until fully set up, so __gc leaves it alone
+
+  luaL_getmetatable(L, BUFFER_ENGINE_MT);
+  lua_setmetatable(L, -2);
+
+  // Pin table first: registering can't fail once threads are running.
+  lua_rawgetp(L, LUA_REGISTRYINDEX, &BUFFER_ENGINE_PINS);
+  lua_newtable(L);
+  lua_rawsetp(L, -2, eng);
+  lua_pop(L, 1);
+
+  pthread_mutex_init(&eng->lock, NULL);
+  pthread_cond_init(&eng->work, NULL);
+  pthread_cond_init(&eng->done, NULL);
+  eng->closed = false;
+
+#ifdef BUFFER_WITH_URING
+  if (io_uring_queue_init(BUFFER_ENGINE_URING_ENTRIES, &eng->ring, 0) == 0) {
+    eng->uring = true;
+    return 1;
+  }
+#endif
+
+  for (lua_Integer i = 0; i < threads; i++) {
+    int err = pthread_create(&eng->threads[i], NULL, engine_worker, eng);
+    if (err != 0) {
+      engine_close(L, eng);
+      return luaL_error(L, "failed to start I/O thread: %s", strerror(err));
+    }
+    eng->nthreads++;
+  }
+
+  return 1;
+}
+
+// Drops pin `id` again from the pins table on top of the stack and pops it.
+static void unpin(lua_State* L, lua_Integer id) {
+  lua_pushnil(L);
+  lua_rawseti(L, -2, id);
+  lua_pop(L, 1);
+}
+
+// Queues one request on `eng` for `len` bytes at `data` inside the buffer at
+// `buf_idx` and pins the buffer until poll() returns it.
+static int engine_queue(lua_State* L, AsyncEngine* eng, int buf_idx, int fd,
+                        bool writing, uint8_t* data, size_t len,
+                        lua_Integer pos) {
+  Buffer* buf = lua_touserdata(L, buf_idx);
+  if (buf->engine && buf->engine != eng)
+    return luaL_error(L, "buffer has requests pending on another engine");
+
+#ifdef BUFFER_WITH_URING
+  if (eng->uring && len > UINT32_MAX)
+    return luaL_error(L, "request too large (%I bytes)", (lua_Integer)len);
+  bool uring = eng->uring;
+#else
+  bool uring = false;
+#endif
+
+  // Pin before submitting: a failing rawset after that would leave a worker
+  // writing into an unpinned buffer.
+  lua_Integer id = eng->next_id++;
+  push_pins(L, eng);
+  lua_pushvalue(L, buf_idx);
+  lua_rawseti(L, -2, id);
+
+  AsyncOp* op = malloc(sizeof(AsyncOp));
+  if (!op) {
+    unpin(L, id);
+    return throw_luaoom(L, sizeof(AsyncOp));
+  }
+
+  // Pool workers would race on a shared file position, so the thread backend
+  // claims [pos, pos + len) from it here, in submission order, and the
+  // request uses pread()/pwrite(). Pipes and other unseekable files can only
+  // be ordered by a single worker.
+  bool claimed = false;
+  if (pos < 0 && !uring) {
+    off_t end = lseek(fd, (off_t)len, SEEK_CUR);
+    if (end >= 0) {
+      pos = (lua_Integer)end - (lua_Integer)len;
+      claimed = true;
+    } else if (errno != ESPIPE || eng->nthreads > 1) {
+      int err = errno;
+      unpin(L, id);
+      free(op);
+      if (err != ESPIPE) {
+        errno = err;
+        return push_luaerrno(L);
+      }
+      return luaL_error(L, "unseekable file needs a single-thread engine");
+    }
+  }
+
+  op->next = NULL;
+  op->id = id;
+  op->buf = buf;
+  op->fd = fd;
+  op->writing = writing;
+  op->data = data;
+  op->len = len;
+  op->pos = (int64_t)pos;
+  op->result = 0;
+
+  if (!engine_submit(eng, op)) {
+    int err = errno;
+    if (claimed) lseek(fd, -(off_t)len, SEEK_CUR);
+    unpin(L, id);
+    free(op);
+    errno = err;
+    return push_luaerrno(L);
+  }
+  lua_pop(L, 1);
+
+  eng->inflight++;
+  buf->engine = eng;
+  buf->async_pending++;
+  lua_pushinteger(L, id);
+  return 1;
+}
+
+// Accepts a descriptor or a Lua file handle. Handles are flushed first so
+// pending stdio output lands before the request; their stdio position isn't
+// updated, pass an explicit file position when mixing both.
+static int check_fd(lua_State* L, int arg) {
+  luaL_Stream* stream = luaL_testudata(L, arg, LUA_FILEHANDLE);
+  if (stream) {
+    if (!stream->closef || !stream->f)
+      luaL_error(L, "attempt to use a closed file");
+    fflush(stream->f);
+    return fileno(stream->f);
+  }
+
+  lua_Integer fd = luaL_checkinteger(L, arg);
+  luaL_argcheck(L, fd >= 0 && fd <= INT32_MAX, arg, "invalid file descriptor");
+  return (int)fd;
+}
+
+// buf:readAsync(engine, file | fd, [position], [offset], [length]) -> id
+// Fills buf[offset .. offset + length - 1] (default: the whole buffer) from
+// the 0-based file `position` (default: the current one).
+int l_buffer_read_async(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  AsyncEngine* eng = check_engine(L, 2);
+  int fd = check_fd(L, 3);
+  lua_Integer pos = luaL_optinteger(L, 4, -1);
+  lua_Integer offset = luaL_optinteger(L, 5, 1) - 1;
+  lua_Integer avail = (lua_Integer)buf->size - offset;
+  lua_Integer length = luaL_optinteger(L, 6, avail > 0 ? avail : 0);
+
+  luaL_argcheck(L, pos >= -1, 4, "position must be >= 0");
+  luaL_argcheck(L, length >= 0, 6, "length must be >= 0");
+  if (offset < 0 || (size_t)offset + (size_t)length > buf->size)
+    return luaL_error(L,
+                      "attempt to access memory outside buffer bounds "
+                      "(offset=%I, size=%I, len=%I)",
+                      offset + 1, (lua_Integer)buf->size, length);
+
+  return engine_queue(L, eng, 1, fd, false, buf->buffer + offset,
+                      (size_t)length, pos);
+}
+
+// buf:writeAsync(engine, file | fd, [position], [start], [end]) -> id
+int l_buffer_write_async(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  AsyncEngine* eng = check_engine(L, 2);
+  int fd = check_fd(L, 3);
+  lua_Integer pos = luaL_optinteger(L, 4, -1);
+  lua_Integer start = luaL_optinteger(L, 5, 1);
+  lua_Integer end = luaL_optinteger(L, 6, (lua_Integer)buf->size);
+
+  luaL_argcheck(L, pos >= -1, 4, "position must be >= 0");
+
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+  return engine_queue(L, eng, 1, fd, true, buf->buffer + offset, len, pos);
+}
+
+// Turns completed ops into {id, bytes} / {id, error, errno} entries of the
+// table on top of the stack and unpins their buffers. Each op is released
+// before its entry is built, and the rest wait on `eng->returning`, so a
+// memory error only loses the entry being built.
+static void push_completions(lua_State* L, AsyncEngine* eng, bool wait) {
+  if (!eng->returning) eng->returning = engine_take(eng, wait);
+
+  int results = lua_gettop(L);
+  push_pins(L, eng);
+  int pins = lua_gettop(L);
+  lua_Integer n = (lua_Integer)lua_rawlen(L, results);
+
+  while (eng->returning) {
+    AsyncOp* op = eng->returning;
+    lua_Integer id = op->id;
+    int64_t result = op->result;
+
+    eng->returning = op->next;
+    eng->inflight--;
+    op_free(op);
+    lua_pushnil(L);
+    lua_rawseti(L, pins, id);
+
+    lua_createtable(L, 0, 3);
+    lua_pushinteger(L, id);
+    lua_setfield(L, -2, "id");
+    if (result >= 0) {
+      lua_pushinteger(L, (lua_Integer)result);
+      lua_setfield(L, -2, "bytes");
+    } else {
+      lua_pushstring(L, strerror((int)-result));
+      lua_setfield(L, -2, "error");
+      lua_pushinteger(L, (lua_Integer)-result);
+      lua_setfield(L, -2, "errno");
+    }
+    lua_rawseti(L, results, ++n);
+  }
+
+  lua_pop(L, 1);
+}
+
+// engine:poll() -> { {id = n, bytes = n} | {id = n, error = s, errno = n} }
+// Returns the requests that finished since the last call without blocking.
+static int engine_poll(lua_State* L) {
+  AsyncEngine* eng = check_engine(L, 1);
+  lua_newtable(L);
+  push_completions(L, eng, false);
+  return 1;
+}
+
+// engine:wait() -> same as poll(), but blocks until at least one request
+// finished (returns an empty table when nothing is outstanding)
+static int engine_wait(lua_State* L) {
+  AsyncEngine* eng = check_engine(L, 1);
+  lua_newtable(L);
+  push_completions(L, eng, true);
+  return 1;
+}
+
+// engine:pending() -> requests submitted and not yet returned by poll/wait
+static int engine_pending(lua_State* L) {
+  AsyncEngine* eng = check_engine(L, 1);
+  lua_pushinteger(L, (lua_Integer)eng->inflight);
+  return 1;
+}
+
+// engine:backend() -> "io_uring" | "threads"
+static int engine_backend(lua_State* L) {
+  AsyncEngine* eng = check_engine(L, 1);
+#ifdef BUFFER_WITH_URING
+  if (eng->uring) {
+    lua_pushliteral(L, "io_uring");
+    return 1;
+  }
+#endif
+  (void)eng;
+  lua_pushliteral(L, "threads");
+  return 1;
+}
+
+// engine:close() waits for outstanding requests and stops the workers.
+static int engine__gc(lua_State* L) {
+  AsyncEngine* eng = luaL_checkudata(L, 1, BUFFER_ENGINE_MT);
+  engine_close(L, eng);
+  return 0;
+}
+
+static const luaL_Reg engine_methods[] = {
+    //
+    {"poll", engine_poll},
+    {"wait", engine_wait},
+    {"pending", engine_pending},
+    {"backend", engine_backend},
+    {"close", engine__gc},
+    {NULL, NULL}};
+
+void buffer_async_open(lua_State* L) {
+  if (lua_rawgetp(L, LUA_REGISTRYINDEX, &BUFFER_ENGINE_PINS) == LUA_TNIL) {
+    lua_newtable(L);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &BUFFER_ENGINE_PINS);
+  }
+  lua_pop(L, 1);
+
+  luaL_newmetatable(L, BUFFER_ENGINE_MT);
+
+  lua_pushcfunction(L, engine__gc);
+  lua_setfield(L, -2, "__gc");
+
+  lua_newtable(L);
+  luaL_setfuncs(L, engine_methods, 0);
+  lua_setfield(L, -2, "__index");
+
+  lua_pop(L, 1);
+}
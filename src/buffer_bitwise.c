@@ -0,0 +1,270 @@
+#include "buffer_bitwise.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "buffer_alloc.h"
+#include "buffer_rw.h"
+#include "errors.h"
+#include "simd.h"
+#include "utils.h"
+
+// Short masks are repeated into a block of about this size first so the
+// kernels always see long, non-repeating operands.
+#define PATTERN_MAX 256
+
+typedef void (*bitwise_fn)(uint8_t* dst, const uint8_t* src,
+                           const uint8_t* mask, size_t len);
+
+// dst[i] = src[i] OP mask[i]. The scalar versions work a 64-bit word at a
+// time; dst may be src itself.
+#define BITWISE_SCALAR(name, OP)                                      \
+  static void name##_scalar(uint8_t* dst, const uint8_t* src,         \
+                            const uint8_t* mask, size_t len) {        \
+    size_t i = 0;                                                     \
+    for (; i + 8 <= len; i += 8) {                                    \
+      uint64_t a, b;                                                  \
+      memcpy(&a, src + i, 8);                                         \
+      memcpy(&b, mask + i, 8);                                        \
+      a = a OP b;                                                     \
+      memcpy(dst + i, &a, 8);                                         \
+    }                                                                 \
+    for (; i < len; i++) dst[i] = (uint8_t)(src[i] OP mask[i]);       \
+  }
+
+BITWISE_SCALAR(xor, ^)
+BITWISE_SCALAR(and, &)
+BITWISE_SCALAR(or, |)
+
+static uint64_t popcount_scalar(const uint8_t* p, size_t len) {
+  uint64_t count = 0;
+  size_t i = 0;
+
+  for (; i + 8 <= len; i += 8) {
+    uint64_t w;
+    memcpy(&w, p + i, 8);
+    count += (uint64_t)__builtin_popcountll(w);
+  }
+  for (; i < len; i++) count += (uint64_t)__builtin_popcount(p[i]);
+
+  return count;
+}
+
+#if BUFFER_X86
+
+#define BITWISE_AVX2(name, VOP)                                         \
+  __attribute__((target("avx2"))) static void name##_avx2(              \
+      uint8_t* dst, const uint8_t* src, const uint8_t* mask, size_t len) { \
+    size_t i = 0;                                                       \
+    for (; i + 32 <= len; i += 32) {                                    \
+      __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));        \
+      __m256i b = _mm256_loadu_si256((const __m256i*)(mask + i));       \
+      _mm256_storeu_si256((__m256i*)(dst + i), VOP(a, b));              \
+    }                                                                   \
+    name##_scalar(dst + i, src + i, mask + i, len - i);                 \
+  }
+
+BITWISE_AVX2(xor, _mm256_xor_si256)
+BITWISE_AVX2(and, _mm256_and_si256)
+BITWISE_AVX2(or, _mm256_or_si256)
+
+// Nibble lookup popcount (Mula et al.): per-byte counts are summed in 8-bit
+// lanes for up to 31 vectors, then widened with vpsadbw.
+__attribute__((target("avx2"))) static uint64_t popcount_avx2(
+    const uint8_t* p, size_t len) {
+  const __m256i lut =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i total = zero;
+  size_t i = 0;
+
+  while (len - i >= 32) {
+    size_t vectors = (len - i) / 32;
+    if (vectors > 31) vectors = 31;
+
+    __m256i acc = zero;
+    for (size_t end = i + vectors * 32; i < end; i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+      __m256i lo = _mm256_and_si256(v, low);
+      __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+      acc = _mm256_add_epi8(acc, _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo),
+                                                 _mm256_shuffle_epi8(lut, hi)));
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, zero));
+  }
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, total);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         popcount_scalar(p + i, len - i);
+}
+
+#endif
+
+typedef enum { BITWISE_XOR, BITWISE_AND, BITWISE_OR, BITWISE_COUNT } BitwiseOp;
+
+static bitwise_fn bitwise_impl[BITWISE_COUNT];
+static uint64_t (*popcount_impl)(const uint8_t*, size_t);
+
+static void bitwise_select(void) {
+#if BUFFER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    bitwise_impl[BITWISE_XOR] = xor_avx2;
+    bitwise_impl[BITWISE_AND] = and_avx2;
+    bitwise_impl[BITWISE_OR] = or_avx2;
+    popcount_impl = popcount_avx2;
+    return;
+  }
+#endif
+  bitwise_impl[BITWISE_XOR] = xor_scalar;
+  bitwise_impl[BITWISE_AND] = and_scalar;
+  bitwise_impl[BITWISE_OR] = or_scalar;
+  popcount_impl = popcount_scalar;
+}
+
+uint64_t buffer_popcount(const uint8_t* p, size_t len) {
+  if (!popcount_impl) bitwise_select();
+  return popcount_impl(p, len);
+}
+
+// Applies `mask` over `len` bytes, repeating it from the first byte when it is
+// shorter than the range.
+static void apply_mask(lua_State* L, BitwiseOp op, uint8_t* dst,
+                       const uint8_t* src, size_t len, const uint8_t* mask,
+                       size_t mask_len) {
+  uint8_t pattern[PATTERN_MAX];
+  uint8_t* copy = NULL;
+  uint8_t* src_copy = NULL;
+
+  if (!bitwise_impl[op]) bitwise_select();
+
+  if (src != dst && src < dst + len && dst < src + len) {
+    // Blocks would read source bytes an earlier block already overwrote.
+    src_copy = malloc(len);
+    if (!src_copy) throw_luaoom(L, len);
+    memcpy(src_copy, src, len);
+    src = src_copy;
+  }
+
+  if (mask_len < len && mask_len <= PATTERN_MAX / 2) {
+    size_t reps = PATTERN_MAX / mask_len;
+    buffer_fill_pattern(pattern, reps * mask_len, mask, mask_len);
+    mask = pattern;
+    mask_len *= reps;
+  } else if (mask < dst + len && dst < mask + mask_len) {
+    // A long mask that aliases the output must be read before it changes.
+    copy = malloc(mask_len);
+    if (!copy) {
+      free(src_copy);
+      throw_luaoom(L, mask_len);
+    }
+    memcpy(copy, mask, mask_len);
+    mask = copy;
+  }
+
+  for (size_t i = 0; i < len; i += mask_len) {
+    size_t n = len - i < mask_len ? len - i : mask_len;
+    bitwise_impl[op](dst + i, src + i, mask, n);
+  }
+
+  free(copy);
+  free(src_copy);
+}
+
+// Destination for the result: `buf` itself, or the Buffer at `arg` when given.
+static uint8_t* check_target(lua_State* L, int arg, Buffer* buf,
+                             size_t offset, size_t len) {
+  if (lua_isnoneornil(L, arg)) {
+    lua_settop(L, 1);
+    return buf->buffer + offset;
+  }
+
+  Buffer* out = luaL_checkudata(L, arg, BUFFER_MT);
+  if (out->size < len)
+    luaL_error(L, "Target buffer too small (need %I bytes, got %I)",
+               (lua_Integer)len, (lua_Integer)out->size);
+
+  lua_settop(L, arg);
+  return out->buffer;
+}
+
+// buf:<op>(operand, [start], [end], [target]) -> target | buf
+// The operand is a byte, a Buffer or a string of raw bytes.
+static int bitwise_op(lua_State* L, BitwiseOp op) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  uint8_t byte;
+  size_t mask_len;
+  const uint8_t* mask;
+
+  switch (lua_type(L, 2)) {
+    case LUA_TNUMBER:
+      byte = (uint8_t)(check_int_value(L, 2) & 0xFF);
+      mask = &byte;
+      mask_len = 1;
+      break;
+    case LUA_TSTRING:
+      mask = (const uint8_t*)lua_tolstring(L, 2, &mask_len);
+      break;
+    default: {
+      Buffer* other = luaL_checkudata(L, 2, BUFFER_MT);
+      mask = other->buffer;
+      mask_len = other->size;
+      break;
+    }
+  }
+
+  lua_Integer start = luaL_optinteger(L, 3, 1);
+  lua_Integer end = luaL_optinteger(L, 4, (lua_Integer)buf->size);
+
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+  uint8_t* dst = check_target(L, 5, buf, offset, len);
+
+  if (len && !mask_len) return luaL_argerror(L, 2, "empty operand");
+  if (len) apply_mask(L, op, dst, buf->buffer + offset, len, mask, mask_len);
+
+  return 1;
+}
+
+int l_buffer_xor(lua_State* L) { return bitwise_op(L, BITWISE_XOR); }
+int l_buffer_band(lua_State* L) { return bitwise_op(L, BITWISE_AND); }
+int l_buffer_bor(lua_State* L) { return bitwise_op(L, BITWISE_OR); }
+
+// buf:bnot([start], [end], [target]) -> target | buf
+int l_buffer_bnot(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  lua_Integer start = luaL_optinteger(L, 2, 1);
+  lua_Integer end = luaL_optinteger(L, 3, (lua_Integer)buf->size);
+
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+  uint8_t* dst = check_target(L, 4, buf, offset, len);
+
+  static const uint8_t ones = 0xFF;
+  if (len)
+    apply_mask(L, BITWISE_XOR, dst, buf->buffer + offset, len, &ones, 1);
+
+  return 1;
+}
+
+// buf:popcount([start], [end]) -> integer
+int l_buffer_popcount(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  lua_Integer start = luaL_optinteger(L, 2, 1);
+  lua_Integer end = luaL_optinteger(L, 3, (lua_Integer)buf->size);
+
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+
+  lua_pushinteger(L, (lua_Integer)buffer_popcount(buf->buffer + offset, len));
+  return 1;
+}
@@ -0,0 +1,271 @@
+#include "buffer_checksum.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer.h"
+#include "simd.h"
+#include "utils.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// Reflected polynomials: CRC-32 as used by zlib/PNG and CRC-32C (Castagnoli).
+#define CRC32_POLY 0xEDB88320u
+#define CRC32C_POLY 0x82F63B78u
+
+#define ADLER_MOD 65521u
+// Largest n such that 255 * n * (n + 1) / 2 + (n + 1) * (ADLER_MOD - 1) still
+// fits in 32 bits, so the modulo can wait that long.
+#define ADLER_NMAX 5552
+
+// Slice-by-8 tables: t[0] is the classic byte table, t[k] advances a byte
+// that sits k positions further back in the word.
+static uint32_t crc32_table[8][256];
+static uint32_t crc32c_table[8][256];
+
+static void crc_table_init(uint32_t t[8][256], uint32_t poly) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) c = (c >> 1) ^ (poly & (0u - (c & 1)));
+    t[0][i] = c;
+  }
+
+  for (int k = 1; k < 8; k++)
+    for (int i = 0; i < 256; i++)
+      t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+}
+
+// Kernels work on the inverted register; the public wrappers do the pre- and
+// post-conditioning.
+
+static uint32_t crc_slice8(const uint32_t t[8][256], uint32_t crc,
+                           const uint8_t* p, size_t len) {
+  for (; len >= 8; p += 8, len -= 8) {
+    uint32_t lo = load_u32(p, true) ^ crc;
+    uint32_t hi = load_u32(p + 4, true);
+    crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^
+          t[4][lo >> 24] ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^
+          t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+  }
+
+  while (len--) crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+static uint32_t crc32_scalar(uint32_t crc, const uint8_t* p, size_t len) {
+  return crc_slice8(crc32_table, crc, p, len);
+}
+
+static uint32_t crc32c_scalar(uint32_t crc, const uint8_t* p, size_t len) {
+  return crc_slice8(crc32c_table, crc, p, len);
+}
+
+#if BUFFER_X86
+
+// Folds four 128-bit lanes with carry-less multiplies, then Barrett-reduces
+// to 32 bits. The constants are the bit-reflected x^k mod P(x) values from
+// Intel's "Fast CRC Computation Using PCLMULQDQ" paper. Wants len >= 64 and a
+// multiple of 16.
+__attribute__((target("sse4.1,pclmul"))) static uint32_t crc32_fold_pclmul(
+    uint32_t crc, const uint8_t* p, size_t len) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+  x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+  x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+  x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  p += 64;
+  len -= 64;
+
+  for (; len >= 64; p += 64, len -= 64) {
+    x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128((const __m128i*)(p + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                       _mm_loadu_si128((const __m128i*)(p + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                       _mm_loadu_si128((const __m128i*)(p + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                       _mm_loadu_si128((const __m128i*)(p + 0x30)));
+  }
+
+  // Fold the four lanes into one, then any remaining 16-byte blocks.
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  for (; len >= 16; p += 16, len -= 16) {
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                       _mm_loadu_si128((const __m128i*)p));
+  }
+
+  // 128 -> 64 bits.
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits.
+  x0 = _mm_and_si128(x1, mask32);
+  x0 = _mm_clmulepi64_si128(x0, poly, 0x10);
+  x0 = _mm_and_si128(x0, mask32);
+  x0 = _mm_clmulepi64_si128(x0, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x0);
+
+  return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t* p, size_t len) {
+  if (len >= 64) {
+    size_t n = len & ~(size_t)15;
+    crc = crc32_fold_pclmul(crc, p, n);
+    p += n;
+    len -= n;
+  }
+  return crc32_scalar(crc, p, len);
+}
+
+__attribute__((target("sse4.2"))) static uint32_t crc32c_sse42(
+    uint32_t crc, const uint8_t* p, size_t len) {
+#if defined(__x86_64__)
+  uint64_t c = crc;
+  for (; len >= 8; p += 8, len -= 8) c = _mm_crc32_u64(c, load_u64(p, true));
+  crc = (uint32_t)c;
+#endif
+  for (; len >= 4; p += 4, len -= 4)
+    crc = _mm_crc32_u32(crc, load_u32(p, true));
+  while (len--) crc = _mm_crc32_u8(crc, *p++);
+  return crc;
+}
+
+#elif defined(__ARM_FEATURE_CRC32)
+
+// The ARMv8 CRC extension covers both polynomials.
+
+static uint32_t crc32_arm(uint32_t crc, const uint8_t* p, size_t len) {
+  for (; len >= 8; p += 8, len -= 8) crc = __crc32d(crc, load_u64(p, true));
+  while (len--) crc = __crc32b(crc, *p++);
+  return crc;
+}
+
+static uint32_t crc32c_arm(uint32_t crc, const uint8_t* p, size_t len) {
+  for (; len >= 8; p += 8, len -= 8) crc = __crc32cd(crc, load_u64(p, true));
+  while (len--) crc = __crc32cb(crc, *p++);
+  return crc;
+}
+
+#endif
+
+typedef uint32_t (*checksum_fn)(uint32_t, const uint8_t*, size_t);
+
+static checksum_fn crc32_impl;
+static checksum_fn crc32c_impl;
+
+static void checksum_select(void) {
+  crc_table_init(crc32_table, CRC32_POLY);
+  crc_table_init(crc32c_table, CRC32C_POLY);
+
+  crc32_impl = crc32_scalar;
+  crc32c_impl = crc32c_scalar;
+
+#if BUFFER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))
+    crc32_impl = crc32_pclmul;
+  if (__builtin_cpu_supports("sse4.2")) crc32c_impl = crc32c_sse42;
+#elif defined(__ARM_FEATURE_CRC32)
+  crc32_impl = crc32_arm;
+  crc32c_impl = crc32c_arm;
+#endif
+}
+
+uint32_t buffer_crc32(uint32_t crc, const uint8_t* p, size_t len) {
+  if (!crc32_impl) checksum_select();
+  return ~crc32_impl(~crc, p, len);
+}
+
+uint32_t buffer_crc32c(uint32_t crc, const uint8_t* p, size_t len) {
+  if (!crc32c_impl) checksum_select();
+  return ~crc32c_impl(~crc, p, len);
+}
+
+uint32_t buffer_adler32(uint32_t adler, const uint8_t* p, size_t len) {
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+
+  while (len) {
+    size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+    len -= n;
+
+    for (; n >= 8; p += 8, n -= 8) {
+      for (int k = 0; k < 8; k++) {
+        a += p[k];
+        b += a;
+      }
+    }
+    while (n--) {
+      a += *p++;
+      b += a;
+    }
+
+    a %= ADLER_MOD;
+    b %= ADLER_MOD;
+  }
+
+  return (b << 16) | a;
+}
+
+// buf:<checksum>([start], [end], [seed]) -> integer
+static int push_checksum(lua_State* L, checksum_fn fn, lua_Integer seed) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  lua_Integer start = luaL_optinteger(L, 2, 1);
+  lua_Integer end = luaL_optinteger(L, 3, (lua_Integer)buf->size);
+  seed = luaL_optinteger(L, 4, seed);
+
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+
+  lua_pushinteger(L, fn((uint32_t)seed, buf->buffer + offset, len));
+  return 1;
+}
+
+int l_buffer_crc32(lua_State* L) { return push_checksum(L, buffer_crc32, 0); }
+
+int l_buffer_crc32c(lua_State* L) { return push_checksum(L, buffer_crc32c, 0); }
+
+int l_buffer_adler32(lua_State* L) {
+  return push_checksum(L, buffer_adler32, 1);
+}
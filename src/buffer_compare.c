@@ -0,0 +1,193 @@
+#include "buffer_compare.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "simd.h"
+#include "utils.h"
+
+static size_t mismatch_scalar(const uint8_t* a, const uint8_t* b, size_t len) {
+  size_t i = 0;
+
+  // Word at a time; the lowest differing byte of the XOR is the first
+  // mismatch once both words are read little-endian.
+  for (; i + 8 <= len; i += 8) {
+    uint64_t diff = load_u64(a + i, true) ^ load_u64(b + i, true);
+    if (diff) return i + (size_t)__builtin_ctzll(diff) / 8;
+  }
+
+  for (; i < len; i++)
+    if (a[i] != b[i]) return i;
+  return len;
+}
+
+#if BUFFER_X86
+
+__attribute__((target("avx2"))) static size_t mismatch_avx2(const uint8_t* a,
+                                                            const uint8_t* b,
+                                                            size_t len) {
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i b0 = _mm256_loadu_si256((const __m256i*)(b + i));
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(a + i + 32));
+    __m256i b1 = _mm256_loadu_si256((const __m256i*)(b + i + 32));
+    uint32_t eq0 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a0, b0));
+    uint32_t eq1 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a1, b1));
+
+    if ((eq0 & eq1) != UINT32_MAX) {
+      if (eq0 != UINT32_MAX) return i + (size_t)__builtin_ctz(~eq0);
+      return i + 32 + (size_t)__builtin_ctz(~eq1);
+    }
+  }
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i av = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i bv = _mm256_loadu_si256((const __m256i*)(b + i));
+    uint32_t eq = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(av, bv));
+    if (eq != UINT32_MAX) return i + (size_t)__builtin_ctz(~eq);
+  }
+
+  return i + mismatch_scalar(a + i, b + i, len - i);
+}
+
+#elif BUFFER_NEON
+
+static size_t mismatch_neon(const uint8_t* a, const uint8_t* b, size_t len) {
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    if (vminvq_u8(eq) != 0xFF) return i + mismatch_scalar(a + i, b + i, 16);
+  }
+
+  return i + mismatch_scalar(a + i, b + i, len - i);
+}
+
+#endif
+
+typedef size_t (*mismatch_fn)(const uint8_t*, const uint8_t*, size_t);
+
+static mismatch_fn mismatch_impl;
+
+static void compare_select(void) {
+#if BUFFER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    mismatch_impl = mismatch_avx2;
+    return;
+  }
+#elif BUFFER_NEON
+  mismatch_impl = mismatch_neon;
+  return;
+#endif
+  mismatch_impl = mismatch_scalar;
+}
+
+size_t buffer_mismatch(const uint8_t* a, const uint8_t* b, size_t len) {
+  if (!mismatch_impl) compare_select();
+  return mismatch_impl(a, b, len);
+}
+
+// A Buffer or a string.
+static const uint8_t* check_bytes(lua_State* L, int arg, size_t* len) {
+  Buffer* buf = luaL_testudata(L, arg, BUFFER_MT);
+  if (buf) {
+    *len = buf->size;
+    return buf->buffer;
+  }
+
+  if (lua_type(L, arg) != LUA_TSTRING)
+    luaL_typeerror(L, arg, "buffer or string");
+  return (const uint8_t*)lua_tolstring(L, arg, len);
+}
+
+// Optional [start, end] range of the bytes at `data`, 1-based inclusive like
+// slice().
+static const uint8_t* opt_range(lua_State* L, int arg, const uint8_t* data,
+                                size_t* len) {
+  lua_Integer start = luaL_optinteger(L, arg, 1);
+  lua_Integer end = luaL_optinteger(L, arg + 1, (lua_Integer)*len);
+  size_t offset;
+  *len = resolve_range(*len, start, end, &offset);
+  return data + offset;
+}
+
+// Pushes -1/0/1 and the 1-based index of the first differing byte (nil when
+// equal). A strict prefix sorts first and differs right after its end.
+static int push_order(lua_State* L, const uint8_t* a, size_t a_len,
+                      const uint8_t* b, size_t b_len) {
+  size_t common = a_len < b_len ? a_len : b_len;
+  size_t at = buffer_mismatch(a, b, common);
+
+  if (at < common) {
+    lua_pushinteger(L, a[at] < b[at] ? -1 : 1);
+    lua_pushinteger(L, (lua_Integer)at + 1);
+  } else if (a_len != b_len) {
+    lua_pushinteger(L, a_len < b_len ? -1 : 1);
+    lua_pushinteger(L, (lua_Integer)common + 1);
+  } else {
+    lua_pushinteger(L, 0);
+    lua_pushnil(L);
+  }
+
+  return 2;
+}
+
+// buffer.compare(a, b) -> -1 | 0 | 1, first differing index | nil
+int l_buffer_compare(lua_State* L) {
+  size_t a_len, b_len;
+  const uint8_t* a = check_bytes(L, 1, &a_len);
+  const uint8_t* b = check_bytes(L, 2, &b_len);
+  return push_order(L, a, a_len, b, b_len);
+}
+
+// buf:compare(target, [tStart], [tEnd], [sStart], [sEnd]) -> same as above
+int l_buffer_compare_method(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  size_t t_len, s_len = buf->size;
+  const uint8_t* t = check_bytes(L, 2, &t_len);
+
+  t = opt_range(L, 3, t, &t_len);
+  const uint8_t* s = opt_range(L, 5, buf->buffer, &s_len);
+  return push_order(L, s, s_len, t, t_len);
+}
+
+// buf:equals(other, [tStart], [tEnd], [sStart], [sEnd]) -> boolean
+// Compares buf[sStart..sEnd] with other[tStart..tEnd] without slicing.
+int l_buffer_equals(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  size_t t_len, s_len = buf->size;
+  const uint8_t* t = check_bytes(L, 2, &t_len);
+
+  t = opt_range(L, 3, t, &t_len);
+  const uint8_t* s = opt_range(L, 5, buf->buffer, &s_len);
+
+  lua_pushboolean(L, s_len == t_len && memcmp(s, t, s_len) == 0);
+  return 1;
+}
+
+// buffer.timingSafeEqual(a, b) -> boolean
+// Runs in time that depends only on the length, never on where the inputs
+// differ. Both must have the same length, as with Node.
+int l_buffer_timing_safe_equal(lua_State* L) {
+  size_t a_len, b_len;
+  const uint8_t* a = check_bytes(L, 1, &a_len);
+  const uint8_t* b = check_bytes(L, 2, &b_len);
+
+  if (a_len != b_len)
+    return luaL_error(L, "Input buffers must have the same byte length");
+
+  // volatile keeps the compiler from turning this into an early-exit loop.
+  volatile uint8_t diff = 0;
+  for (size_t i = 0; i < a_len; i++) diff |= a[i] ^ b[i];
+
+  lua_pushboolean(L, diff == 0);
+  return 1;
+}
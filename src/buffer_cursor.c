@@ -0,0 +1,396 @@
+#include "buffer_cursor.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "buffer_alloc.h"
+#include "buffer_mem.h"
+#include "buffer_rw.h"
+#include "errors.h"
+#include "utils.h"
+
+static inline size_t cursor_left(const BufferCursor* c) {
+  return (size_t)(c->end - c->cur);
+}
+
+static void cursor_overrun(lua_State* L, const BufferCursor* c, size_t n) {
+  luaL_error(L,
+             "attempt to access memory outside buffer bounds (offset=%I, "
+             "size=%I, len=%I)",
+             (lua_Integer)(c->cur - c->base) + 1,
+             (lua_Integer)(c->end - c->base), (lua_Integer)n);
+}
+
+// Hands out the next `n` bytes for reading and advances past them.
+static inline const uint8_t* cursor_take(lua_State* L, BufferCursor* c,
+                                         size_t n) {
+  if (cursor_left(c) < n) cursor_overrun(L, c, n);
+  const uint8_t* p = c->cur;
+  c->cur += n;
+  return p;
+}
+
+static bool cursor_grow(lua_State* L, BufferCursor* c, size_t n) {
+  size_t used = (size_t)(c->cur - c->base);
+  size_t cap = (size_t)(c->end - c->base);
+
+  if (n > SIZE_MAX - used) return false;
+
+  size_t ncap = cap ? cap : BUFFER_WRITER_DEFAULT_CAPACITY;
+  while (ncap < used + n) {
+    if (ncap > SIZE_MAX / 2) {
+      ncap = used + n;
+      break;
+    }
+    ncap *= 2;
+  }
+
+  BufferMem* mem = buffer_mem(L);
+  uint8_t* base = c->base ? buffer_mem_realloc(mem, c->base, cap, ncap)
+                          : buffer_mem_alloc(mem, ncap);
+  if (!base) return false;
+
+  c->base = base;
+  c->cur = base + used;
+  c->end = base + ncap;
+  buffer_mem_pace(L, mem);
+  return true;
+}
+
+// Makes sure `n` bytes can be written at the cursor, growing the storage of
+// growable writers, and returns where they go. Doesn't advance.
+uint8_t* cursor_reserve(lua_State* L, BufferCursor* c, size_t n) {
+  if (cursor_left(c) < n) {
+    if (!c->growable) cursor_overrun(L, c, n);
+    if (!cursor_grow(L, c, n)) throw_luaoom(L, n);
+  }
+  return c->cur;
+}
+
+static inline uint8_t* cursor_put(lua_State* L, BufferCursor* c, size_t n) {
+  uint8_t* p = cursor_reserve(L, c, n);
+  c->cur += n;
+  return p;
+}
+
+// Pushes a Buffer holding everything written so far and resets the writer.
+// The storage is handed over as is, no copy.
+int cursor_finish(lua_State* L, BufferCursor* c) {
+  size_t len = (size_t)(c->cur - c->base);
+  size_t cap = (size_t)(c->end - c->base);
+
+  if (len == 0) {
+    if (c->base) buffer_mem_free(buffer_mem(L), c->base, cap);
+    buffer_new(L, 0, false);
+  } else {
+    Buffer* buf = buffer_adopt(L, c->base, len);
+    buf->capacity = cap;
+  }
+
+  c->base = c->cur = c->end = NULL;
+  return 1;
+}
+
+static BufferCursor* cursor_new(lua_State* L, const char* mt) {
+  BufferCursor* c = lua_newuserdatauv(L, sizeof(BufferCursor), 1);
+  c->base = c->cur = c->end = NULL;
+  c->growable = false;
+
+  luaL_getmetatable(L, mt);
+  lua_setmetatable(L, -2);
+  return c;
+}
+
+// buf:reader([offset]) / buf:writer([offset])
+static int cursor_from_buffer(lua_State* L, const char* mt) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  lua_Integer offset = luaL_optinteger(L, 2, 1);
+
+  if (offset < 1 || offset > (lua_Integer)buf->size + 1)
+    return luaL_error(L, ERR_OUT_OF_RANGE, "offset",
+                      (lua_Integer)buf->size + 1, offset);
+
+  BufferCursor* c = cursor_new(L, mt);
+  c->base = buf->buffer;
+  c->cur = buf->buffer + (offset - 1);
+  c->end = buf->buffer + buf->size;
+
+  lua_pushvalue(L, 1);
+  lua_setiuservalue(L, -2, 1);
+  return 1;
+}
+
+int l_buffer_reader(lua_State* L) {
+  return cursor_from_buffer(L, BUFFER_READER_MT);
+}
+
+int l_buffer_writer(lua_State* L) {
+  return cursor_from_buffer(L, BUFFER_WRITER_MT);
+}
+
+BufferCursor* buffer_writer_new(lua_State* L, size_t capacity) {
+  BufferCursor* c = cursor_new(L, BUFFER_WRITER_MT);
+  c->growable = true;
+  if (capacity > 0 && !cursor_grow(L, c, capacity)) throw_luaoom(L, capacity);
+  return c;
+}
+
+// buffer.writer([capacity]) / buffer.builder([capacity]) -> growable writer
+int l_buffer_new_writer(lua_State* L) {
+  lua_Integer capacity =
+      luaL_optinteger(L, 1, BUFFER_WRITER_DEFAULT_CAPACITY);
+  luaL_argcheck(L, capacity >= 0, 1, "capacity must be >= 0");
+  buffer_writer_new(L, (size_t)capacity);
+  return 1;
+}
+
+#define CURSOR_INT_METHODS(name, bits, ctype, little)                        \
+  static int reader_##name(lua_State* L) {                                   \
+    BufferCursor* c = luaL_checkudata(L, 1, BUFFER_READER_MT);               \
+    ctype v = (ctype)load_u##bits(cursor_take(L, c, bits / 8), little);      \
+    lua_pushinteger(L, (lua_Integer)v);                                      \
+    return 1;                                                                \
+  }                                                                          \
+  static int writer_##name(lua_State* L) {                                   \
+    BufferCursor* c = luaL_checkudata(L, 1, BUFFER_WRITER_MT);               \
+    lua_Integer v = check_int_value(L, 2);                                   \
+    store_u##bits(cursor_put(L, c, bits / 8), (uint##bits##_t)v, little);    \
+    lua_settop(L, 1);                                                        \
+    return 1;                                                                \
+  }
+
+#define CURSOR_FLOAT_METHODS(name, bits, ftype, little)                      \
+  static int reader_##name(lua_State* L) {                                   \
+    BufferCursor* c = luaL_checkudata(L, 1, BUFFER_READER_MT);               \
+    uint##bits##_t raw = load_u##bits(cursor_take(L, c, bits / 8), little);  \
+    ftype v;                                                                 \
+    memcpy(&v, &raw, sizeof(v));                                             \
+    lua_pushnumber(L, (lua_Number)v);                                        \
+    return 1;                                                                \
+  }                                                                          \
+  static int writer_##name(lua_State* L) {                                   \
+    BufferCursor* c = luaL_checkudata(L, 1, BUFFER_WRITER_MT);               \
+    ftype v = (ftype)luaL_checknumber(L, 2);                                 \
+    uint##bits##_t raw;                                                      \
+    memcpy(&raw, &v, sizeof(raw));                                           \
+    store_u##bits(cursor_put(L, c, bits / 8), raw, little);                  \
+    lua_settop(L, 1);                                                        \
+    return 1;                                                                \
+  }
+
+CURSOR_INT_METHODS(u8, 8, uint8_t, true)
+CURSOR_INT_METHODS(i8, 8, int8_t, true)
+CURSOR_INT_METHODS(u16le, 16, uint16_t, true)
+CURSOR_INT_METHODS(u16be, 16, uint16_t, false)
+CURSOR_INT_METHODS(i16le, 16, int16_t, true)
+CURSOR_INT_METHODS(i16be, 16, int16_t, false)
+CURSOR_INT_METHODS(u32le, 32, uint32_t, true)
+CURSOR_INT_METHODS(u32be, 32, uint32_t, false)
+CURSOR_INT_METHODS(i32le, 32, int32_t, true)
+CURSOR_INT_METHODS(i32be, 32, int32_t, false)
+CURSOR_INT_METHODS(u64le, 64, uint64_t, true)
+CURSOR_INT_METHODS(u64be, 64, uint64_t, false)
+CURSOR_INT_METHODS(i64le, 64, int64_t, true)
+CURSOR_INT_METHODS(i64be, 64, int64_t, false)
+
+CURSOR_FLOAT_METHODS(f32le, 32, float, true)
+CURSOR_FLOAT_METHODS(f32be, 32, float, false)
+CURSOR_FLOAT_METHODS(f64le, 64, double, true)
+CURSOR_FLOAT_METHODS(f64be, 64, double, false)
+
+static BufferCursor* check_cursor(lua_State* L, int arg) {
+  BufferCursor* c = luaL_testudata(L, arg, BUFFER_READER_MT);
+  return c ? c : luaL_checkudata(L, arg, BUFFER_WRITER_MT);
+}
+
+static size_t check_count(lua_State* L, int arg) {
+  lua_Integer n = luaL_checkinteger(L, arg);
+  luaL_argcheck(L, n >= 0, arg, "count must be >= 0");
+  return (size_t)n;
+}
+
+// r:bytes(n) -> string
+static int reader_bytes(lua_State* L) {
+  BufferCursor* c = luaL_checkudata(L, 1, BUFFER_READER_MT);
+  size_t n = check_count(L, 2);
+  lua_pushlstring(L, (const char*)cursor_take(L, c, n), n);
+  return 1;
+}
+
+// r:skip(n) -> r
+static int reader_skip(lua_State* L) {
+  BufferCursor* c = luaL_checkudata(L, 1, BUFFER_READER_MT);
+  cursor_take(L, c, check_count(L, 2));
+  lua_settop(L, 1);
+  return 1;
+}
+
+// r:seek(offset) -> r
+static int reader_seek(lua_State* L) {
+  BufferCursor* c = luaL_checkudata(L, 1, BUFFER_READER_MT);
+  lua_Integer offset = luaL_checkinteger(L, 2);
+  lua_Integer size = (lua_Integer)(c->end - c->base);
+
+  if (offset < 1 || offset > size + 1)
+    return luaL_error(L, ERR_OUT_OF_RANGE, "offset", size + 1, offset);
+
+  c->cur = c->base + (offset - 1);
+  lua_settop(L, 1);
+  return 1;
+}
+
+// w:bytes(string | buffer) -> w
+static int writer_bytes(lua_State* L) {
+  BufferCursor* c = luaL_checkudata(L, 1, BUFFER_WRITER_MT);
+  const void* src;
+  size_t len;
+
+  Buffer* buf = luaL_testudata(L, 2, BUFFER_MT);
+  if (buf) {
+    src = buf->buffer;
+    len = buf->size;
+  } else {
+    src = luaL_checklstring(L, 2, &len);
+  }
+
+  // memmove: the source may be the very buffer this writer points into.
+  if (len > 0) memmove(cursor_put(L, c, len), src, len);
+  lua_settop(L, 1);
+  return 1;
+}
+
+// w:skip(n) -> w; bytes skipped by a growable writer are zeroed
+static int writer_skip(lua_State* L) {
+  BufferCursor* c = luaL_checkudata(L, 1, BUFFER_WRITER_MT);
+  size_t n = check_count(L, 2);
+  uint8_t* p = cursor_put(L, c, n);
+  if (c->growable) memset(p, 0, n);
+  lua_settop(L, 1);
+  return 1;
+}
+
+// w:reserve(n) -> w; makes room for n more bytes without advancing
+static int writer_reserve(lua_State* L) {
+  BufferCursor* c = luaL_checkudata(L, 1, BUFFER_WRITER_MT);
+  cursor_reserve(L, c, check_count(L, 2));
+  lua_settop(L, 1);
+  return 1;
+}
+
+// w:finish() -> Buffer (growable writers only)
+static int writer_finish(lua_State* L) {
+  BufferCursor* c = luaL_checkudata(L, 1, BUFFER_WRITER_MT);
+  if (!c->growable)
+    return luaL_error(L, "finish is only available on growable writers");
+  return cursor_finish(L, c);
+}
+
+// c:remaining() -> bytes left before the end of the window
+static int cursor_remaining(lua_State* L) {
+  BufferCursor* c = check_cursor(L, 1);
+  lua_pushinteger(L, (lua_Integer)cursor_left(c));
+  return 1;
+}
+
+// c:tell() -> 1-based offset of the next byte
+static int cursor_tell(lua_State* L) {
+  BufferCursor* c = check_cursor(L, 1);
+  lua_pushinteger(L, (lua_Integer)(c->cur - c->base) + 1);
+  return 1;
+}
+
+static int writer__gc(lua_State* L) {
+  BufferCursor* c = luaL_checkudata(L, 1, BUFFER_WRITER_MT);
+  if (c->growable && c->base)
+    buffer_mem_free(buffer_mem(L), c->base, (size_t)(c->end - c->base));
+  c->base = c->cur = c->end = NULL;
+  return 0;
+}
+
+#define CURSOR_ACCESSOR(prefix, name) {#name, prefix##_##name}
+
+#define CURSOR_ACCESSORS(prefix)                                             \
+  CURSOR_ACCESSOR(prefix, u8), CURSOR_ACCESSOR(prefix, i8),                  \
+      CURSOR_ACCESSOR(prefix, u16le), CURSOR_ACCESSOR(prefix, u16be),        \
+      CURSOR_ACCESSOR(prefix, i16le), CURSOR_ACCESSOR(prefix, i16be),        \
+      CURSOR_ACCESSOR(prefix, u32le), CURSOR_ACCESSOR(prefix, u32be),        \
+      CURSOR_ACCESSOR(prefix, i32le), CURSOR_ACCESSOR(prefix, i32be),        \
+      CURSOR_ACCESSOR(prefix, u64le), CURSOR_ACCESSOR(prefix, u64be),        \
+      CURSOR_ACCESSOR(prefix, i64le), CURSOR_ACCESSOR(prefix, i64be),        \
+      CURSOR_ACCESSOR(prefix, f32le), CURSOR_ACCESSOR(prefix, f32be),        \
+      CURSOR_ACCESSOR(prefix, f64le), CURSOR_ACCESSOR(prefix, f64be)
+
+static const luaL_Reg writer_formats[] = {
+    //
+    CURSOR_ACCESSORS(writer),
+    {NULL, NULL}};
+
+// w:append(string | buffer) -> w
+// w:append(number, format) -> w, `format` naming one of the typed writers
+// ("u8", "i32be", "f64le", ...)
+static int writer_append(lua_State* L) {
+  luaL_checkudata(L, 1, BUFFER_WRITER_MT);
+
+  if (lua_type(L, 2) != LUA_TNUMBER) {
+    lua_settop(L, 2);
+    return writer_bytes(L);
+  }
+
+  const char* format = luaL_checkstring(L, 3);
+  for (const luaL_Reg* f = writer_formats; f->name; f++) {
+    if (strcmp(f->name, format) == 0) {
+      lua_settop(L, 2);
+      return f->func(L);
+    }
+  }
+
+  return luaL_argerror(L, 3, lua_pushfstring(L, "invalid format '%s'", format));
+}
+
+static const luaL_Reg reader_methods[] = {
+    //
+    CURSOR_ACCESSORS(reader),
+    {"bytes", reader_bytes},
+    {"skip", reader_skip},
+    {"seek", reader_seek},
+    {"remaining", cursor_remaining},
+    {"tell", cursor_tell},
+    {NULL, NULL}};
+
+static const luaL_Reg writer_methods[] = {
+    //
+    CURSOR_ACCESSORS(writer),
+    {"bytes", writer_bytes},
+    {"skip", writer_skip},
+    {"append", writer_append},
+    {"reserve", writer_reserve},
+    {"finish", writer_finish},
+    {"remaining", cursor_remaining},
+    {"tell", cursor_tell},
+    {NULL, NULL}};
+
+static void cursor_metatable(lua_State* L, const char* mt,
+                             const luaL_Reg* methods, lua_CFunction gc) {
+  luaL_newmetatable(L, mt);
+
+  if (gc) {
+    lua_pushcfunction(L, gc);
+    lua_setfield(L, -2, "__gc");
+  }
+
+  lua_newtable(L);
+  luaL_setfuncs(L, methods, 0);
+  lua_setfield(L, -2, "__index");
+
+  lua_pop(L, 1);
+}
+
+void buffer_cursor_open(lua_State* L) {
+  cursor_metatable(L, BUFFER_READER_MT, reader_methods, NULL);
+  cursor_metatable(L, BUFFER_WRITER_MT, writer_methods, writer__gc);
+}
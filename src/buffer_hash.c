@@ -0,0 +1,724 @@
+#include "buffer_hash.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "simd.h"
+#include "utils.h"
+
+// XXH3, following the layout of the reference xxhash.h (v0.8): inputs up to
+// 240 bytes take dedicated short paths, longer ones run eight 64-bit
+// accumulators over 64-byte stripes with a scramble every 1 KiB block. Only
+// the default secret (optionally derived from a seed) is supported.
+
+#define PRIME32_1 0x9E3779B1u
+#define PRIME32_2 0x85EBCA77u
+#define PRIME32_3 0xC2B2AE3Du
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+#define PRIME_MX1 0x165667919E3779F9ull
+#define PRIME_MX2 0x9FB21C651E98DF25ull
+
+#define STRIPE_LEN 64
+#define SECRET_SIZE 192
+#define SECRET_SIZE_MIN 136
+#define SECRET_CONSUME_RATE 8
+#define SECRET_LIMIT (SECRET_SIZE - STRIPE_LEN)
+#define STRIPES_PER_BLOCK (SECRET_LIMIT / SECRET_CONSUME_RATE)
+#define BLOCK_LEN (STRIPE_LEN * STRIPES_PER_BLOCK)
+
+#define MIDSIZE_MAX 240
+#define MIDSIZE_STARTOFFSET 3
+#define MIDSIZE_LASTOFFSET 17
+#define SECRET_MERGEACCS_START 11
+#define SECRET_LASTACC_START 7
+
+// Streaming state buffers this much input before accumulating it.
+#define HASHER_BUFFER_SIZE 256
+
+static const uint8_t K_SECRET[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+#define ACC_INIT                                                      \
+  {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, \
+   PRIME64_5, PRIME32_1}
+
+typedef struct {
+  uint64_t acc[8];
+  uint8_t secret[SECRET_SIZE];
+  uint8_t buffer[HASHER_BUFFER_SIZE];
+  uint64_t seed;
+  uint64_t total_len;
+  size_t buffered;
+  size_t stripes_so_far;  // stripes accumulated in the current block
+} BufferHasher;
+
+// Arithmetic helpers
+
+static inline uint64_t read64(const uint8_t* p) { return load_u64(p, true); }
+static inline uint32_t read32(const uint8_t* p) { return load_u32(p, true); }
+
+static inline uint64_t rotl64(uint64_t v, int r) {
+  return (v << r) | (v >> (64 - r));
+}
+
+static inline uint32_t rotl32(uint32_t v, int r) {
+  return (v << r) | (v >> (32 - r));
+}
+
+static inline BufferHash128 mult64to128(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 p = (unsigned __int128)a * b;
+  return (BufferHash128){(uint64_t)p, (uint64_t)(p >> 64)};
+#else
+  uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+  uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+  uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+  uint64_t hi_hi = (a >> 32) * (b >> 32);
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  return (BufferHash128){(cross << 32) | (lo_lo & 0xFFFFFFFF), upper};
+#endif
+}
+
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+  BufferHash128 p = mult64to128(a, b);
+  return p.lo ^ p.hi;
+}
+
+static uint64_t xxh64_avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+static uint64_t xxh3_avalanche(uint64_t h) {
+  h ^= h >> 37;
+  h *= PRIME_MX1;
+  h ^= h >> 32;
+  return h;
+}
+
+static uint64_t rrmxmx(uint64_t h, uint64_t len) {
+  h ^= rotl64(h, 49) ^ rotl64(h, 24);
+  h *= PRIME_MX2;
+  h ^= (h >> 35) + len;
+  h *= PRIME_MX2;
+  return h ^ (h >> 28);
+}
+
+static inline uint64_t mix16(const uint8_t* in, const uint8_t* secret,
+                             uint64_t seed) {
+  return mul128_fold64(read64(in) ^ (read64(secret) + seed),
+                       read64(in + 8) ^ (read64(secret + 8) - seed));
+}
+
+// Short inputs, 64-bit
+
+static uint64_t hash64_0to16(const uint8_t* in, size_t len,
+                             const uint8_t* secret, uint64_t seed) {
+  if (len > 8) {
+    uint64_t flip1 = (read64(secret + 24) ^ read64(secret + 32)) + seed;
+    uint64_t flip2 = (read64(secret + 40) ^ read64(secret + 48)) - seed;
+    uint64_t lo = read64(in) ^ flip1;
+    uint64_t hi = read64(in + len - 8) ^ flip2;
+    return xxh3_avalanche(len + __builtin_bswap64(lo) + hi +
+                          mul128_fold64(lo, hi));
+  }
+
+  if (len >= 4) {
+    seed ^= (uint64_t)__builtin_bswap32((uint32_t)seed) << 32;
+    uint64_t in64 = read32(in + len - 4) + ((uint64_t)read32(in) << 32);
+    uint64_t flip = (read64(secret + 8) ^ read64(secret + 16)) - seed;
+    return rrmxmx(in64 ^ flip, len);
+  }
+
+  if (len) {
+    uint32_t combined = ((uint32_t)in[0] << 16) |
+                        ((uint32_t)in[len >> 1] << 24) |
+                        (uint32_t)in[len - 1] | ((uint32_t)len << 8);
+    uint64_t flip = (read32(secret) ^ read32(secret + 4)) + seed;
+    return xxh64_avalanche((uint64_t)combined ^ flip);
+  }
+
+  return xxh64_avalanche(seed ^ (read64(secret + 56) ^ read64(secret + 64)));
+}
+
+static uint64_t hash64_17to128(const uint8_t* in, size_t len,
+                               const uint8_t* secret, uint64_t seed) {
+  uint64_t acc = len * PRIME64_1;
+
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += mix16(in + 48, secret + 96, seed);
+        acc += mix16(in + len - 64, secret + 112, seed);
+      }
+      acc += mix16(in + 32, secret + 64, seed);
+      acc += mix16(in + len - 48, secret + 80, seed);
+    }
+    acc += mix16(in + 16, secret + 32, seed);
+    acc += mix16(in + len - 32, secret + 48, seed);
+  }
+  acc += mix16(in, secret, seed);
+  acc += mix16(in + len - 16, secret + 16, seed);
+
+  return xxh3_avalanche(acc);
+}
+
+static uint64_t hash64_129to240(const uint8_t* in, size_t len,
+                                const uint8_t* secret, uint64_t seed) {
+  uint64_t acc = len * PRIME64_1;
+  size_t rounds = len / 16;
+
+  for (size_t i = 0; i < 8; i++)
+    acc += mix16(in + 16 * i, secret + 16 * i, seed);
+  acc = xxh3_avalanche(acc);
+
+  uint64_t acc_end = mix16(in + len - 16,
+                           secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET, seed);
+  for (size_t i = 8; i < rounds; i++)
+    acc_end +=
+        mix16(in + 16 * i, secret + 16 * (i - 8) + MIDSIZE_STARTOFFSET, seed);
+
+  return xxh3_avalanche(acc + acc_end);
+}
+
+// Short inputs, 128-bit
+
+static BufferHash128 hash128_0to16(const uint8_t* in, size_t len,
+                                   const uint8_t* secret, uint64_t seed) {
+  BufferHash128 h;
+
+  if (len > 8) {
+    uint64_t flip_lo = (read64(secret + 32) ^ read64(secret + 40)) - seed;
+    uint64_t flip_hi = (read64(secret + 48) ^ read64(secret + 56)) + seed;
+    uint64_t in_lo = read64(in);
+    uint64_t in_hi = read64(in + len - 8);
+
+    BufferHash128 m = mult64to128(in_lo ^ in_hi ^ flip_lo, PRIME64_1);
+    m.lo += (uint64_t)(len - 1) << 54;
+    in_hi ^= flip_hi;
+    m.hi += in_hi + (uint64_t)(uint32_t)in_hi * (PRIME32_2 - 1);
+    m.lo ^= __builtin_bswap64(m.hi);
+
+    h = mult64to128(m.lo, PRIME64_2);
+    h.hi += m.hi * PRIME64_2;
+    h.lo = xxh3_avalanche(h.lo);
+    h.hi = xxh3_avalanche(h.hi);
+    return h;
+  }
+
+  if (len >= 4) {
+    seed ^= (uint64_t)__builtin_bswap32((uint32_t)seed) << 32;
+    uint64_t in64 = read32(in) + ((uint64_t)read32(in + len - 4) << 32);
+    uint64_t flip = (read64(secret + 16) ^ read64(secret + 24)) + seed;
+
+    h = mult64to128(in64 ^ flip, PRIME64_1 + (len << 2));
+    h.hi += h.lo << 1;
+    h.lo ^= h.hi >> 3;
+    h.lo ^= h.lo >> 35;
+    h.lo *= PRIME_MX2;
+    h.lo ^= h.lo >> 28;
+    h.hi = xxh3_avalanche(h.hi);
+    return h;
+  }
+
+  if (len) {
+    uint32_t combined_lo = ((uint32_t)in[0] << 16) |
+                           ((uint32_t)in[len >> 1] << 24) |
+                           (uint32_t)in[len - 1] | ((uint32_t)len << 8);
+    uint32_t combined_hi = rotl32(__builtin_bswap32(combined_lo), 13);
+    uint64_t flip_lo = (read32(secret) ^ read32(secret + 4)) + seed;
+    uint64_t flip_hi = (read32(secret + 8) ^ read32(secret + 12)) - seed;
+    h.lo = xxh64_avalanche((uint64_t)combined_lo ^ flip_lo);
+    h.hi = xxh64_avalanche((uint64_t)combined_hi ^ flip_hi);
+    return h;
+  }
+
+  h.lo = xxh64_avalanche(seed ^ read64(secret + 64) ^ read64(secret + 72));
+  h.hi = xxh64_avalanche(seed ^ read64(secret + 80) ^ read64(secret + 88));
+  return h;
+}
+
+static inline BufferHash128 mix32(BufferHash128 acc, const uint8_t* in1,
+                                  const uint8_t* in2, const uint8_t* secret,
+                                  uint64_t seed) {
+  acc.lo += mix16(in1, secret, seed);
+  acc.lo ^= read64(in2) + read64(in2 + 8);
+  acc.hi += mix16(in2, secret + 16, seed);
+  acc.hi ^= read64(in1) + read64(in1 + 8);
+  return acc;
+}
+
+static BufferHash128 finish128_mid(BufferHash128 acc, size_t len,
+                                   uint64_t seed) {
+  BufferHash128 h;
+  h.lo = xxh3_avalanche(acc.lo + acc.hi);
+  h.hi = 0 - xxh3_avalanche(acc.lo * PRIME64_1 + acc.hi * PRIME64_4 +
+                            (len - seed) * PRIME64_2);
+  return h;
+}
+
+static BufferHash128 hash128_17to128(const uint8_t* in, size_t len,
+                                     const uint8_t* secret, uint64_t seed) {
+  BufferHash128 acc = {len * PRIME64_1, 0};
+
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) acc = mix32(acc, in + 48, in + len - 64, secret + 96, seed);
+      acc = mix32(acc, in + 32, in + len - 48, secret + 64, seed);
+    }
+    acc = mix32(acc, in + 16, in + len - 32, secret + 32, seed);
+  }
+  acc = mix32(acc, in, in + len - 16, secret, seed);
+
+  return finish128_mid(acc, len, seed);
+}
+
+static BufferHash128 hash128_129to240(const uint8_t* in, size_t len,
+                                      const uint8_t* secret, uint64_t seed) {
+  BufferHash128 acc = {len * PRIME64_1, 0};
+
+  for (size_t i = 32; i < 160; i += 32)
+    acc = mix32(acc, in + i - 32, in + i - 16, secret + i - 32, seed);
+  acc.lo = xxh3_avalanche(acc.lo);
+  acc.hi = xxh3_avalanche(acc.hi);
+
+  for (size_t i = 160; i <= len; i += 32)
+    acc = mix32(acc, in + i - 32, in + i - 16,
+                secret + MIDSIZE_STARTOFFSET + i - 160, seed);
+
+  acc = mix32(acc, in + len - 16, in + len - 32,
+              secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET - 16, 0 - seed);
+
+  return finish128_mid(acc, len, seed);
+}
+
+// Long inputs: stripe accumulation
+
+static void accumulate_scalar(uint64_t* acc, const uint8_t* in,
+                              const uint8_t* secret, size_t stripes) {
+  for (size_t n = 0; n < stripes; n++) {
+    const uint8_t* p = in + n * STRIPE_LEN;
+    const uint8_t* s = secret + n * SECRET_CONSUME_RATE;
+
+    for (size_t i = 0; i < 8; i++) {
+      uint64_t v = read64(p + 8 * i);
+      uint64_t k = v ^ read64(s + 8 * i);
+      acc[i ^ 1] += v;
+      acc[i] += (k & 0xFFFFFFFF) * (k >> 32);
+    }
+  }
+}
+
+static void scramble_scalar(uint64_t* acc, const uint8_t* secret) {
+  for (size_t i = 0; i < 8; i++) {
+    uint64_t a = acc[i];
+    a ^= a >> 47;
+    a ^= read64(secret + 8 * i);
+    acc[i] = a * PRIME32_1;
+  }
+}
+
+#if BUFFER_X86
+
+__attribute__((target("avx2"))) static void accumulate_avx2(
+    uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t stripes) {
+  __m256i a0 = _mm256_loadu_si256((const __m256i*)acc);
+  __m256i a1 = _mm256_loadu_si256((const __m256i*)(acc + 4));
+
+  for (size_t n = 0; n < stripes; n++) {
+    const uint8_t* p = in + n * STRIPE_LEN;
+    const uint8_t* s = secret + n * SECRET_CONSUME_RATE;
+
+    __m256i d0 = _mm256_loadu_si256((const __m256i*)p);
+    __m256i d1 = _mm256_loadu_si256((const __m256i*)(p + 32));
+    __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256((const __m256i*)s));
+    __m256i k1 =
+        _mm256_xor_si256(d1, _mm256_loadu_si256((const __m256i*)(s + 32)));
+
+    // acc[i] += lo32(k) * hi32(k); acc[i ^ 1] += data
+    __m256i p0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+    __m256i p1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+    __m256i s0 = _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2));
+    __m256i s1 = _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2));
+    a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, s0));
+    a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, s1));
+  }
+
+  _mm256_storeu_si256((__m256i*)acc, a0);
+  _mm256_storeu_si256((__m256i*)(acc + 4), a1);
+}
+
+__attribute__((target("avx2"))) static void scramble_avx2(
+    uint64_t* acc, const uint8_t* secret) {
+  const __m256i prime = _mm256_set1_epi32((int)PRIME32_1);
+
+  for (size_t i = 0; i < 2; i++) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(acc + 4 * i));
+    a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+    a = _mm256_xor_si256(
+        a, _mm256_loadu_si256((const __m256i*)(secret + 32 * i)));
+
+    // 64x32-bit multiply from two 32x32 halves.
+    __m256i lo = _mm256_mul_epu32(a, prime);
+    __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+    a = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+    _mm256_storeu_si256((__m256i*)(acc + 4 * i), a);
+  }
+}
+
+#endif
+
+typedef void (*accumulate_fn)(uint64_t*, const uint8_t*, const uint8_t*,
+                              size_t);
+typedef void (*scramble_fn)(uint64_t*, const uint8_t*);
+
+static accumulate_fn accumulate_impl;
+static scramble_fn scramble_impl;
+
+static void hash_select(void) {
+#if BUFFER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    accumulate_impl = accumulate_avx2;
+    scramble_impl = scramble_avx2;
+    return;
+  }
+#endif
+  accumulate_impl = accumulate_scalar;
+  scramble_impl = scramble_scalar;
+}
+
+static void init_secret(uint8_t* secret, uint64_t seed) {
+  for (size_t i = 0; i < SECRET_SIZE; i += 16) {
+    store_u64(secret + i, read64(K_SECRET + i) + seed, true);
+    store_u64(secret + i + 8, read64(K_SECRET + i + 8) - seed, true);
+  }
+}
+
+static uint64_t merge_accs(const uint64_t* acc, const uint8_t* secret,
+                           uint64_t start) {
+  uint64_t h = start;
+  for (size_t i = 0; i < 4; i++)
+    h += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i),
+                       acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+  return xxh3_avalanche(h);
+}
+
+static void hash_long(uint64_t* acc, const uint8_t* in, size_t len,
+                      const uint8_t* secret) {
+  size_t blocks = (len - 1) / BLOCK_LEN;
+
+  for (size_t n = 0; n < blocks; n++) {
+    accumulate_impl(acc, in + n * BLOCK_LEN, secret, STRIPES_PER_BLOCK);
+    scramble_impl(acc, secret + SECRET_LIMIT);
+  }
+
+  size_t stripes = ((len - 1) - BLOCK_LEN * blocks) / STRIPE_LEN;
+  accumulate_impl(acc, in + blocks * BLOCK_LEN, secret, stripes);
+
+  accumulate_impl(acc, in + len - STRIPE_LEN,
+                  secret + SECRET_LIMIT - SECRET_LASTACC_START, 1);
+}
+
+static const uint8_t* long_secret(uint8_t* custom, uint64_t seed) {
+  if (seed == 0) return K_SECRET;
+  init_secret(custom, seed);
+  return custom;
+}
+
+uint64_t buffer_hash64(const uint8_t* p, size_t len, uint64_t seed) {
+  if (len <= 16) return hash64_0to16(p, len, K_SECRET, seed);
+  if (len <= 128) return hash64_17to128(p, len, K_SECRET, seed);
+  if (len <= MIDSIZE_MAX) return hash64_129to240(p, len, K_SECRET, seed);
+
+  if (!accumulate_impl) hash_select();
+
+  uint8_t custom[SECRET_SIZE];
+  const uint8_t* secret = long_secret(custom, seed);
+  uint64_t acc[8] = ACC_INIT;
+
+  hash_long(acc, p, len, secret);
+  return merge_accs(acc, secret + SECRET_MERGEACCS_START, len * PRIME64_1);
+}
+
+BufferHash128 buffer_hash128(const uint8_t* p, size_t len, uint64_t seed) {
+  if (len <= 16) return hash128_0to16(p, len, K_SECRET, seed);
+  if (len <= 128) return hash128_17to128(p, len, K_SECRET, seed);
+  if (len <= MIDSIZE_MAX) return hash128_129to240(p, len, K_SECRET, seed);
+
+  if (!accumulate_impl) hash_select();
+
+  uint8_t custom[SECRET_SIZE];
+  const uint8_t* secret = long_secret(custom, seed);
+  uint64_t acc[8] = ACC_INIT;
+
+  hash_long(acc, p, len, secret);
+  return (BufferHash128){
+      merge_accs(acc, secret + SECRET_MERGEACCS_START, len * PRIME64_1),
+      merge_accs(acc, secret + SECRET_SIZE - 64 - SECRET_MERGEACCS_START,
+                 ~(len * PRIME64_2)),
+  };
+}
+
+// Streaming
+
+static void hasher_reset(BufferHasher* h, uint64_t seed) {
+  static const uint64_t init[8] = ACC_INIT;
+
+  memcpy(h->acc, init, sizeof(h->acc));
+  init_secret(h->secret, seed);
+  h->seed = seed;
+  h->total_len = 0;
+  h->buffered = 0;
+  h->stripes_so_far = 0;
+}
+
+// Accumulates `stripes` stripes, scrambling at every block boundary.
+static const uint8_t* consume_stripes(uint64_t* acc, size_t* so_far,
+                                      const uint8_t* in, size_t stripes,
+                                      const uint8_t* secret) {
+  size_t room = STRIPES_PER_BLOCK - *so_far;
+
+  while (stripes >= room) {
+    accumulate_impl(acc, in, secret + *so_far * SECRET_CONSUME_RATE, room);
+    scramble_impl(acc, secret + SECRET_LIMIT);
+    in += room * STRIPE_LEN;
+    stripes -= room;
+    *so_far = 0;
+    room = STRIPES_PER_BLOCK;
+  }
+
+  if (stripes) {
+    accumulate_impl(acc, in, secret + *so_far * SECRET_CONSUME_RATE, stripes);
+    in += stripes * STRIPE_LEN;
+    *so_far += stripes;
+  }
+
+  return in;
+}
+
+// The last stripe is always kept buffered so digest can re-read it; input is
+// only consumed once more than HASHER_BUFFER_SIZE bytes have been seen.
+static void hasher_update(BufferHasher* h, const uint8_t* in, size_t len) {
+  const uint8_t* end = in + len;
+  h->total_len += len;
+
+  if (len <= HASHER_BUFFER_SIZE - h->buffered) {
+    memcpy(h->buffer + h->buffered, in, len);
+    h->buffered += len;
+    return;
+  }
+
+  if (!accumulate_impl) hash_select();
+
+  if (h->buffered) {
+    size_t fill = HASHER_BUFFER_SIZE - h->buffered;
+    memcpy(h->buffer + h->buffered, in, fill);
+    in += fill;
+    consume_stripes(h->acc, &h->stripes_so_far, h->buffer,
+                    HASHER_BUFFER_SIZE / STRIPE_LEN, h->secret);
+    h->buffered = 0;
+  }
+
+  if ((size_t)(end - in) > HASHER_BUFFER_SIZE) {
+    size_t stripes = (size_t)(end - 1 - in) / STRIPE_LEN;
+    in = consume_stripes(h->acc, &h->stripes_so_far, in, stripes, h->secret);
+    memcpy(h->buffer + HASHER_BUFFER_SIZE - STRIPE_LEN, in - STRIPE_LEN,
+           STRIPE_LEN);
+  }
+
+  memcpy(h->buffer, in, (size_t)(end - in));
+  h->buffered = (size_t)(end - in);
+}
+
+// Finishes a copy of the accumulators without disturbing the stream.
+static void hasher_digest_long(const BufferHasher* h, uint64_t* acc) {
+  uint8_t last[STRIPE_LEN];
+  const uint8_t* last_ptr;
+
+  memcpy(acc, h->acc, sizeof(h->acc));
+
+  if (h->buffered >= STRIPE_LEN) {
+    size_t stripes = (h->buffered - 1) / STRIPE_LEN;
+    size_t so_far = h->stripes_so_far;
+    consume_stripes(acc, &so_far, h->buffer, stripes, h->secret);
+    last_ptr = h->buffer + h->buffered - STRIPE_LEN;
+  } else {
+    size_t catchup = STRIPE_LEN - h->buffered;
+    memcpy(last, h->buffer + HASHER_BUFFER_SIZE - catchup, catchup);
+    memcpy(last + catchup, h->buffer, h->buffered);
+    last_ptr = last;
+  }
+
+  accumulate_impl(acc, last_ptr,
+                  h->secret + SECRET_LIMIT - SECRET_LASTACC_START, 1);
+}
+
+static uint64_t hasher_digest64(const BufferHasher* h) {
+  if (h->total_len <= MIDSIZE_MAX)
+    return buffer_hash64(h->buffer, (size_t)h->total_len, h->seed);
+
+  uint64_t acc[8];
+  hasher_digest_long(h, acc);
+  return merge_accs(acc, h->secret + SECRET_MERGEACCS_START,
+                    h->total_len * PRIME64_1);
+}
+
+static BufferHash128 hasher_digest128(const BufferHasher* h) {
+  if (h->total_len <= MIDSIZE_MAX)
+    return buffer_hash128(h->buffer, (size_t)h->total_len, h->seed);
+
+  uint64_t acc[8];
+  hasher_digest_long(h, acc);
+  return (BufferHash128){
+      merge_accs(acc, h->secret + SECRET_MERGEACCS_START,
+                 h->total_len * PRIME64_1),
+      merge_accs(acc, h->secret + SECRET_SIZE - 64 - SECRET_MERGEACCS_START,
+                 ~(h->total_len * PRIME64_2)),
+  };
+}
+
+// Lua bindings
+
+// A Buffer or a string.
+static const uint8_t* check_bytes(lua_State* L, int arg, size_t* len) {
+  Buffer* buf = luaL_testudata(L, arg, BUFFER_MT);
+  if (buf) {
+    *len = buf->size;
+    return buf->buffer;
+  }
+
+  if (lua_type(L, arg) != LUA_TSTRING)
+    luaL_typeerror(L, arg, "buffer or string");
+  return (const uint8_t*)lua_tolstring(L, arg, len);
+}
+
+// Resolves buf:hash*([seed], [start], [end]) into a byte range.
+static const uint8_t* check_hash_args(lua_State* L, uint64_t* seed,
+                                      size_t* len) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  *seed = (uint64_t)luaL_optinteger(L, 2, 0);
+  lua_Integer start = luaL_optinteger(L, 3, 1);
+  lua_Integer end = luaL_optinteger(L, 4, (lua_Integer)buf->size);
+
+  size_t offset;
+  *len = resolve_range(buf->size, start, end, &offset);
+  return buf->buffer + offset;
+}
+
+// buf:hash64([seed], [start], [end]) -> integer
+int l_buffer_hash64(lua_State* L) {
+  uint64_t seed;
+  size_t len;
+  const uint8_t* p = check_hash_args(L, &seed, &len);
+
+  lua_pushinteger(L, (lua_Integer)buffer_hash64(p, len, seed));
+  return 1;
+}
+
+// buf:hash128([seed], [start], [end]) -> low, high
+int l_buffer_hash128(lua_State* L) {
+  uint64_t seed;
+  size_t len;
+  const uint8_t* p = check_hash_args(L, &seed, &len);
+
+  BufferHash128 h = buffer_hash128(p, len, seed);
+  lua_pushinteger(L, (lua_Integer)h.lo);
+  lua_pushinteger(L, (lua_Integer)h.hi);
+  return 2;
+}
+
+// buffer.hasher([seed]) -> BufferHasher
+int l_buffer_new_hasher(lua_State* L) {
+  uint64_t seed = (uint64_t)luaL_optinteger(L, 1, 0);
+
+  BufferHasher* h = lua_newuserdatauv(L, sizeof(BufferHasher), 0);
+  hasher_reset(h, seed);
+
+  luaL_setmetatable(L, BUFFER_HASHER_MT);
+  return 1;
+}
+
+// hasher:update(data) -> hasher
+static int l_hasher_update(lua_State* L) {
+  BufferHasher* h = luaL_checkudata(L, 1, BUFFER_HASHER_MT);
+  size_t len;
+  const uint8_t* p = check_bytes(L, 2, &len);
+
+  hasher_update(h, p, len);
+
+  lua_settop(L, 1);
+  return 1;
+}
+
+// hasher:digest() -> integer
+static int l_hasher_digest(lua_State* L) {
+  BufferHasher* h = luaL_checkudata(L, 1, BUFFER_HASHER_MT);
+  lua_pushinteger(L, (lua_Integer)hasher_digest64(h));
+  return 1;
+}
+
+// hasher:digest128() -> low, high
+static int l_hasher_digest128(lua_State* L) {
+  BufferHasher* h = luaL_checkudata(L, 1, BUFFER_HASHER_MT);
+  BufferHash128 d = hasher_digest128(h);
+  lua_pushinteger(L, (lua_Integer)d.lo);
+  lua_pushinteger(L, (lua_Integer)d.hi);
+  return 2;
+}
+
+// hasher:reset([seed]) -> hasher
+static int l_hasher_reset(lua_State* L) {
+  BufferHasher* h = luaL_checkudata(L, 1, BUFFER_HASHER_MT);
+  hasher_reset(h, (uint64_t)luaL_optinteger(L, 2, (lua_Integer)h->seed));
+
+  lua_settop(L, 1);
+  return 1;
+}
+
+static const luaL_Reg hasher_methods[] = {
+    //
+    {"update", l_hasher_update},
+    {"digest", l_hasher_digest},
+    {"digest128", l_hasher_digest128},
+    {"reset", l_hasher_reset},
+    {NULL, NULL}};
+
+void buffer_hash_open(lua_State* L) {
+  luaL_newmetatable(L, BUFFER_HASHER_MT);
+
+  luaL_newlib(L, hasher_methods);
+  lua_setfield(L, -2, "__index");
+
+  lua_pop(L, 1);
+}
@@ -0,0 +1,284 @@
+#define _DEFAULT_SOURCE
+
+#include "buffer_io.h"
+
+#include <errno.h>
+#include <lauxlib.h>
+#include <limits.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "buffer_rw.h"
+#include "errors.h"
+#include "utils.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Either a Lua file handle or a raw descriptor.
+typedef struct {
+  FILE* f;
+  int fd;
+} IoTarget;
+
+static IoTarget check_target(lua_State* L, int arg) {
+  IoTarget t = {NULL, -1};
+  luaL_Stream* stream = luaL_testudata(L, arg, LUA_FILEHANDLE);
+
+  if (stream) {
+    if (!stream->closef || !stream->f)
+      luaL_error(L, "attempt to use a closed file");
+    t.f = stream->f;
+  } else {
+    lua_Integer fd = luaL_checkinteger(L, arg);
+    luaL_argcheck(L, fd >= 0 && fd <= INT_MAX, arg, "invalid file descriptor");
+    t.fd = (int)fd;
+  }
+
+  return t;
+}
+
+// Optional 0-based file position; -1 means "the current one".
+static lua_Integer opt_position(lua_State* L, int arg) {
+  lua_Integer pos = luaL_optinteger(L, arg, -1);
+  luaL_argcheck(L, pos >= -1, arg, "position must be >= 0");
+  return pos;
+}
+
+static bool seek_file(FILE* f, lua_Integer pos) {
+  if (pos < 0) return true;
+  if (pos > LONG_MAX) {
+    errno = EOVERFLOW;
+    return false;
+  }
+  return fseek(f, (long)pos, SEEK_SET) == 0;
+}
+
+// Writes all of `data` unless an error stops it. Returns the number of bytes
+// written and leaves errno set when that's short.
+static size_t fd_write_all(int fd, const uint8_t* data, size_t len,
+                           lua_Integer pos) {
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t n = pos >= 0 ? pwrite(fd, data + done, len - done,
+                                  (off_t)pos + (off_t)done)
+                         : write(fd, data + done, len - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    done += (size_t)n;
+  }
+
+  return done;
+}
+
+// Reads until `len` bytes arrived or EOF. errno is 0 on EOF.
+static size_t fd_read_all(int fd, uint8_t* data, size_t len,
+                          lua_Integer pos) {
+  size_t done = 0;
+  errno = 0;
+
+  while (done < len) {
+    ssize_t n = pos >= 0 ? pread(fd, data + done, len - done,
+                                 (off_t)pos + (off_t)done)
+                         : read(fd, data + done, len - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (n == 0) {
+      errno = 0;
+      break;
+    }
+    done += (size_t)n;
+  }
+
+  return done;
+}
+
+// Pushes the byte count, or nil, err, errno when nothing could be moved
+// because of an error.
+static int push_io_result(lua_State* L, size_t done, bool failed) {
+  if (failed && done == 0) return push_luaerrno(L);
+  lua_pushinteger(L, (lua_Integer)done);
+  return 1;
+}
+
+// buf:writeTo(file | fd, [start], [end], [position]) -> written
+// Writes buf[start..end] straight from the buffer's memory. With a position
+// descriptors use pwrite and files seek first.
+int l_buffer_write_to(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  IoTarget t = check_target(L, 2);
+  lua_Integer start = luaL_optinteger(L, 3, 1);
+  lua_Integer end = luaL_optinteger(L, 4, (lua_Integer)buf->size);
+  lua_Integer pos = opt_position(L, 5);
+
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+  const uint8_t* data = buf->buffer + offset;
+
+  if (t.f) {
+    if (!seek_file(t.f, pos)) return push_luaerrno(L);
+    size_t done = len ? fwrite(data, 1, len, t.f) : 0;
+    return push_io_result(L, done, done < len);
+  }
+
+  size_t done = fd_write_all(t.fd, data, len, pos);
+  return push_io_result(L, done, done < len);
+}
+
+// buf:readFrom(file | fd, [offset], [length], [position]) -> read
+// Reads up to `length` bytes (default: to the end of the buffer) into the
+// buffer at the 1-based `offset`. Returns 0 at end of file.
+int l_buffer_read_from(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  IoTarget t = check_target(L, 2);
+  lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
+  lua_Integer avail = (lua_Integer)buf->size - offset;
+  lua_Integer length = luaL_optinteger(L, 4, avail > 0 ? avail : 0);
+  lua_Integer pos = opt_position(L, 5);
+
+  luaL_argcheck(L, length >= 0, 4, "length must be >= 0");
+  buffer_check(L, buf, offset, (size_t)length);
+
+  uint8_t* data = buf->buffer + offset;
+  size_t len = (size_t)length;
+
+  if (t.f) {
+    if (!seek_file(t.f, pos)) return push_luaerrno(L);
+    size_t done = len ? fread(data, 1, len, t.f) : 0;
+    return push_io_result(L, done, done < len && ferror(t.f));
+  }
+
+  size_t done = fd_read_all(t.fd, data, len, pos);
+  return push_io_result(L, done, done < len && errno != 0);
+}
+
+// Collects the Buffers (and, for writes, strings) of the list at `arg`.
+static struct iovec* check_iovecs(lua_State* L, int arg, bool writing,
+                                  int* count) {
+  luaL_checktype(L, arg, LUA_TTABLE);
+  lua_Integer n = (lua_Integer)lua_rawlen(L, arg);
+  if ((size_t)n > SIZE_MAX / sizeof(struct iovec) || n > INT_MAX)
+    luaL_error(L, "too many buffers");
+
+  // Scratch array owned by Lua, so errors below can't leak it.
+  struct iovec* iov =
+      lua_newuserdatauv(L, (size_t)n * sizeof(struct iovec), 0);
+
+  for (lua_Integer i = 1; i <= n; i++) {
+    lua_rawgeti(L, arg, i);
+    Buffer* item = luaL_testudata(L, -1, BUFFER_MT);
+
+    if (item) {
+      iov[i - 1].iov_base = item->buffer;
+      iov[i - 1].iov_len = item->size;
+    } else if (writing && lua_type(L, -1) == LUA_TSTRING) {
+      size_t len;
+      iov[i - 1].iov_base = (void*)lua_tolstring(L, -1, &len);
+      iov[i - 1].iov_len = len;
+    } else {
+      const char* tname = luaL_typename(L, -1);
+      luaL_error(L, "Invalid value at index %I (%s expected, got %s)", i,
+                 writing ? "buffer or string" : "buffer", tname);
+    }
+    lua_pop(L, 1);
+  }
+
+  *count = (int)n;
+  return iov;
+}
+
+// Moves data between a descriptor and the iovecs, IOV_MAX entries per call,
+// until everything is done, EOF or an error.
+static size_t fd_vector_io(int fd, struct iovec* iov, int count, bool writing,
+                           lua_Integer pos, bool* failed) {
+  size_t done = 0;
+  int i = 0;
+  *failed = false;
+
+  while (i < count) {
+    if (iov[i].iov_len == 0) {
+      i++;
+      continue;
+    }
+
+    int cnt = count - i < IOV_MAX ? count - i : IOV_MAX;
+    off_t at = (off_t)pos + (off_t)done;
+    ssize_t n;
+
+    if (writing)
+      n = pos >= 0 ? pwritev(fd, iov + i, cnt, at) : writev(fd, iov + i, cnt);
+    else
+      n = pos >= 0 ? preadv(fd, iov + i, cnt, at) : readv(fd, iov + i, cnt);
+
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      *failed = true;
+      break;
+    }
+    if (n == 0) break;
+
+    done += (size_t)n;
+
+    size_t left = (size_t)n;
+    while (i < count && left >= iov[i].iov_len) {
+      left -= iov[i].iov_len;
+      i++;
+    }
+    if (left > 0) {
+      iov[i].iov_base = (uint8_t*)iov[i].iov_base + left;
+      iov[i].iov_len -= left;
+    }
+  }
+
+  return done;
+}
+
+static int buffer_vector_io(lua_State* L, bool writing) {
+  IoTarget t = check_target(L, 1);
+  lua_Integer pos = opt_position(L, 3);
+  int count;
+  struct iovec* iov = check_iovecs(L, 2, writing, &count);
+
+  if (t.fd >= 0) {
+    bool failed;
+    size_t done = fd_vector_io(t.fd, iov, count, writing, pos, &failed);
+    return push_io_result(L, done, failed);
+  }
+
+  // stdio has no vectored calls, but its own buffering already batches.
+  if (!seek_file(t.f, pos)) return push_luaerrno(L);
+
+  size_t done = 0;
+  for (int i = 0; i < count; i++) {
+    size_t len = iov[i].iov_len;
+    if (len == 0) continue;
+
+    size_t n = writing ? fwrite(iov[i].iov_base, 1, len, t.f)
+                       : fread(iov[i].iov_base, 1, len, t.f);
+    done += n;
+    if (n < len) return push_io_result(L, done, ferror(t.f));
+  }
+
+  lua_pushinteger(L, (lua_Integer)done);
+  return 1;
+}
+
+// buffer.writev(file | fd, list, [position]) -> written
+int l_buffer_writev(lua_State* L) { return buffer_vector_io(L, true); }
+
+// buffer.readv(file | fd, list, [position]) -> read
+// Fills the buffers in order; stops early at end of file.
+int l_buffer_readv(lua_State* L) { return buffer_vector_io(L, false); }
@@ -0,0 +1,373 @@
+#include "buffer_layout.h"
+
+#include <ctype.h>
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "buffer_rw.h"
+#include "utils.h"
+
+// Format syntax, close to string.pack:
+//   < > =   little / big / native endian for the following fields
+//   b B     int8 / uint8            h H     int16 / uint16
+//   i[n]    signed n bytes (4)      I[n]    unsigned n bytes (4)
+//   l L j J 64-bit integers         f[n]    float (f4) or double (f8)
+//   d n     double                  c<n>    fixed n-byte string
+//   x[n]    n padding bytes (1)
+// Whitespace between fields is ignored.
+
+static bool read_count(const char** fmt, size_t* n) {
+  if (!isdigit((unsigned char)**fmt)) return false;
+
+  size_t v = 0;
+  while (isdigit((unsigned char)**fmt)) {
+    if (v > (SIZE_MAX - 9) / 10) return false;
+    v = v * 10 + (size_t)(**fmt - '0');
+    (*fmt)++;
+  }
+
+  *n = v;
+  return true;
+}
+
+// Parses `fmt` into `fields` (when non-NULL) and returns the field count, or
+// -1 with `err` set.
+static long parse_layout(const char* fmt, LayoutField* fields, size_t* size,
+                         const char** err) {
+  bool little = HOST_LITTLE_ENDIAN;
+  size_t offset = 0;
+  long count = 0;
+
+  while (*fmt) {
+    char c = *fmt++;
+    LayoutField f = {FIELD_INT, 0, offset, little};
+    size_t n;
+
+    switch (c) {
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+        continue;
+      case '<':
+        little = true;
+        continue;
+      case '>':
+        little = false;
+        continue;
+      case '=':
+        little = HOST_LITTLE_ENDIAN;
+        continue;
+      case 'b':
+      case 'B':
+        f.kind = c == 'b' ? FIELD_INT : FIELD_UINT;
+        f.size = 1;
+        break;
+      case 'h':
+      case 'H':
+        f.kind = c == 'h' ? FIELD_INT : FIELD_UINT;
+        f.size = 2;
+        break;
+      case 'i':
+      case 'I':
+        f.kind = c == 'i' ? FIELD_INT : FIELD_UINT;
+        f.size = read_count(&fmt, &n) ? n : 4;
+        if (f.size < 1 || f.size > 8) {
+          *err = "integer size must be between 1 and 8";
+          return -1;
+        }
+        break;
+      case 'l':
+      case 'j':
+        f.kind = FIELD_INT;
+        f.size = 8;
+        break;
+      case 'L':
+      case 'J':
+        f.kind = FIELD_UINT;
+        f.size = 8;
+        break;
+      case 'f':
+        f.size = read_count(&fmt, &n) ? n : 4;
+        if (f.size != 4 && f.size != 8) {
+          *err = "float size must be 4 or 8";
+          return -1;
+        }
+        f.kind = f.size == 4 ? FIELD_FLOAT : FIELD_DOUBLE;
+        break;
+      case 'd':
+      case 'n':
+        f.kind = FIELD_DOUBLE;
+        f.size = 8;
+        break;
+      case 'c':
+        if (!read_count(&fmt, &f.size)) {
+          *err = "missing size for format option 'c'";
+          return -1;
+        }
+        f.kind = FIELD_CHARS;
+        break;
+      case 'x':
+        f.kind = FIELD_PAD;
+        f.size = read_count(&fmt, &n) ? n : 1;
+        break;
+      default:
+        *err = "invalid format option";
+        return -1;
+    }
+
+    if (f.size > SIZE_MAX - offset) {
+      *err = "layout too large";
+      return -1;
+    }
+
+    offset += f.size;
+    if (fields) fields[count] = f;
+    count++;
+  }
+
+  *size = offset;
+  return count;
+}
+
+static void push_field(lua_State* L, const uint8_t* rec, const LayoutField* f) {
+  const uint8_t* p = rec + f->offset;
+
+  switch (f->kind) {
+    case FIELD_INT: {
+      int shift = 64 - (int)(8 * f->size);
+      int64_t v = (int64_t)(load_uint(p, f->size, f->little) << shift) >> shift;
+      lua_pushinteger(L, (lua_Integer)v);
+      break;
+    }
+    case FIELD_UINT:
+      lua_pushinteger(L, (lua_Integer)load_uint(p, f->size, f->little));
+      break;
+    case FIELD_FLOAT: {
+      uint32_t bits = load_u32(p, f->little);
+      float v;
+      memcpy(&v, &bits, sizeof(v));
+      lua_pushnumber(L, (lua_Number)v);
+      break;
+    }
+    case FIELD_DOUBLE: {
+      uint64_t bits = load_u64(p, f->little);
+      double v;
+      memcpy(&v, &bits, sizeof(v));
+      lua_pushnumber(L, (lua_Number)v);
+      break;
+    }
+    case FIELD_CHARS:
+      lua_pushlstring(L, (const char*)p, f->size);
+      break;
+    case FIELD_PAD:
+      break;
+  }
+}
+
+// Raises the error store_field() would for a bad argument, so pack can reject
+// a record before any of it is written.
+static void check_field(lua_State* L, const LayoutField* f, int arg) {
+  switch (f->kind) {
+    case FIELD_INT:
+    case FIELD_UINT:
+      check_int_value(L, arg);
+      break;
+    case FIELD_FLOAT:
+    case FIELD_DOUBLE:
+      luaL_checknumber(L, arg);
+      break;
+    case FIELD_CHARS: {
+      size_t len;
+      luaL_checklstring(L, arg, &len);
+      luaL_argcheck(L, len <= f->size, arg, "string longer than given size");
+      break;
+    }
+    case FIELD_PAD:
+      break;
+  }
+}
+
+static void store_field(lua_State* L, uint8_t* rec, const LayoutField* f,
+                        int arg) {
+  uint8_t* p = rec + f->offset;
+
+  switch (f->kind) {
+    case FIELD_INT:
+    case FIELD_UINT: {
+      lua_Integer v = check_int_value(L, arg);
+      store_uint(p, (uint64_t)v, f->size, f->little);
+      break;
+    }
+    case FIELD_FLOAT: {
+      float v = (float)luaL_checknumber(L, arg);
+      uint32_t bits;
+      memcpy(&bits, &v, sizeof(bits));
+      store_u32(p, bits, f->little);
+      break;
+    }
+    case FIELD_DOUBLE: {
+      double v = (double)luaL_checknumber(L, arg);
+      uint64_t bits;
+      memcpy(&bits, &v, sizeof(bits));
+      store_u64(p, bits, f->little);
+      break;
+    }
+    case FIELD_CHARS: {
+      size_t len;
+      const char* s = luaL_checklstring(L, arg, &len);
+      luaL_argcheck(L, len <= f->size, arg, "string longer than given size");
+      memcpy(p, s, len);
+      memset(p + len, 0, f->size - len);
+      break;
+    }
+    case FIELD_PAD:
+      memset(p, 0, f->size);
+      break;
+  }
+}
+
+// Checks that `n` records starting at the 1-based offset in `arg` fit in
+// `buf` and returns the 0-based offset.
+static size_t check_records(lua_State* L, const Buffer* buf,
+                            const Layout* layout, int arg, lua_Integer n) {
+  lua_Integer offset = luaL_optinteger(L, arg, 1) - 1;
+
+  if (layout->size > 0 && (size_t)n > buf->size / layout->size + 1)
+    n = (lua_Integer)(buf->size / layout->size + 1);
+
+  buffer_check(L, buf, offset, (size_t)n * layout->size);
+  return (size_t)offset;
+}
+
+int l_buffer_compile(lua_State* L) {
+  const char* fmt = luaL_checkstring(L, 1);
+  const char* err = NULL;
+  size_t size;
+
+  long nfields = parse_layout(fmt, NULL, &size, &err);
+  if (nfields < 0) return luaL_error(L, "Invalid layout \"%s\": %s", fmt, err);
+
+  Layout* layout = lua_newuserdatauv(
+      L, sizeof(Layout) + (size_t)nfields * sizeof(LayoutField), 0);
+  layout->nfields = (size_t)nfields;
+  parse_layout(fmt, layout->fields, &layout->size, &err);
+
+  layout->nvalues = 0;
+  for (size_t i = 0; i < layout->nfields; i++)
+    if (layout->fields[i].kind != FIELD_PAD) layout->nvalues++;
+
+  luaL_getmetatable(L, BUFFER_LAYOUT_MT);
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+// layout:unpack(buf, [offset]) -> values..., nextOffset
+static int l_layout_unpack(lua_State* L) {
+  Layout* layout = luaL_checkudata(L, 1, BUFFER_LAYOUT_MT);
+  Buffer* buf = luaL_checkudata(L, 2, BUFFER_MT);
+  size_t offset = check_records(L, buf, layout, 3, 1);
+
+  if (layout->nvalues >= INT32_MAX ||
+      !lua_checkstack(L, (int)layout->nvalues + 1))
+    return luaL_error(L, "too many results to unpack");
+
+  const uint8_t* rec = buf->buffer + offset;
+  for (size_t i = 0; i < layout->nfields; i++)
+    push_field(L, rec, &layout->fields[i]);
+
+  lua_pushinteger(L, (lua_Integer)(offset + layout->size + 1));
+  return (int)layout->nvalues + 1;
+}
+
+// layout:pack(buf, offset, ...) -> nextOffset
+static int l_layout_pack(lua_State* L) {
+  Layout* layout = luaL_checkudata(L, 1, BUFFER_LAYOUT_MT);
+  Buffer* buf = luaL_checkudata(L, 2, BUFFER_MT);
+  size_t offset = check_records(L, buf, layout, 3, 1);
+
+  int arg = 4;
+  for (size_t i = 0; i < layout->nfields; i++) {
+    const LayoutField* f = &layout->fields[i];
+    if (f->kind != FIELD_PAD) check_field(L, f, arg++);
+  }
+
+  uint8_t* rec = buf->buffer + offset;
+  arg = 4;
+  for (size_t i = 0; i < layout->nfields; i++) {
+    const LayoutField* f = &layout->fields[i];
+    store_field(L, rec, f, f->kind == FIELD_PAD ? 0 : arg);
+    if (f->kind != FIELD_PAD) arg++;
+  }
+
+  lua_pushinteger(L, (lua_Integer)(offset + layout->size + 1));
+  return 1;
+}
+
+// layout:unpackMany(buf, offset, n) -> columns, nextOffset
+// columns[k][i] is value k of record i.
+static int l_layout_unpack_many(lua_State* L) {
+  Layout* layout = luaL_checkudata(L, 1, BUFFER_LAYOUT_MT);
+  Buffer* buf = luaL_checkudata(L, 2, BUFFER_MT);
+  lua_Integer n = luaL_checkinteger(L, 4);
+  luaL_argcheck(L, n >= 0, 4, "record count must be >= 0");
+  size_t offset = check_records(L, buf, layout, 3, n);
+
+  int prealloc = n > INT32_MAX ? INT32_MAX : (int)n;
+  lua_createtable(L, (int)layout->nvalues, 0);
+  int columns = lua_gettop(L);
+  for (size_t k = 1; k <= layout->nvalues; k++) {
+    lua_createtable(L, prealloc, 0);
+    lua_rawseti(L, columns, (lua_Integer)k);
+  }
+
+  luaL_checkstack(L, 2, "too many columns");
+  const uint8_t* rec = buf->buffer + offset;
+
+  // Fill column by column so only one column table sits on the stack.
+  lua_Integer k = 0;
+  for (size_t i = 0; i < layout->nfields; i++) {
+    const LayoutField* f = &layout->fields[i];
+    if (f->kind == FIELD_PAD) continue;
+
+    lua_rawgeti(L, columns, ++k);
+    for (lua_Integer r = 0; r < n; r++) {
+      push_field(L, rec + (size_t)r * layout->size, f);
+      lua_rawseti(L, -2, r + 1);
+    }
+    lua_pop(L, 1);
+  }
+
+  lua_pushinteger(L, (lua_Integer)(offset + (size_t)n * layout->size + 1));
+  return 2;
+}
+
+static int l_layout__len(lua_State* L) {
+  Layout* layout = luaL_checkudata(L, 1, BUFFER_LAYOUT_MT);
+  lua_pushinteger(L, (lua_Integer)layout->size);
+  return 1;
+}
+
+static const luaL_Reg layout_methods[] = {
+    //
+    {"pack", l_layout_pack},
+    {"unpack", l_layout_unpack},
+    {"unpackMany", l_layout_unpack_many},
+    {NULL, NULL}};
+
+void buffer_layout_open(lua_State* L) {
+  luaL_newmetatable(L, BUFFER_LAYOUT_MT);
+
+  lua_pushcfunction(L, l_layout__len);
+  lua_setfield(L, -2, "__len");
+
+  luaL_newlib(L, layout_methods);
+  lua_setfield(L, -2, "__index");
+
+  lua_pop(L, 1);
+}
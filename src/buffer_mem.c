@@ -0,0 +1,206 @@
+#include "buffer_mem.h"
+
+#include <lauxlib.h>
+#include <limits.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define BUFFER_MEM_MT "BufferMem*"
+
+// Only the address matters: it is the registry key of the BufferMem.
+static const char BUFFER_MEM_KEY = 0;
+
+static size_t pool_class(size_t size) {
+  size_t cls = 0;
+  while ((BUFFER_POOL_MIN << cls) < size) cls++;
+  return cls;
+}
+
+// Payloads are allocated with the lua_State's own allocator so embedders'
+// limits and custom allocators see them too. The allocator doesn't tell the
+// collector about these bytes, hence the separate `external` accounting.
+void* buffer_mem_alloc(BufferMem* mem, size_t size) {
+  void* ptr = mem->allocf(mem->ud, NULL, 0, size);
+  if (ptr) {
+    mem->external += size;
+    mem->debt += size;
+  }
+  return ptr;
+}
+
+void* buffer_mem_realloc(BufferMem* mem, void* ptr, size_t osize,
+                         size_t nsize) {
+  void* grown = mem->allocf(mem->ud, ptr, osize, nsize);
+  if (grown) {
+    mem->external = mem->external - osize + nsize;
+    if (nsize > osize) mem->debt += nsize - osize;
+  }
+  return grown;
+}
+
+void buffer_mem_free(BufferMem* mem, void* ptr, size_t size) {
+  if (!ptr) return;
+  mem->allocf(mem->ud, ptr, size, 0);
+  mem->external -= size;
+  mem->debt = size < mem->debt ? mem->debt - size : 0;
+}
+
+// Reports external growth to the collector as if it had been allocated by
+// Lua, so a heap of a few large buffers is paced by its real footprint.
+// Batched to keep small allocations from stepping the GC every time.
+void buffer_mem_pace(lua_State* L, BufferMem* mem) {
+  if (mem->debt < BUFFER_GC_PACE) return;
+
+  size_t kb = mem->debt / 1024;
+  mem->debt = 0;
+  lua_gc(L, LUA_GCSTEP, kb > INT_MAX ? INT_MAX : (int)kb);
+}
+
+static size_t pool_trim(BufferMem* mem) {
+  size_t freed = mem->cached;
+
+  for (size_t cls = 0; cls < BUFFER_POOL_CLASSES; cls++) {
+    PoolBlock* block = mem->free[cls];
+    while (block) {
+      PoolBlock* next = block->next;
+      buffer_mem_free(mem, block, BUFFER_POOL_MIN << cls);
+      block = next;
+    }
+    mem->free[cls] = NULL;
+    mem->count[cls] = 0;
+  }
+
+  mem->cached = 0;
+  return freed;
+}
+
+static int buffer_mem__gc(lua_State* L) {
+  BufferMem* mem = luaL_checkudata(L, 1, BUFFER_MEM_MT);
+  pool_trim(mem);
+  // Buffers finalized after this point (on lua_close) free their blocks
+  // directly instead of parking them on a dead pool.
+  mem->closed = true;
+  return 0;
+}
+
+void buffer_mem_open(lua_State* L) {
+  if (lua_rawgetp(L, LUA_REGISTRYINDEX, &BUFFER_MEM_KEY) != LUA_TNIL) {
+    lua_pop(L, 1);
+    return;
+  }
+  lua_pop(L, 1);
+
+  BufferMem* mem = lua_newuserdatauv(L, sizeof(BufferMem), 0);
+  memset(mem, 0, sizeof(BufferMem));
+  mem->allocf = lua_getallocf(L, &mem->ud);
+
+  if (luaL_newmetatable(L, BUFFER_MEM_MT)) {
+    lua_pushcfunction(L, buffer_mem__gc);
+    lua_setfield(L, -2, "__gc");
+  }
+  lua_setmetatable(L, -2);
+
+  lua_rawsetp(L, LUA_REGISTRYINDEX, &BUFFER_MEM_KEY);
+}
+
+BufferMem* buffer_mem(lua_State* L) {
+  lua_rawgetp(L, LUA_REGISTRYINDEX, &BUFFER_MEM_KEY);
+  BufferMem* mem = lua_touserdata(L, -1);
+  lua_pop(L, 1);
+  return mem;
+}
+
+bool buffer_pool_accepts(const BufferMem* mem, size_t size) {
+  return mem && mem->limit > 0 && !mem->closed && size >= BUFFER_POOL_MIN &&
+         size <= BUFFER_POOL_MAX;
+}
+
+// Hands out a block of the size class covering `size`, recycling a parked one
+// when possible. The caller must check buffer_pool_accepts() first.
+uint8_t* buffer_pool_acquire(BufferMem* mem, size_t size, size_t* capacity) {
+  size_t cls = pool_class(size);
+  size_t class_size = BUFFER_POOL_MIN << cls;
+  PoolBlock* block = mem->free[cls];
+
+  *capacity = class_size;
+
+  if (block) {
+    mem->free[cls] = block->next;
+    mem->count[cls]--;
+    mem->cached -= class_size;
+    mem->hits++;
+    return (uint8_t*)block;
+  }
+
+  mem->misses++;
+  return buffer_mem_alloc(mem, class_size);
+}
+
+void buffer_pool_release(BufferMem* mem, uint8_t* block, size_t capacity) {
+  if (mem->closed || mem->cached + capacity > mem->limit) {
+    buffer_mem_free(mem, block, capacity);
+    return;
+  }
+
+  size_t cls = pool_class(capacity);
+  PoolBlock* node = (PoolBlock*)block;
+  node->next = mem->free[cls];
+  mem->free[cls] = node;
+  mem->count[cls]++;
+  mem->cached += capacity;
+}
+
+int l_buffer_pool_stats(lua_State* L) {
+  BufferMem* mem = buffer_mem(L);
+
+  lua_createtable(L, 0, 6);
+  lua_pushinteger(L, (lua_Integer)mem->limit);
+  lua_setfield(L, -2, "limit");
+  lua_pushinteger(L, (lua_Integer)mem->cached);
+  lua_setfield(L, -2, "cached");
+  lua_pushinteger(L, (lua_Integer)mem->hits);
+  lua_setfield(L, -2, "hits");
+  lua_pushinteger(L, (lua_Integer)mem->misses);
+  lua_setfield(L, -2, "misses");
+
+  // classes[size] = number of parked blocks of that size
+  lua_createtable(L, 0, BUFFER_POOL_CLASSES);
+  for (size_t cls = 0; cls < BUFFER_POOL_CLASSES; cls++) {
+    lua_pushinteger(L, (lua_Integer)mem->count[cls]);
+    lua_rawseti(L, -2, (lua_Integer)(BUFFER_POOL_MIN << cls));
+  }
+  lua_setfield(L, -2, "classes");
+
+  return 1;
+}
+
+int l_buffer_pool_trim(lua_State* L) {
+  BufferMem* mem = buffer_mem(L);
+  lua_pushinteger(L, (lua_Integer)pool_trim(mem));
+  return 1;
+}
+
+int l_buffer_pool_limit(lua_State* L) {
+  BufferMem* mem = buffer_mem(L);
+  lua_Integer previous = (lua_Integer)mem->limit;
+
+  if (!lua_isnoneornil(L, 1)) {
+    lua_Integer limit = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, limit >= 0, 1, "limit must be >= 0");
+
+    mem->limit = (size_t)limit;
+    if (mem->cached > mem->limit) pool_trim(mem);
+  }
+
+  lua_pushinteger(L, previous);
+  return 1;
+}
+
+int l_buffer_external_memory(lua_State* L) {
+  BufferMem* mem = buffer_mem(L);
+  lua_pushinteger(L, (lua_Integer)mem->external);
+  return 1;
+}
@@ -8,13 +8,37 @@
 #include <sys/param.h>
 
 #include "buffer.h"
+#include "buffer_alloc.h"
+#include "buffer_async.h"
+#include "buffer_mem.h"
+#include "buffer_mmap.h"
 #include "common.h"
 #include "errors.h"
 
 int l_buffer__gc(lua_State* L) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  // if (buf->buffer) FREE(buf->buffer);
-  FREE(buf->buffer);
+
+  // Only reachable from lua_close(), which finalizes pinned buffers too.
+  if (buf->async_pending > 0) buffer_async_drain(buf);
+
+  // Inline bytes go away with the userdata and views only borrow theirs.
+  switch (buf->storage) {
+    case BUFFER_STORAGE_HEAP:
+      buffer_mem_free(buffer_mem(L), buf->buffer, buf->capacity);
+      break;
+    case BUFFER_STORAGE_POOL:
+      if (buf->buffer)
+        buffer_pool_release(buffer_mem(L), buf->buffer, buf->capacity);
+      break;
+    case BUFFER_STORAGE_MMAP:
+      buffer_mmap_release(buf);
+      break;
+    default:
+      break;
+  }
+
+  buf->buffer = NULL;
+  buf->size = buf->capacity = 0;
   return 0;
 }
 
@@ -22,17 +46,11 @@ int l_buffer__concat(lua_State* L) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
   Buffer* other = luaL_checkudata(L, 2, BUFFER_MT);
 
-  Buffer* newbuf = lua_newuserdata(L, sizeof(Buffer));
-  newbuf->size = buf->size + other->size;
-  newbuf->buffer = malloc(newbuf->size);
-  if (!newbuf->buffer) return throw_luaoom(L, newbuf->size);
+  Buffer* newbuf = buffer_new(L, buf->size + other->size, false);
 
   memcpy(newbuf->buffer, buf->buffer, buf->size);
   memcpy(newbuf->buffer + buf->size, other->buffer, other->size);
 
-  luaL_getmetatable(L, BUFFER_MT);
-  lua_setmetatable(L, -2);
-
   return 1;
 }
 
@@ -0,0 +1,182 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "buffer_mmap.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "errors.h"
+
+static size_t page_size(void) {
+  static size_t size = 0;
+  if (!size) {
+    long ps = sysconf(_SC_PAGESIZE);
+    size = ps > 0 ? (size_t)ps : 4096;
+  }
+  return size;
+}
+
+// A mapping starts on a page boundary, `buffer` may point past it when the
+// requested file offset wasn't aligned. `capacity` is the mapped length.
+void buffer_mmap_release(Buffer* buf) {
+  if (!buf->buffer) return;
+  size_t delta = (uintptr_t)buf->buffer % page_size();
+  munmap(buf->buffer - delta, buf->capacity);
+}
+
+// buffer.mmap(path, [mode], [offset], [length]) -> Buffer | nil, err, errno
+// "r" maps the file copy-on-write: writes are allowed but never reach the
+// file. "rw" maps it shared, so writes land in the file (see buf:sync()).
+// `offset` is a 0-based byte position in the file, like file:seek().
+int l_buffer_mmap(lua_State* L) {
+  const char* path = luaL_checkstring(L, 1);
+  const char* mode = luaL_optstring(L, 2, "r");
+  lua_Integer offset = luaL_optinteger(L, 3, 0);
+  lua_Integer length = luaL_optinteger(L, 4, -1);  // -1: up to the end
+
+  bool writable;
+  if (strcmp(mode, "r") == 0)
+    writable = false;
+  else if (strcmp(mode, "rw") == 0)
+    writable = true;
+  else
+    return luaL_argerror(L, 2, "invalid mode (expected \"r\" or \"rw\")");
+
+  // Create the userdata first so a memory error can't leak the descriptor or
+  // the mapping.
+  Buffer* buf = lua_newuserdatauv(L, sizeof(Buffer), 1);
+  buf->buffer = NULL;
+  buf->size = buf->capacity = 0;
+  buf->storage = BUFFER_STORAGE_MMAP;
+  buf->engine = NULL;
+  buf->async_pending = 0;
+  luaL_getmetatable(L, BUFFER_MT);
+  lua_setmetatable(L, -2);
+
+  int fd = open(path, writable ? O_RDWR : O_RDONLY);
+  if (fd < 0) return push_luaerrno(L);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int err = errno;
+    close(fd);
+    errno = err;
+    return push_luaerrno(L);
+  }
+
+  lua_Integer file_size = (lua_Integer)st.st_size;
+  if (offset < 0 || offset > file_size) {
+    close(fd);
+    return luaL_error(L, ERR_OUT_OF_RANGE, "offset", file_size, offset);
+  }
+
+  if (length == -1) length = file_size - offset;
+  if (length < 0 || length > file_size - offset) {
+    close(fd);
+    return luaL_error(L, ERR_OUT_OF_RANGE, "length", file_size - offset,
+                      length);
+  }
+
+  if (length == 0) {
+    close(fd);
+    return 1;
+  }
+
+  size_t delta = (size_t)offset % page_size();
+  size_t map_len = delta + (size_t)length;
+
+  void* base = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                    writable ? MAP_SHARED : MAP_PRIVATE, fd,
+                    (off_t)((size_t)offset - delta));
+  int err = errno;
+  close(fd);
+
+  if (base == MAP_FAILED) {
+    errno = err;
+    return push_luaerrno(L);
+  }
+
+  buf->buffer = (uint8_t*)base + delta;
+  buf->size = (size_t)length;
+  buf->capacity = map_len;
+  return 1;
+}
+
+// Resolves the page-aligned range of the mapping behind the Buffer at `idx`,
+// which may be a view into a mapped Buffer.
+static bool mapped_range(lua_State* L, int idx, void** addr, size_t* len) {
+  Buffer* buf = luaL_checkudata(L, idx, BUFFER_MT);
+  Buffer* owner = buf;
+
+  if (buf->storage == BUFFER_STORAGE_VIEW) {
+    lua_getiuservalue(L, idx, 1);
+    owner = luaL_testudata(L, -1, BUFFER_MT);
+    lua_pop(L, 1);
+  }
+
+  if (!owner || owner->storage != BUFFER_STORAGE_MMAP) return false;
+
+  if (!buf->buffer || buf->size == 0) {
+    *addr = NULL;
+    *len = 0;
+    return true;
+  }
+
+  size_t delta = (uintptr_t)buf->buffer % page_size();
+  *addr = buf->buffer - delta;
+  *len = buf->size + delta;
+  return true;
+}
+
+// buf:sync([async]) -> true | nil, err, errno
+// Flushes a shared mapping (or the part a view covers) to its file.
+int l_buffer_sync(lua_State* L) {
+  bool async = lua_toboolean(L, 2);
+  void* addr;
+  size_t len;
+
+  if (!mapped_range(L, 1, &addr, &len))
+    return luaL_error(L, "buffer is not memory-mapped");
+
+  if (len > 0 && msync(addr, len, async ? MS_ASYNC : MS_SYNC) != 0)
+    return push_luaerrno(L);
+
+  lua_pushboolean(L, true);
+  return 1;
+}
+
+static const char* const advice_names[] = {"normal", "sequential", "random",
+                                           "willneed", "dontneed", NULL};
+static const int advice_values[] = {
+    POSIX_MADV_NORMAL, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM,
+    POSIX_MADV_WILLNEED, POSIX_MADV_DONTNEED};
+
+// buf:advise(hint) -> true | nil, err, errno
+// Passes an access pattern hint for the mapping to the kernel.
+int l_buffer_advise(lua_State* L) {
+  int advice = advice_values[luaL_checkoption(L, 2, NULL, advice_names)];
+  void* addr;
+  size_t len;
+
+  if (!mapped_range(L, 1, &addr, &len))
+    return luaL_error(L, "buffer is not memory-mapped");
+
+  int err = len > 0 ? posix_madvise(addr, len, advice) : 0;
+  if (err != 0) {
+    errno = err;
+    return push_luaerrno(L);
+  }
+
+  lua_pushboolean(L, true);
+  return 1;
+}
@@ -1,6 +1,7 @@
 #include "buffer_rw.h"
 
 #include <lauxlib.h>
+#include <limits.h>
 #include <lua.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -11,291 +12,508 @@
 
 #include "buffer.h"
 #include "common.h"
+#include "encoding.h"
 #include "errors.h"
-#include "hexlib.h"
 #include "utils.h"
 
-static inline void buffer_check(lua_State* L, const Buffer* buf,
-                                lua_Integer offset, size_t len) {
-  if (offset < 0)
-    luaL_error(L, "offset is out of range (expected >= 1, got %I)", offset + 1);
+// Integers are handed to Lua as lua_Integer. 64-bit values map onto it
+// directly; UInt64 values above INT64_MAX wrap to negative integers, the same
+// way string.unpack("J") does.
+
+// Generates buf:read<Name>([offset]) and buf:write<Name>(value, [offset]).
+// `ctype` is what the loaded bits are reinterpreted as, which takes care of
+// sign extension.
+#define BUFFER_INT_ACCESSORS(name, bits, ctype, little)                 \
+  int l_buffer_read_##name(lua_State* L) {                              \
+    Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);                     \
+    lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;                  \
+    buffer_check(L, buf, offset, bits / 8);                             \
+    ctype v = (ctype)load_u##bits(buf->buffer + offset, little);        \
+    lua_pushinteger(L, (lua_Integer)v);                                 \
+    return 1;                                                           \
+  }                                                                     \
+  int l_buffer_write_##name(lua_State* L) {                             \
+    Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);                     \
+    lua_Integer value = check_int_value(L, 2);                          \
+    lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;                  \
+    buffer_check(L, buf, offset, bits / 8);                             \
+    store_u##bits(buf->buffer + offset, (uint##bits##_t)value, little); \
+    lua_pushinteger(L, offset + bits / 8 + 1);                          \
+    return 1;                                                           \
+  }
 
-  if ((size_t)offset + len > buf->size)
-    luaL_error(L,
-               "attempt to access memory outside buffer bounds (offset=%I, "
-               "size=%I, len=%I)",
-               offset + 1, (lua_Integer)buf->size, (lua_Integer)len);
-}
+// Same for floats: `ftype` is float or double and `bits` its width.
+#define BUFFER_FLOAT_ACCESSORS(name, bits, ftype, little)               \
+  int l_buffer_read_##name(lua_State* L) {                              \
+    Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);                     \
+    lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;                  \
+    buffer_check(L, buf, offset, bits / 8);                             \
+    uint##bits##_t raw = load_u##bits(buf->buffer + offset, little);    \
+    ftype v;                                                            \
+    memcpy(&v, &raw, sizeof(v));                                        \
+    lua_pushnumber(L, (lua_Number)v);                                   \
+    return 1;                                                           \
+  }                                                                     \
+  int l_buffer_write_##name(lua_State* L) {                             \
+    Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);                     \
+    ftype v = (ftype)luaL_checknumber(L, 2);                            \
+    lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;                  \
+    buffer_check(L, buf, offset, bits / 8);                             \
+    uint##bits##_t raw;                                                 \
+    memcpy(&raw, &v, sizeof(raw));                                      \
+    store_u##bits(buf->buffer + offset, raw, little);                   \
+    lua_pushinteger(L, offset + bits / 8 + 1);                          \
+    return 1;                                                           \
+  }
 
-static int buffer_read_int(lua_State* L, size_t byteLength, bool littleEndian) {
+BUFFER_INT_ACCESSORS(u8, 8, uint8_t, true)
+BUFFER_INT_ACCESSORS(i8, 8, int8_t, true)
+BUFFER_INT_ACCESSORS(u16le, 16, uint16_t, true)
+BUFFER_INT_ACCESSORS(u16be, 16, uint16_t, false)
+BUFFER_INT_ACCESSORS(i16le, 16, int16_t, true)
+BUFFER_INT_ACCESSORS(i16be, 16, int16_t, false)
+BUFFER_INT_ACCESSORS(u32le, 32, uint32_t, true)
+BUFFER_INT_ACCESSORS(u32be, 32, uint32_t, false)
+BUFFER_INT_ACCESSORS(i32le, 32, int32_t, true)
+BUFFER_INT_ACCESSORS(i32be, 32, int32_t, false)
+BUFFER_INT_ACCESSORS(u64le, 64, uint64_t, true)
+BUFFER_INT_ACCESSORS(u64be, 64, uint64_t, false)
+BUFFER_INT_ACCESSORS(i64le, 64, int64_t, true)
+BUFFER_INT_ACCESSORS(i64be, 64, int64_t, false)
+
+BUFFER_FLOAT_ACCESSORS(f32le, 32, float, true)
+BUFFER_FLOAT_ACCESSORS(f32be, 32, float, false)
+BUFFER_FLOAT_ACCESSORS(f64le, 64, double, true)
+BUFFER_FLOAT_ACCESSORS(f64be, 64, double, false)
+
+// buf:read[U]Int{LE,BE}([offset], byteLength) and the matching writers cover
+// the widths without a fixed accessor (24, 40, 48 and 56 bit).
+
+static int buffer_read_intn(lua_State* L, bool is_signed, bool little) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
   lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;
+  lua_Integer width = luaL_checkinteger(L, 3);
 
-  buffer_check(L, buf, offset, byteLength);
+  if (width < 1 || width > 8)
+    return luaL_error(L, ERR_OUT_OF_RANGE, "byteLength", (lua_Integer)8, width);
 
-  const uint8_t* p = buf->buffer + (size_t)offset;
-  int64_t value = 0;
+  buffer_check(L, buf, offset, (size_t)width);
 
-  if (littleEndian) {
-    for (size_t i = 0; i < byteLength; i++) value |= (int64_t)p[i] << (8 * i);
-  } else {
-    for (size_t i = 0; i < byteLength; i++)
-      value |= (int64_t)p[i] << (8 * (byteLength - 1 - i));
+  uint64_t v = load_uint(buf->buffer + offset, (size_t)width, little);
+  if (is_signed) {
+    int shift = 64 - (int)(8 * width);
+    v = (uint64_t)((int64_t)(v << shift) >> shift);
   }
 
-  int shift = 64 - (byteLength * 8);
-  value = (value << shift) >> shift;
-
-  lua_pushinteger(L, (lua_Integer)value);
+  lua_pushinteger(L, (lua_Integer)v);
   return 1;
 }
 
-static int buffer_read_uint(lua_State* L, size_t byteLength,
-                            bool littleEndian) {
+// Two's complement makes signed and unsigned writes identical.
+static int buffer_write_intn(lua_State* L, bool little) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;
+  lua_Integer value = check_int_value(L, 2);
+  lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
+  lua_Integer width = luaL_checkinteger(L, 4);
 
-  buffer_check(L, buf, offset, byteLength);
+  if (width < 1 || width > 8)
+    return luaL_error(L, ERR_OUT_OF_RANGE, "byteLength", (lua_Integer)8, width);
 
-  const uint8_t* p = buf->buffer + (size_t)offset;
-  uint64_t value = 0;
+  buffer_check(L, buf, offset, (size_t)width);
+  store_uint(buf->buffer + offset, (uint64_t)value, (size_t)width, little);
 
-  if (littleEndian) {
-    for (size_t i = 0; i < byteLength; i++) value |= (uint64_t)p[i] << (8 * i);
-  } else {
-    for (size_t i = 0; i < byteLength; i++)
-      value |= (uint64_t)p[i] << (8 * (byteLength - 1 - i));
-  }
-
-  lua_pushinteger(L, (lua_Integer)value);
+  lua_pushinteger(L, offset + width + 1);
   return 1;
 }
 
-static int buffer_write_int(lua_State* L, size_t byteLength,
-                            bool littleEndian) {
-  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  lua_Number value = luaL_checknumber(L, 2);
-  lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
+int l_buffer_read_uintle(lua_State* L) {
+  return buffer_read_intn(L, false, true);
+}
+
+int l_buffer_read_uintbe(lua_State* L) {
+  return buffer_read_intn(L, false, false);
+}
 
-  buffer_check(L, buf, offset, byteLength);
+int l_buffer_read_intle(lua_State* L) { return buffer_read_intn(L, true, true); }
 
-  int64_t v = (int64_t)value;
-  uint8_t* p = buf->buffer + (size_t)offset;
+int l_buffer_read_intbe(lua_State* L) {
+  return buffer_read_intn(L, true, false);
+}
 
-  if (littleEndian) {
-    for (size_t i = 0; i < byteLength; i++) p[i] = (v >> (8 * i)) & 0xFF;
-  } else {
-    for (size_t i = 0; i < byteLength; i++)
-      p[byteLength - 1 - i] = (v >> (8 * i)) & 0xFF;
+int l_buffer_write_intle(lua_State* L) { return buffer_write_intn(L, true); }
+
+int l_buffer_write_intbe(lua_State* L) { return buffer_write_intn(L, false); }
+
+typedef enum { ELEM_UINT, ELEM_INT, ELEM_FLOAT } ElemKind;
+
+typedef struct {
+  size_t width;
+  ElemKind kind;
+  bool little;
+} ElemType;
+
+static inline void push_elem(lua_State* L, const uint8_t* p, ElemType t) {
+  switch (t.width) {
+    case 1:
+      lua_pushinteger(L, t.kind == ELEM_INT ? (lua_Integer)(int8_t)*p
+                                            : (lua_Integer)*p);
+      return;
+    case 2: {
+      uint16_t v = load_u16(p, t.little);
+      lua_pushinteger(L, t.kind == ELEM_INT ? (lua_Integer)(int16_t)v
+                                            : (lua_Integer)v);
+      return;
+    }
+    case 4: {
+      uint32_t v = load_u32(p, t.little);
+      if (t.kind == ELEM_FLOAT) {
+        float f;
+        memcpy(&f, &v, sizeof(f));
+        lua_pushnumber(L, (lua_Number)f);
+      } else {
+        lua_pushinteger(L, t.kind == ELEM_INT ? (lua_Integer)(int32_t)v
+                                              : (lua_Integer)v);
+      }
+      return;
+    }
+    default: {
+      uint64_t v = load_u64(p, t.little);
+      if (t.kind == ELEM_FLOAT) {
+        double d;
+        memcpy(&d, &v, sizeof(d));
+        lua_pushnumber(L, (lua_Number)d);
+      } else {
+        lua_pushinteger(L, (lua_Integer)v);
+      }
+      return;
+    }
   }
+}
 
-  lua_pushinteger(L, offset + byteLength + 1);
-  return 1;
+// Stores the number on top of the stack, truncating floats for integer types
+// like the single-value writers do.
+static inline void store_elem(uint8_t* p, lua_State* L, ElemType t) {
+  if (t.kind == ELEM_FLOAT) {
+    lua_Number n = lua_tonumber(L, -1);
+    if (t.width == SIZE_F32) {
+      float f = (float)n;
+      uint32_t v;
+      memcpy(&v, &f, sizeof(v));
+      store_u32(p, v, t.little);
+    } else {
+      double d = (double)n;
+      uint64_t v;
+      memcpy(&v, &d, sizeof(v));
+      store_u64(p, v, t.little);
+    }
+    return;
+  }
+
+  int isint;
+  lua_Integer n = lua_tointegerx(L, -1, &isint);
+  if (!isint) n = number_to_int(L, lua_tonumber(L, -1));
+
+  switch (t.width) {
+    case 1:
+      *p = (uint8_t)n;
+      return;
+    case 2:
+      store_u16(p, (uint16_t)n, t.little);
+      return;
+    case 4:
+      store_u32(p, (uint32_t)n, t.little);
+      return;
+    default:
+      store_u64(p, (uint64_t)n, t.little);
+      return;
+  }
 }
 
-static int buffer_write_uint(lua_State* L, size_t byteLength,
-                             bool littleEndian) {
+// buf:readXArray([offset], [count]) -> table
+// Reads `count` consecutive values (default: as many as fit) in one call.
+static int buffer_read_array(lua_State* L, ElemType t) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  lua_Number value = luaL_checknumber(L, 2);
-  lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
-
-  buffer_check(L, buf, offset, byteLength);
+  lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;
 
-  uint64_t v = (uint64_t)value;
-  uint8_t* p = buf->buffer + (size_t)offset;
+  lua_Integer fit = 0;
+  if (offset >= 0 && (size_t)offset <= buf->size)
+    fit = (lua_Integer)((buf->size - (size_t)offset) / t.width);
 
-  if (littleEndian) {
-    for (size_t i = 0; i < byteLength; i++) p[i] = (v >> (8 * i)) & 0xFF;
-  } else {
-    for (size_t i = 0; i < byteLength; i++)
-      p[byteLength - 1 - i] = (v >> (8 * i)) & 0xFF;
-  }
+  lua_Integer count = luaL_optinteger(L, 3, fit);
+  if (count < 0)
+    return luaL_error(L, ERR_OUT_OF_RANGE, "count", fit, count);
+  if (count > fit) count = fit + 1;  // let buffer_check report the overrun
 
-  lua_pushinteger(L, offset + byteLength + 1);
-  return 1;
-}
+  buffer_check(L, buf, offset, (size_t)count * t.width);
 
-int l_buffer_write_f32le(lua_State* L) {
-  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  float value = (float)luaL_checknumber(L, 2);
-  lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
+  const uint8_t* p = buf->buffer + (size_t)offset;
+  lua_createtable(L, count > INT_MAX ? INT_MAX : (int)count, 0);
 
-  buffer_check(L, buf, offset, SIZE_F32);
+  for (lua_Integer i = 0; i < count; i++, p += t.width) {
+    push_elem(L, p, t);
+    lua_rawseti(L, -2, i + 1);
+  }
 
-  memcpy(buf->buffer + (size_t)offset, &value, SIZE_F32);
-  lua_pushinteger(L, offset + SIZE_F32 + 1);
   return 1;
 }
 
-int l_buffer_write_f32be(lua_State* L) {
+// buf:writeXArray(values, [offset], [first], [last]) -> next offset
+// Writes values[first..last] (default: the whole sequence) in one call.
+static int buffer_write_array(lua_State* L, ElemType t) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  float value = (float)luaL_checknumber(L, 2);
+  luaL_checktype(L, 2, LUA_TTABLE);
   lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
+  lua_Integer first = luaL_optinteger(L, 4, 1);
+  lua_Integer last = luaL_optinteger(L, 5, (lua_Integer)lua_rawlen(L, 2));
 
-  buffer_check(L, buf, offset, SIZE_F32);
+  luaL_argcheck(L, first >= 1, 4, "first index must be >= 1");
 
-  uint8_t tmp[SIZE_F32];
-  memcpy(tmp, &value, SIZE_F32);
-  reverse_bytes(tmp, SIZE_F32);
-  memcpy(buf->buffer + (size_t)offset, tmp, SIZE_F32);
+  size_t count = last >= first ? (size_t)(last - first + 1) : 0;
+  if (count > buf->size / t.width + 1) count = buf->size / t.width + 1;
 
-  lua_pushinteger(L, offset + SIZE_F32 + 1);
-  return 1;
-}
+  buffer_check(L, buf, offset, count * t.width);
 
-int l_buffer_read_f32le(lua_State* L) {
-  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;
+  uint8_t* p = buf->buffer + (size_t)offset;
 
-  buffer_check(L, buf, offset, SIZE_F32);
+  for (size_t i = 0; i < count; i++, p += t.width) {
+    lua_Integer idx = first + (lua_Integer)i;
+    if (lua_rawgeti(L, 2, idx) != LUA_TNUMBER) {
+      const char* tname = luaL_typename(L, -1);
+      return luaL_error(L,
+                        "Invalid value at index %I (number expected, got %s)",
+                        idx, tname);
+    }
+    store_elem(p, L, t);
+    lua_pop(L, 1);
+  }
 
-  float value;
-  memcpy(&value, buf->buffer + (size_t)offset, SIZE_F32);
-  lua_pushnumber(L, (lua_Number)value);
+  lua_pushinteger(L, offset + (lua_Integer)(count * t.width) + 1);
   return 1;
 }
 
-int l_buffer_read_f32be(lua_State* L) {
-  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;
+#define BUFFER_ARRAY_ACCESSORS(name, width, kind, little)          \
+  int l_buffer_read_##name##_array(lua_State* L) {                 \
+    return buffer_read_array(L, (ElemType){width, kind, little});  \
+  }                                                                \
+  int l_buffer_write_##name##_array(lua_State* L) {                \
+    return buffer_write_array(L, (ElemType){width, kind, little}); \
+  }
 
-  buffer_check(L, buf, offset, SIZE_F32);
+BUFFER_ARRAY_ACCESSORS(u8, SIZE_UINT8, ELEM_UINT, true)
+BUFFER_ARRAY_ACCESSORS(i8, SIZE_INT8, ELEM_INT, true)
+BUFFER_ARRAY_ACCESSORS(u16le, SIZE_UINT16, ELEM_UINT, true)
+BUFFER_ARRAY_ACCESSORS(u16be, SIZE_UINT16, ELEM_UINT, false)
+BUFFER_ARRAY_ACCESSORS(i16le, SIZE_INT16, ELEM_INT, true)
+BUFFER_ARRAY_ACCESSORS(i16be, SIZE_INT16, ELEM_INT, false)
+BUFFER_ARRAY_ACCESSORS(u32le, SIZE_UINT32, ELEM_UINT, true)
+BUFFER_ARRAY_ACCESSORS(u32be, SIZE_UINT32, ELEM_UINT, false)
+BUFFER_ARRAY_ACCESSORS(i32le, SIZE_INT32, ELEM_INT, true)
+BUFFER_ARRAY_ACCESSORS(i32be, SIZE_INT32, ELEM_INT, false)
+BUFFER_ARRAY_ACCESSORS(u64le, SIZE_UINT64, ELEM_UINT, true)
+BUFFER_ARRAY_ACCESSORS(u64be, SIZE_UINT64, ELEM_UINT, false)
+BUFFER_ARRAY_ACCESSORS(i64le, SIZE_INT64, ELEM_INT, true)
+BUFFER_ARRAY_ACCESSORS(i64be, SIZE_INT64, ELEM_INT, false)
+BUFFER_ARRAY_ACCESSORS(f32le, SIZE_F32, ELEM_FLOAT, true)
+BUFFER_ARRAY_ACCESSORS(f32be, SIZE_F32, ELEM_FLOAT, false)
+BUFFER_ARRAY_ACCESSORS(f64le, SIZE_F64, ELEM_FLOAT, true)
+BUFFER_ARRAY_ACCESSORS(f64be, SIZE_F64, ELEM_FLOAT, false)
+
+// LEB128 varints (protobuf, WebAssembly): 7 bits per byte, low group first,
+// high bit set on every byte but the last. Signed values use zigzag encoding.
+
+#define VARINT_MAX_LEN 10
+#define VARINT_CONT 0x8080808080808080ull
+
+// Decodes one varint from the `avail` bytes at `p` into `out`. Returns the
+// bytes consumed, or 0 if the value is truncated, longer than 10 bytes or
+// does not fit in 64 bits.
+// Values of up to 8 bytes are decoded from a single word without branching
+// per byte: the first clear high bit marks the end, and the 7-bit groups are
+// packed together with three mask-and-shift steps.
+static inline size_t varint_decode(const uint8_t* p, size_t avail,
+                                   uint64_t* out) {
+  uint64_t w;
+
+  if (avail >= 8) {
+    w = load_u64(p, true);
+  } else {
+    // Pad with continuation bytes so a truncated value never ends early.
+    uint8_t tmp[8];
+    memset(tmp, 0x80, sizeof(tmp));
+    memcpy(tmp, p, avail);
+    w = load_u64(tmp, true);
+  }
 
-  uint8_t tmp[SIZE_F32];
-  memcpy(tmp, buf->buffer + (size_t)offset, SIZE_F32);
-  reverse_bytes(tmp, SIZE_F32);
-  float value;
-  memcpy(&value, tmp, SIZE_F32);
+  uint64_t stops = ~w & VARINT_CONT;
+  size_t n = stops ? (size_t)__builtin_ctzll(stops) / 8 + 1 : 9;
 
-  lua_pushnumber(L, (lua_Number)value);
-  return 1;
-}
+  uint64_t x = w & ~VARINT_CONT;
+  if (n < 8) x &= (1ull << (8 * n)) - 1;
+  x = (x & 0x007f007f007f007full) | ((x & 0x7f007f007f007f00ull) >> 1);
+  x = (x & 0x00003fff00003fffull) | ((x & 0x3fff00003fff0000ull) >> 2);
+  x = (x & 0x000000000fffffffull) | ((x & 0x0fffffff00000000ull) >> 4);
 
-int l_buffer_write_f64le(lua_State* L) {
-  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  double value = (double)luaL_checknumber(L, 2);
-  lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
+  if (n <= 8) {
+    *out = x;
+    return n;
+  }
 
-  buffer_check(L, buf, offset, SIZE_F64);
+  // 9 or 10 bytes: the last two groups hold bits 56..63, so a 10th byte can
+  // only be 0 or 1.
+  if (avail < 9) return 0;
+  x |= (uint64_t)(p[8] & 0x7F) << 56;
+  if (p[8] & 0x80) {
+    if (avail < 10 || p[9] > 1) return 0;
+    x |= (uint64_t)p[9] << 63;
+    n = 10;
+  }
 
-  memcpy(buf->buffer + (size_t)offset, &value, SIZE_F64);
-  lua_pushinteger(L, offset + SIZE_F64 + 1);
-  return 1;
+  *out = x;
+  return n;
 }
 
-int l_buffer_write_f64be(lua_State* L) {
-  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  double value = (double)luaL_checknumber(L, 2);
-  lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
-
-  buffer_check(L, buf, offset, SIZE_F64);
+static inline size_t varint_len(uint64_t v) {
+  return (size_t)(63 - __builtin_clzll(v | 1)) / 7 + 1;
+}
 
-  uint8_t tmp[SIZE_F64];
-  memcpy(tmp, &value, SIZE_F64);
-  reverse_bytes(tmp, SIZE_F64);
-  memcpy(buf->buffer + (size_t)offset, tmp, SIZE_F64);
+static inline lua_Integer zigzag_decode(uint64_t v) {
+  return (lua_Integer)((v >> 1) ^ (0 - (v & 1)));
+}
 
-  lua_pushinteger(L, offset + SIZE_F64 + 1);
-  return 1;
+static inline uint64_t zigzag_encode(lua_Integer n) {
+  return ((uint64_t)n << 1) ^ (uint64_t)(n >> 63);
 }
 
-int l_buffer_read_f64le(lua_State* L) {
+// buf:readVar[U]Int([offset]) -> value, next offset
+static int buffer_read_varint(lua_State* L, bool zigzag) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
   lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;
+  buffer_check(L, buf, offset, 1);
 
-  buffer_check(L, buf, offset, SIZE_F64);
+  uint64_t v;
+  size_t avail = buf->size - (size_t)offset;
+  size_t n = varint_decode(buf->buffer + offset, avail, &v);
+  if (!n) return luaL_error(L, "Malformed varint at offset %I", offset + 1);
 
-  double value;
-  memcpy(&value, buf->buffer + (size_t)offset, SIZE_F64);
-  lua_pushnumber(L, (lua_Number)value);
-  return 1;
+  lua_pushinteger(L, zigzag ? zigzag_decode(v) : (lua_Integer)v);
+  lua_pushinteger(L, offset + (lua_Integer)n + 1);
+  return 2;
 }
 
-int l_buffer_read_f64be(lua_State* L) {
+// buf:writeVar[U]Int(value, [offset]) -> next offset
+static int buffer_write_varint(lua_State* L, bool zigzag) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;
+  lua_Integer value = check_int_value(L, 2);
+  lua_Integer offset = luaL_optinteger(L, 3, 1) - 1;
 
-  buffer_check(L, buf, offset, SIZE_F64);
+  uint64_t v = zigzag ? zigzag_encode(value) : (uint64_t)value;
+  size_t n = varint_len(v);
+  buffer_check(L, buf, offset, n);
 
-  uint8_t tmp[SIZE_F64];
-  memcpy(tmp, buf->buffer + (size_t)offset, SIZE_F64);
-  reverse_bytes(tmp, SIZE_F64);
-  double value;
-  memcpy(&value, tmp, SIZE_F64);
+  uint8_t* p = buf->buffer + offset;
+  for (; v >= 0x80; v >>= 7) *p++ = (uint8_t)(v | 0x80);
+  *p = (uint8_t)v;
 
-  lua_pushnumber(L, (lua_Number)value);
+  lua_pushinteger(L, offset + (lua_Integer)n + 1);
   return 1;
 }
 
-int l_buffer_read_u32be(lua_State* L) {
-  return buffer_read_uint(L, SIZE_UINT32, false);
-}
-
-int l_buffer_write_u32be(lua_State* L) {
-  return buffer_write_uint(L, SIZE_UINT32, false);
-}
-
-int l_buffer_read_u32le(lua_State* L) {
-  return buffer_read_uint(L, SIZE_UINT32, true);
-}
-
-int l_buffer_write_u32le(lua_State* L) {
-  return buffer_write_uint(L, SIZE_UINT32, true);
-}
+// buf:readVar[U]IntArray([offset], [count]) -> table, next offset
+// Decodes a packed run of `count` varints (default: up to the end of the
+// buffer). Eight single-byte values are recognised from one word and stored
+// without going through the general decoder.
+static int buffer_read_varint_array(lua_State* L, bool zigzag) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  lua_Integer offset = luaL_optinteger(L, 2, 1) - 1;
+  lua_Integer count = luaL_optinteger(L, 3, -1);
+
+  if (offset < 0 || (size_t)offset > buf->size)
+    return luaL_error(L, ERR_OUT_OF_RANGE, "offset",
+                      (lua_Integer)buf->size + 1, offset + 1);
+  const uint8_t* p = buf->buffer + offset;
+  const uint8_t* end = buf->buffer + buf->size;
+
+  // Every varint takes at least one byte, which also bounds the table size.
+  if (count < -1 || count > end - p)
+    return luaL_error(L, ERR_OUT_OF_RANGE, "count", (lua_Integer)(end - p),
+                      count);
+
+  bool bounded = count >= 0;
+  lua_Integer i = 0;
+
+  lua_createtable(L, bounded && count < INT_MAX ? (int)count : 0, 0);
+
+  while (bounded ? i < count : p < end) {
+    if (end - p >= 8 && (!bounded || count - i >= 8)) {
+      uint64_t w = load_u64(p, true);
+      if ((w & VARINT_CONT) == 0) {
+        for (int k = 0; k < 8; k++) {
+          uint64_t b = (w >> (8 * k)) & 0xFF;
+          lua_pushinteger(L, zigzag ? zigzag_decode(b) : (lua_Integer)b);
+          lua_rawseti(L, -2, ++i);
+        }
+        p += 8;
+        continue;
+      }
+    }
+
+    uint64_t v;
+    size_t n = varint_decode(p, (size_t)(end - p), &v);
+    if (!n)
+      return luaL_error(L, "Malformed varint at offset %I",
+                        (lua_Integer)(p - buf->buffer) + 1);
+
+    lua_pushinteger(L, zigzag ? zigzag_decode(v) : (lua_Integer)v);
+    lua_rawseti(L, -2, ++i);
+    p += n;
+  }
 
-int l_buffer_read_u16le(lua_State* L) {
-  return buffer_read_uint(L, SIZE_UINT16, true);
+  lua_pushinteger(L, (lua_Integer)(p - buf->buffer) + 1);
+  return 2;
 }
 
-int l_buffer_write_u16le(lua_State* L) {
-  return buffer_write_uint(L, SIZE_UINT16, true);
-}
+int l_buffer_read_varuint(lua_State* L) { return buffer_read_varint(L, false); }
+int l_buffer_read_varint(lua_State* L) { return buffer_read_varint(L, true); }
 
-int l_buffer_write_i16be(lua_State* L) {
-  return buffer_write_int(L, SIZE_INT16, false);
+int l_buffer_write_varuint(lua_State* L) {
+  return buffer_write_varint(L, false);
 }
 
-int l_buffer_read_i16be(lua_State* L) {
-  return buffer_read_int(L, SIZE_INT16, false);
+int l_buffer_write_varint(lua_State* L) {
+  return buffer_write_varint(L, true);
 }
 
-int l_buffer_read_i16le(lua_State* L) {
-  return buffer_read_int(L, SIZE_INT16, false);
+int l_buffer_read_varuint_array(lua_State* L) {
+  return buffer_read_varint_array(L, false);
 }
 
-int l_buffer_write_i16le(lua_State* L) {
-  return buffer_write_int(L, SIZE_INT16, false);
+int l_buffer_read_varint_array(lua_State* L) {
+  return buffer_read_varint_array(L, true);
 }
 
 int l_buffer_tostring(lua_State* L) {
   Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
-  const char* encoding = luaL_optstring(L, 2, ENCODING_UTF8);
-  lua_Integer start = luaL_optinteger(L, 3, 0);
-  lua_Integer end = luaL_optinteger(L, 4, buf->size);
-
-  if (start < 0) start = (lua_Integer)buf->size + start + 1;
-  if (end < 0) end = (lua_Integer)buf->size + end + 1;
+  const Codec* codec = check_encoding(L, 2);
+  lua_Integer start = luaL_optinteger(L, 3, 1);
+  lua_Integer end = luaL_optinteger(L, 4, (lua_Integer)buf->size);
 
-  if (start < 1) start = 1;
-  if (end > (lua_Integer)buf->size) end = buf->size;
+  size_t offset;
+  size_t slice_len = resolve_range(buf->size, start, end, &offset);
 
-  if (end < start) {
+  if (slice_len == 0) {
     lua_pushliteral(L, "");
     return 1;
   }
 
-  size_t slice_len = (size_t)(end - start + 1);
-  const uint8_t* slice_buf = buf->buffer + (start - 1);
+  const uint8_t* slice_buf = buf->buffer + offset;
 
-  if (strcasecmp(encoding, ENCODING_UTF8) == 0) {
+  if (codec->identity) {
     lua_pushlstring(L, (const char*)slice_buf, slice_len);
-  } else if (strcasecmp(encoding, ENCODING_BASE16) == 0) {
-    char* hexstr = hex_encode(slice_buf, slice_len);
-    if (!hexstr) return throw_luaoom(L, slice_len);
-    lua_pushstring(L, hexstr);
-    FREE(hexstr);
   } else {
-    return luaL_error(L, "Unsupported encoding: %s", encoding);
+    size_t enc_len = codec->encoded_len(slice_len);
+    luaL_Buffer b;
+    char* out = luaL_buffinitsize(L, &b, enc_len);
+    luaL_pushresultsize(&b, codec->encode(out, slice_buf, slice_len));
   }
 
   return 1;
@@ -309,11 +527,10 @@ int l_buffer_write_string(lua_State* L) {
 
   lua_Integer offset = 1;   // Lua 1-based default
   lua_Integer length = -1;  // -1 == unspecified
-  const char* encoding = ENCODING_UTF8;
+  const Codec* codec = check_encoding(L, 5);
 
   if (!lua_isnoneornil(L, 3)) offset = luaL_checkinteger(L, 3);
   if (!lua_isnoneornil(L, 4)) length = luaL_checkinteger(L, 4);
-  if (!lua_isnoneornil(L, 5)) encoding = luaL_checkstring(L, 5);
 
   // validate offset: 1 .. buf->size (inclusive)
   if (offset < 1 || offset > (lua_Integer)buf->size)
@@ -323,9 +540,11 @@ int l_buffer_write_string(lua_State* L) {
   // remaining = buf->size - (offset - 1)
   size_t remaining = buf->size - (size_t)(offset - 1);
 
-  // default length: min(string length, buffer length) per your request
+  // default length: min(string length, buffer length) per your request;
+  // transcoding codecs may expand, so they get the whole buffer
   if (lua_isnoneornil(L, 4)) {
-    length = (lua_Integer)MIN(str_len, buf->size);
+    length = (lua_Integer)(codec->identity ? MIN(str_len, buf->size)
+                                           : buf->size);
     // length =
     //     (lua_Integer)((str_len < (size_t)buf->size) ? (lua_Integer)str_len
     //                                                 :
@@ -347,24 +566,25 @@ int l_buffer_write_string(lua_State* L) {
 
   // compute final write_len = min(length, str_len, remaining)
   size_t write_len = (size_t)length;
-  if (write_len > str_len) write_len = str_len;
+  if (codec->identity && write_len > str_len) write_len = str_len;
   if (write_len > remaining) write_len = remaining;
 
-  if (strcasecmp(encoding, ENCODING_UTF8) == 0) {
+  if (codec->identity) {
     memcpy(buf->buffer + write_offset, str, write_len);
-  } else if (strcasecmp(encoding, ENCODING_BASE16) == 0) {
-    size_t decoded_len = 0;
-    uint8_t* decoded = hex_decode(str, &decoded_len);
-    if (!decoded) return luaL_error(L, ERR_INVALID_HEX_STRING);
-
+  } else if (codec->decoded_maxlen(str_len) <= write_len) {
+    // everything fits, decode in place
+    if (!codec->decode(buf->buffer + write_offset, &write_len, str, str_len))
+      return luaL_error(L, "%s", codec->invalid);
+  } else {
     // decoded_len might be larger than we can write, cap it
+    size_t decoded_len = 0;
+    const uint8_t* decoded =
+        codec_decode_alloc(L, codec, str, str_len, &decoded_len);
     if (decoded_len > write_len) decoded_len = write_len;
 
     memcpy(buf->buffer + write_offset, decoded, decoded_len);
     write_len = decoded_len;
-    FREE(decoded);
-  } else {
-    return luaL_error(L, ERR_UNSUPPORTED_ENCODING, encoding);
+    free((void*)decoded);
   }
 
   lua_pushinteger(L, (lua_Integer)write_len);
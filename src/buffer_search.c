@@ -0,0 +1,279 @@
+#include "buffer_search.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "buffer_alloc.h"
+#include "encoding.h"
+#include "simd.h"
+
+// Scalar fallbacks. Forward searches lean on memchr, which libc already
+// vectorizes, to skip to candidates for the first needle byte.
+
+static const uint8_t* find_scalar(const uint8_t* hay, size_t hay_len,
+                                  const uint8_t* needle, size_t needle_len) {
+  size_t last = hay_len - needle_len;  // last candidate position
+  const uint8_t* p = hay;
+  const uint8_t* end = hay + last + 1;
+
+  while (p < end) {
+    p = memchr(p, needle[0], (size_t)(end - p));
+    if (!p) return NULL;
+    if (memcmp(p + 1, needle + 1, needle_len - 1) == 0) return p;
+    p++;
+  }
+  return NULL;
+}
+
+static const uint8_t* rfind_scalar(const uint8_t* hay, size_t hay_len,
+                                   const uint8_t* needle, size_t needle_len) {
+  for (size_t i = hay_len - needle_len + 1; i-- > 0;) {
+    if (hay[i] == needle[0] &&
+        memcmp(hay + i + 1, needle + 1, needle_len - 1) == 0)
+      return hay + i;
+  }
+  return NULL;
+}
+
+#if BUFFER_X86
+
+// Multi-byte needles: compare 32 candidate positions at once against the
+// first and the last needle byte and only memcmp where both match. That
+// filters out almost every false candidate on real payloads.
+
+__attribute__((target("avx2"))) static const uint8_t* find_avx2(
+    const uint8_t* hay, size_t hay_len, const uint8_t* needle,
+    size_t needle_len) {
+  const __m256i first = _mm256_set1_epi8((char)needle[0]);
+  const __m256i last = _mm256_set1_epi8((char)needle[needle_len - 1]);
+  size_t candidates = hay_len - needle_len + 1;
+  size_t i = 0;
+
+  for (; i + 32 <= candidates; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(hay + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(hay + i + needle_len - 1));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                         _mm256_cmpeq_epi8(b, last)));
+
+    while (mask) {
+      unsigned bit = (unsigned)__builtin_ctz(mask);
+      if (memcmp(hay + i + bit + 1, needle + 1, needle_len - 2) == 0)
+        return hay + i + bit;
+      mask &= mask - 1;
+    }
+  }
+
+  if (i >= candidates) return NULL;
+  return find_scalar(hay + i, hay_len - i, needle, needle_len);
+}
+
+__attribute__((target("avx2"))) static const uint8_t* rfind_avx2(
+    const uint8_t* hay, size_t hay_len, const uint8_t* needle,
+    size_t needle_len) {
+  const __m256i first = _mm256_set1_epi8((char)needle[0]);
+  const __m256i last = _mm256_set1_epi8((char)needle[needle_len - 1]);
+  size_t candidates = hay_len - needle_len + 1;
+
+  // Blocks of 32 candidates, walking down from the end.
+  while (candidates >= 32) {
+    size_t i = candidates - 32;
+    __m256i a = _mm256_loadu_si256((const __m256i*)(hay + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(hay + i + needle_len - 1));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                         _mm256_cmpeq_epi8(b, last)));
+
+    while (mask) {
+      unsigned bit = 31 - (unsigned)__builtin_clz(mask);
+      if (needle_len <= 2 ||
+          memcmp(hay + i + bit + 1, needle + 1, needle_len - 2) == 0)
+        return hay + i + bit;
+      mask &= ~(1u << bit);
+    }
+    candidates = i;
+  }
+
+  // The leftover candidates [0, candidates) may still use bytes up to
+  // candidates + needle_len - 2.
+  if (candidates == 0) return NULL;
+  return rfind_scalar(hay, candidates + needle_len - 1, needle, needle_len);
+}
+
+#endif
+
+typedef const uint8_t* (*find_fn)(const uint8_t*, size_t, const uint8_t*,
+                                  size_t);
+
+static find_fn find_impl;
+static find_fn rfind_impl;
+
+static void search_select(void) {
+#if BUFFER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    rfind_impl = rfind_avx2;
+    find_impl = find_avx2;
+    return;
+  }
+#endif
+  rfind_impl = rfind_scalar;
+  find_impl = find_scalar;
+}
+
+const uint8_t* buffer_find(const uint8_t* hay, size_t hay_len,
+                           const uint8_t* needle, size_t needle_len) {
+  if (needle_len == 0) return hay;
+  if (needle_len > hay_len) return NULL;
+  if (needle_len == 1) return memchr(hay, needle[0], hay_len);
+  if (!find_impl) search_select();
+  return find_impl(hay, hay_len, needle, needle_len);
+}
+
+const uint8_t* buffer_rfind(const uint8_t* hay, size_t hay_len,
+                            const uint8_t* needle, size_t needle_len) {
+  if (needle_len == 0) return hay + hay_len;
+  if (needle_len > hay_len) return NULL;
+  if (!rfind_impl) search_select();
+  return rfind_impl(hay, hay_len, needle, needle_len);
+}
+
+// Resolves the needle at `arg`: a byte (integer, masked to 8 bits), a Buffer
+// or a string in the encoding at `enc_arg`. Decoded strings are left on the
+// stack to keep them alive.
+static const uint8_t* check_needle(lua_State* L, int arg, int enc_arg,
+                                   uint8_t* byte, size_t* len) {
+  if (lua_type(L, arg) == LUA_TNUMBER) {
+    *byte = (uint8_t)(luaL_checkinteger(L, arg) & 0xFF);
+    *len = 1;
+    return byte;
+  }
+
+  Buffer* buf = luaL_testudata(L, arg, BUFFER_MT);
+  if (buf) {
+    *len = buf->size;
+    return buf->buffer;
+  }
+
+  size_t str_len;
+  const char* str = luaL_checklstring(L, arg, &str_len);
+  const Codec* codec = check_encoding(L, enc_arg);
+  if (codec->identity) {
+    *len = str_len;
+    return (const uint8_t*)str;
+  }
+
+  const uint8_t* decoded = codec_decode_alloc(L, codec, str, str_len, len);
+  lua_pushlstring(L, (const char*)decoded, *len);
+  free((void*)decoded);
+  return (const uint8_t*)lua_tostring(L, -1);
+}
+
+// 1-based start, negative counting from the end, clamped to [1, size + 1].
+static size_t check_start(lua_State* L, int arg, size_t size,
+                          lua_Integer def) {
+  lua_Integer start = luaL_optinteger(L, arg, def);
+  if (start < 0) start += (lua_Integer)size + 1;
+  if (start < 1) start = 1;
+  if (start > (lua_Integer)size + 1) start = (lua_Integer)size + 1;
+  return (size_t)(start - 1);
+}
+
+static const uint8_t* index_of(lua_State* L, Buffer* buf) {
+  uint8_t byte;
+  size_t len;
+  const uint8_t* needle = check_needle(L, 2, 4, &byte, &len);
+  size_t from = check_start(L, 3, buf->size, 1);
+
+  return buffer_find(buf->buffer + from, buf->size - from, needle, len);
+}
+
+// buf:indexOf(value, [start], [encoding]) -> index | nil
+int l_buffer_index_of(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  const uint8_t* p = index_of(L, buf);
+
+  if (p)
+    lua_pushinteger(L, (lua_Integer)(p - buf->buffer) + 1);
+  else
+    lua_pushnil(L);
+  return 1;
+}
+
+// buf:includes(value, [start], [encoding]) -> boolean
+int l_buffer_includes(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  lua_pushboolean(L, index_of(L, buf) != NULL);
+  return 1;
+}
+
+// buf:lastIndexOf(value, [start], [encoding]) -> index | nil
+// Finds the last match beginning at or before `start` (default: anywhere).
+int l_buffer_last_index_of(lua_State* L) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  uint8_t byte;
+  size_t len;
+  const uint8_t* needle = check_needle(L, 2, 4, &byte, &len);
+  size_t from = check_start(L, 3, buf->size, (lua_Integer)buf->size + 1);
+
+  // A match starting at `from` ends at from + len.
+  size_t hay_len = from + len < buf->size ? from + len : buf->size;
+  const uint8_t* p = buffer_rfind(buf->buffer, hay_len, needle, len);
+
+  if (p)
+    lua_pushinteger(L, (lua_Integer)(p - buf->buffer) + 1);
+  else
+    lua_pushnil(L);
+  return 1;
+}
+
+// Upvalues: 1 = buffer, 2 = separator string, 3 = next offset (0-based,
+// false once the last piece was returned).
+static int split_next(lua_State* L) {
+  if (!lua_toboolean(L, lua_upvalueindex(3))) return 0;
+
+  Buffer* buf = lua_touserdata(L, lua_upvalueindex(1));
+  size_t sep_len;
+  const uint8_t* sep =
+      (const uint8_t*)lua_tolstring(L, lua_upvalueindex(2), &sep_len);
+  size_t pos = (size_t)lua_tointeger(L, lua_upvalueindex(3));
+
+  // The buffer can't shrink, but be defensive about a stale offset.
+  if (pos > buf->size) pos = buf->size;
+
+  const uint8_t* hit =
+      buffer_find(buf->buffer + pos, buf->size - pos, sep, sep_len);
+  size_t len = hit ? (size_t)(hit - (buf->buffer + pos)) : buf->size - pos;
+
+  buffer_view(L, lua_upvalueindex(1), pos, len);
+
+  if (hit)
+    lua_pushinteger(L, (lua_Integer)(pos + len + sep_len));
+  else
+    lua_pushboolean(L, false);
+  lua_replace(L, lua_upvalueindex(3));
+
+  return 1;
+}
+
+// buf:split(sep, [encoding]) -> iterator over views between separators
+// `for part in buf:split("\r\n") do ... end`; "a,,b," yields "a", "", "b", "".
+int l_buffer_split(lua_State* L) {
+  luaL_checkudata(L, 1, BUFFER_MT);
+  uint8_t byte;
+  size_t len;
+  const uint8_t* sep = check_needle(L, 2, 3, &byte, &len);
+  luaL_argcheck(L, len > 0, 2, "separator must not be empty");
+
+  lua_pushvalue(L, 1);
+  lua_pushlstring(L, (const char*)sep, len);
+  lua_pushinteger(L, 0);
+  lua_pushcclosure(L, split_next, 3);
+  return 1;
+}
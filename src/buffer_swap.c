@@ -0,0 +1,127 @@
+#include "buffer_swap.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer.h"
+#include "simd.h"
+#include "utils.h"
+
+static void swap_scalar(uint8_t* p, size_t len, size_t width) {
+  for (size_t i = 0; i < len; i += width) reverse_bytes(p + i, width);
+}
+
+#if BUFFER_X86
+
+// pshufb control reversing each element within a 16-byte lane.
+static const uint8_t SWAP_SHUFFLE[3][16] = {
+    {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+    {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+    {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8},
+};
+
+__attribute__((target("avx2"))) static void swap_avx2(uint8_t* p, size_t len,
+                                                      size_t width) {
+  int which = width == 2 ? 0 : width == 4 ? 1 : 2;
+  __m256i ctrl = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)SWAP_SHUFFLE[which]));
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(p + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(p + i + 32));
+    _mm256_storeu_si256((__m256i*)(p + i), _mm256_shuffle_epi8(a, ctrl));
+    _mm256_storeu_si256((__m256i*)(p + i + 32), _mm256_shuffle_epi8(b, ctrl));
+  }
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(p + i));
+    _mm256_storeu_si256((__m256i*)(p + i), _mm256_shuffle_epi8(a, ctrl));
+  }
+
+  swap_scalar(p + i, len - i, width);
+}
+
+__attribute__((target("ssse3"))) static void swap_ssse3(uint8_t* p,
+                                                        size_t len,
+                                                        size_t width) {
+  int which = width == 2 ? 0 : width == 4 ? 1 : 2;
+  __m128i ctrl = _mm_loadu_si128((const __m128i*)SWAP_SHUFFLE[which]);
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(p + i));
+    _mm_storeu_si128((__m128i*)(p + i), _mm_shuffle_epi8(a, ctrl));
+  }
+
+  swap_scalar(p + i, len - i, width);
+}
+
+#elif BUFFER_NEON
+
+static void swap_neon(uint8_t* p, size_t len, size_t width) {
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8(p + i);
+    v = width == 2 ? vrev16q_u8(v) : width == 4 ? vrev32q_u8(v) : vrev64q_u8(v);
+    vst1q_u8(p + i, v);
+  }
+
+  swap_scalar(p + i, len - i, width);
+}
+
+#endif
+
+typedef void (*swap_fn)(uint8_t*, size_t, size_t);
+
+static swap_fn swap_impl;
+
+static void swap_select(void) {
+#if BUFFER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    swap_impl = swap_avx2;
+    return;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    swap_impl = swap_ssse3;
+    return;
+  }
+#elif BUFFER_NEON
+  swap_impl = swap_neon;
+  return;
+#endif
+  swap_impl = swap_scalar;
+}
+
+void buffer_swap(uint8_t* p, size_t len, size_t width) {
+  if (!swap_impl) swap_select();
+  swap_impl(p, len, width);
+}
+
+// buf:swapN([start], [end]) -> buf
+static int swap_range(lua_State* L, size_t width) {
+  Buffer* buf = luaL_checkudata(L, 1, BUFFER_MT);
+  lua_Integer start = luaL_optinteger(L, 2, 1);
+  lua_Integer end = luaL_optinteger(L, 3, (lua_Integer)buf->size);
+
+  size_t offset;
+  size_t len = resolve_range(buf->size, start, end, &offset);
+
+  if (len % width)
+    return luaL_error(L, "Buffer size must be a multiple of %d-bits",
+                      (int)(width * 8));
+
+  buffer_swap(buf->buffer + offset, len, width);
+
+  lua_settop(L, 1);
+  return 1;
+}
+
+int l_buffer_swap16(lua_State* L) { return swap_range(L, 2); }
+int l_buffer_swap32(lua_State* L) { return swap_range(L, 4); }
+int l_buffer_swap64(lua_State* L) { return swap_range(L, 8); }
@@ -0,0 +1,650 @@
+#include "buffer_utf.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "simd.h"
+
+#define ASCII_MASK 0x8080808080808080ULL
+#define UTF_REPLACEMENT 0xFFFD
+
+static inline bool ascii_word(const uint8_t* p) {
+  uint64_t w;
+  memcpy(&w, p, 8);
+  return (w & ASCII_MASK) == 0;
+}
+
+// Decodes one code point at `p`. Returns its length in bytes, or 0 when the
+// sequence is malformed or runs past `avail`.
+static inline size_t utf8_next(const uint8_t* p, size_t avail, uint32_t* cp) {
+  uint8_t c = p[0];
+
+  if (c < 0x80) {
+    *cp = c;
+    return 1;
+  }
+  if (c < 0xC2) return 0;
+
+  if (c < 0xE0) {
+    if (avail < 2 || (p[1] & 0xC0) != 0x80) return 0;
+    *cp = ((uint32_t)(c & 0x1F) << 6) | (p[1] & 0x3F);
+    return 2;
+  }
+
+  if (c < 0xF0) {
+    // E0 must not be overlong, ED must not encode a surrogate
+    uint8_t lo = c == 0xE0 ? 0xA0 : 0x80;
+    uint8_t hi = c == 0xED ? 0x9F : 0xBF;
+    if (avail < 3 || p[1] < lo || p[1] > hi || (p[2] & 0xC0) != 0x80)
+      return 0;
+    *cp = ((uint32_t)(c & 0x0F) << 12) | ((uint32_t)(p[1] & 0x3F) << 6) |
+          (p[2] & 0x3F);
+    return 3;
+  }
+
+  if (c < 0xF5) {
+    // F0 must not be overlong, F4 must stay below U+110000
+    uint8_t lo = c == 0xF0 ? 0x90 : 0x80;
+    uint8_t hi = c == 0xF4 ? 0x8F : 0xBF;
+    if (avail < 4 || p[1] < lo || p[1] > hi || (p[2] & 0xC0) != 0x80 ||
+        (p[3] & 0xC0) != 0x80)
+      return 0;
+    *cp = ((uint32_t)(c & 0x07) << 18) | ((uint32_t)(p[1] & 0x3F) << 12) |
+          ((uint32_t)(p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+    return 4;
+  }
+
+  return 0;
+}
+
+static inline size_t utf8_put(char* out, uint32_t cp) {
+  if (cp < 0x80) {
+    out[0] = (char)cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    out[0] = (char)(0xC0 | (cp >> 6));
+    out[1] = (char)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | (cp >> 18));
+  out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+  out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+  out[3] = (char)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+static inline size_t utf16_put(uint8_t* out, uint32_t cp) {
+  if (cp < 0x10000) {
+    out[0] = (uint8_t)cp;
+    out[1] = (uint8_t)(cp >> 8);
+    return 2;
+  }
+  cp -= 0x10000;
+  uint32_t hi = 0xD800 | (cp >> 10), lo = 0xDC00 | (cp & 0x3FF);
+  out[0] = (uint8_t)hi;
+  out[1] = (uint8_t)(hi >> 8);
+  out[2] = (uint8_t)lo;
+  out[3] = (uint8_t)(lo >> 8);
+  return 4;
+}
+
+static inline uint32_t utf16_unit(const uint8_t* data, size_t i) {
+  return (uint32_t)data[2 * i] | ((uint32_t)data[2 * i + 1] << 8);
+}
+
+// Transcodes the character starting at code unit `i` of `units`, appending
+// to out + *o. Returns the code units consumed.
+static inline size_t utf16_char(char* out, size_t* o, const uint8_t* data,
+                                size_t i, size_t units) {
+  uint32_t cp = utf16_unit(data, i);
+  size_t used = 1;
+
+  if (cp >= 0xD800 && cp < 0xE000) {
+    uint32_t lo = i + 1 < units ? utf16_unit(data, i + 1) : 0;
+    if (cp < 0xDC00 && lo >= 0xDC00 && lo < 0xE000) {
+      cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+      used = 2;
+    } else {
+      cp = UTF_REPLACEMENT;
+    }
+  }
+
+  *o += utf8_put(out + *o, cp);
+  return used;
+}
+
+// Scalar kernels, also used for the tails of the SIMD ones. ASCII runs are
+// skipped a word at a time.
+
+static bool utf8_valid_scalar(const uint8_t* p, size_t len) {
+  size_t i = 0;
+  uint32_t cp;
+
+  while (i < len) {
+    if (i + 8 <= len && ascii_word(p + i)) {
+      i += 8;
+      continue;
+    }
+    size_t n = utf8_next(p + i, len - i, &cp);
+    if (!n) return false;
+    i += n;
+  }
+
+  return true;
+}
+
+static size_t latin1_to_utf8_scalar(char* out, const uint8_t* data,
+                                    size_t len) {
+  size_t i = 0, o = 0;
+
+  while (i < len) {
+    if (i + 8 <= len && ascii_word(data + i)) {
+      memcpy(out + o, data + i, 8);
+      i += 8;
+      o += 8;
+      continue;
+    }
+    o += utf8_put(out + o, data[i++]);
+  }
+
+  return o;
+}
+
+static size_t utf16le_to_utf8_scalar(char* out, const uint8_t* data,
+                                     size_t len) {
+  size_t units = len / 2, i = 0, o = 0;
+  while (i < units) i += utf16_char(out, &o, data, i, units);
+  return o;
+}
+
+static void ascii_to_utf8_scalar(char* out, const uint8_t* data, size_t len) {
+  size_t i = 0;
+
+  for (; i + 8 <= len; i += 8) {
+    uint64_t w;
+    memcpy(&w, data + i, 8);
+    w &= ~ASCII_MASK;
+    memcpy(out + i, &w, 8);
+  }
+
+  for (; i < len; i++) out[i] = (char)(data[i] & 0x7F);
+}
+
+static bool utf8_to_latin1_scalar(uint8_t* out, size_t* out_len,
+                                  const uint8_t* p, size_t len) {
+  size_t i = 0, o = 0;
+  uint32_t cp;
+
+  while (i < len) {
+    if (i + 8 <= len && ascii_word(p + i)) {
+      memcpy(out + o, p + i, 8);
+      i += 8;
+      o += 8;
+      continue;
+    }
+    size_t n = utf8_next(p + i, len - i, &cp);
+    if (!n) return false;
+    out[o++] = (uint8_t)cp;
+    i += n;
+  }
+
+  *out_len = o;
+  return true;
+}
+
+static bool utf8_to_utf16le_scalar(uint8_t* out, size_t* out_len,
+                                   const uint8_t* p, size_t len) {
+  size_t i = 0, o = 0;
+  uint32_t cp;
+
+  while (i < len) {
+    if (i + 8 <= len && ascii_word(p + i)) {
+      for (size_t k = 0; k < 8; k++) {
+        out[o + 2 * k] = p[i + k];
+        out[o + 2 * k + 1] = 0;
+      }
+      i += 8;
+      o += 16;
+      continue;
+    }
+    size_t n = utf8_next(p + i, len - i, &cp);
+    if (!n) return false;
+    o += utf16_put(out + o, cp);
+    i += n;
+  }
+
+  *out_len = o;
+  return true;
+}
+
+#if BUFFER_X86 || BUFFER_NEON
+
+// Lookup-table UTF-8 validation (Keiser & Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte"). Each byte is classified by the high nibble
+// of its predecessor, the low nibble of its predecessor and its own high
+// nibble; a bit survives the AND of the three lookups only for an invalid
+// pair. Three- and four-byte sequences are finished by checking that the
+// bytes two and three after a lead are continuations.
+#define UTF8_TOO_SHORT (1 << 0)
+#define UTF8_TOO_LONG (1 << 1)
+#define UTF8_OVERLONG_3 (1 << 2)
+#define UTF8_TOO_LARGE (1 << 3)
+#define UTF8_SURROGATE (1 << 4)
+#define UTF8_OVERLONG_2 (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6)
+#define UTF8_TWO_CONTS (1 << 7)
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+static const uint8_t UTF8_BYTE_1_HIGH[16] = {
+    // 0xxx: ASCII followed by anything but a continuation
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    // 10xx: continuation
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    // 1100, 1101: two-byte lead
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2, UTF8_TOO_SHORT,
+    // 1110: three-byte lead
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    // 1111: four-byte lead
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+};
+
+static const uint8_t UTF8_BYTE_1_LOW[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+};
+
+static const uint8_t UTF8_BYTE_2_HIGH[16] = {
+    // 0xxx: ASCII after a lead
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    // 1000
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+        UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    // 1001
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+        UTF8_TOO_LARGE,
+    // 101x
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+        UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+        UTF8_TOO_LARGE,
+    // 11xx: lead after a lead
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+};
+
+// Largest values the last three bytes of a block may take without leaving a
+// sequence open; anything above is a lead that needs the next block.
+static const uint8_t UTF8_INCOMPLETE_MAX[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF,
+};
+
+#endif
+
+#if BUFFER_X86
+
+__attribute__((target("avx2"))) static inline __m256i utf8_errors_avx2(
+    __m256i in, __m256i prev) {
+  __m256i t1h = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)UTF8_BYTE_1_HIGH));
+  __m256i t1l = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)UTF8_BYTE_1_LOW));
+  __m256i t2h = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)UTF8_BYTE_2_HIGH));
+  __m256i nibble = _mm256_set1_epi8(0x0F);
+
+  // bytes 1, 2 and 3 positions back, reaching into the previous block
+  __m256i carried = _mm256_permute2x128_si256(prev, in, 0x21);
+  __m256i prev1 = _mm256_alignr_epi8(in, carried, 15);
+  __m256i prev2 = _mm256_alignr_epi8(in, carried, 14);
+  __m256i prev3 = _mm256_alignr_epi8(in, carried, 13);
+
+  __m256i b1h = _mm256_shuffle_epi8(
+      t1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+  __m256i b1l = _mm256_shuffle_epi8(t1l, _mm256_and_si256(prev1, nibble));
+  __m256i b2h = _mm256_shuffle_epi8(
+      t2h, _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble));
+  __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+  __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+  __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80));
+  __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                    _mm256_set1_epi8((char)0x80));
+
+  return _mm256_xor_si256(must23, special);
+}
+
+__attribute__((target("avx2"))) static bool utf8_valid_avx2(const uint8_t* p,
+                                                           size_t len) {
+  __m256i max = _mm256_loadu_si256((const __m256i*)UTF8_INCOMPLETE_MAX);
+  __m256i error = _mm256_setzero_si256();
+  __m256i prev = _mm256_setzero_si256();
+  __m256i incomplete = _mm256_setzero_si256();
+  uint8_t tail[32];
+  size_t i = 0;
+
+  // the final partial block is zero-padded, which also flags a sequence
+  // left open at the very end
+  for (;;) {
+    bool last = i + 32 > len;
+    __m256i in;
+
+    if (last) {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, p + i, len - i);
+      in = _mm256_loadu_si256((const __m256i*)tail);
+    } else {
+      in = _mm256_loadu_si256((const __m256i*)(p + i));
+    }
+
+    if (_mm256_movemask_epi8(in) == 0) {
+      error = _mm256_or_si256(error, incomplete);
+      incomplete = _mm256_setzero_si256();
+    } else {
+      error = _mm256_or_si256(error, utf8_errors_avx2(in, prev));
+      incomplete = _mm256_subs_epu8(in, max);
+    }
+    prev = in;
+
+    if (last) break;
+    i += 32;
+  }
+
+  error = _mm256_or_si256(error, incomplete);
+  return _mm256_testz_si256(error, error);
+}
+
+__attribute__((target("avx2"))) static size_t latin1_to_utf8_avx2(
+    char* out, const uint8_t* data, size_t len) {
+  size_t i = 0, o = 0;
+
+  while (i + 32 <= len) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+    if (_mm256_movemask_epi8(v) == 0) {
+      _mm256_storeu_si256((__m256i*)(out + o), v);
+      i += 32;
+      o += 32;
+      continue;
+    }
+    for (size_t end = i + 32; i < end; i++) o += utf8_put(out + o, data[i]);
+  }
+
+  return o + latin1_to_utf8_scalar(out + o, data + i, len - i);
+}
+
+__attribute__((target("avx2"))) static size_t utf16le_to_utf8_avx2(
+    char* out, const uint8_t* data, size_t len) {
+  size_t units = len / 2, i = 0, o = 0;
+  __m256i high = _mm256_set1_epi16((short)0xFF80);
+
+  while (i + 16 <= units) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(data + 2 * i));
+    if (_mm256_testz_si256(v, high)) {
+      // 16 ASCII units: narrow to bytes and restore lane order
+      __m256i packed =
+          _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0xD8);
+      _mm_storeu_si128((__m128i*)(out + o), _mm256_castsi256_si128(packed));
+      i += 16;
+      o += 16;
+      continue;
+    }
+    for (size_t end = i + 16; i < end;)
+      i += utf16_char(out, &o, data, i, units);
+  }
+
+  while (i < units) i += utf16_char(out, &o, data, i, units);
+  return o;
+}
+
+__attribute__((target("avx2"))) static void ascii_to_utf8_avx2(
+    char* out, const uint8_t* data, size_t len) {
+  __m256i low7 = _mm256_set1_epi8(0x7F);
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_and_si256(v, low7));
+  }
+
+  ascii_to_utf8_scalar(out + i, data + i, len - i);
+}
+
+__attribute__((target("avx2"))) static bool utf8_to_latin1_avx2(
+    uint8_t* out, size_t* out_len, const uint8_t* p, size_t len) {
+  size_t i = 0, o = 0;
+  uint32_t cp;
+
+  while (i + 32 <= len) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+    if (_mm256_movemask_epi8(v) == 0) {
+      _mm256_storeu_si256((__m256i*)(out + o), v);
+      i += 32;
+      o += 32;
+      continue;
+    }
+    for (size_t end = i + 32; i < end;) {
+      size_t n = utf8_next(p + i, len - i, &cp);
+      if (!n) return false;
+      out[o++] = (uint8_t)cp;
+      i += n;
+    }
+  }
+
+  size_t tail_len;
+  if (!utf8_to_latin1_scalar(out + o, &tail_len, p + i, len - i)) return false;
+  *out_len = o + tail_len;
+  return true;
+}
+
+__attribute__((target("avx2"))) static bool utf8_to_utf16le_avx2(
+    uint8_t* out, size_t* out_len, const uint8_t* p, size_t len) {
+  size_t i = 0, o = 0;
+  uint32_t cp;
+
+  while (i + 32 <= len) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+    if (_mm256_movemask_epi8(v) == 0) {
+      // 32 ASCII bytes widen to 32 code units
+      __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+      __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+      _mm256_storeu_si256((__m256i*)(out + o), lo);
+      _mm256_storeu_si256((__m256i*)(out + o + 32), hi);
+      i += 32;
+      o += 64;
+      continue;
+    }
+    for (size_t end = i + 32; i < end;) {
+      size_t n = utf8_next(p + i, len - i, &cp);
+      if (!n) return false;
+      o += utf16_put(out + o, cp);
+      i += n;
+    }
+  }
+
+  size_t tail_len;
+  if (!utf8_to_utf16le_scalar(out + o, &tail_len, p + i, len - i))
+    return false;
+  *out_len = o + tail_len;
+  return true;
+}
+
+#elif BUFFER_NEON
+
+static inline uint8x16_t utf8_errors_neon(uint8x16_t in, uint8x16_t prev) {
+  uint8x16_t nibble = vdupq_n_u8(0x0F);
+  uint8x16_t prev1 = vextq_u8(prev, in, 15);
+  uint8x16_t prev2 = vextq_u8(prev, in, 14);
+  uint8x16_t prev3 = vextq_u8(prev, in, 13);
+
+  uint8x16_t b1h = vqtbl1q_u8(vld1q_u8(UTF8_BYTE_1_HIGH), vshrq_n_u8(prev1, 4));
+  uint8x16_t b1l =
+      vqtbl1q_u8(vld1q_u8(UTF8_BYTE_1_LOW), vandq_u8(prev1, nibble));
+  uint8x16_t b2h = vqtbl1q_u8(vld1q_u8(UTF8_BYTE_2_HIGH), vshrq_n_u8(in, 4));
+  uint8x16_t special = vandq_u8(vandq_u8(b1h, b1l), b2h);
+
+  uint8x16_t third = vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80));
+  uint8x16_t fourth = vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80));
+  uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+
+  return veorq_u8(must23, special);
+}
+
+static bool utf8_valid_neon(const uint8_t* p, size_t len) {
+  uint8x16_t max = vld1q_u8(UTF8_INCOMPLETE_MAX + 16);
+  uint8x16_t error = vdupq_n_u8(0);
+  uint8x16_t prev = vdupq_n_u8(0);
+  uint8x16_t incomplete = vdupq_n_u8(0);
+  uint8_t tail[16];
+  size_t i = 0;
+
+  for (;;) {
+    bool last = i + 16 > len;
+    uint8x16_t in;
+
+    if (last) {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, p + i, len - i);
+      in = vld1q_u8(tail);
+    } else {
+      in = vld1q_u8(p + i);
+    }
+
+    if (vmaxvq_u8(in) < 0x80) {
+      error = vorrq_u8(error, incomplete);
+      incomplete = vdupq_n_u8(0);
+    } else {
+      error = vorrq_u8(error, utf8_errors_neon(in, prev));
+      incomplete = vqsubq_u8(in, max);
+    }
+    prev = in;
+
+    if (last) break;
+    i += 16;
+  }
+
+  return vmaxvq_u8(vorrq_u8(error, incomplete)) == 0;
+}
+
+static void ascii_to_utf8_neon(char* out, const uint8_t* data, size_t len) {
+  uint8x16_t low7 = vdupq_n_u8(0x7F);
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16)
+    vst1q_u8((uint8_t*)out + i, vandq_u8(vld1q_u8(data + i), low7));
+
+  ascii_to_utf8_scalar(out + i, data + i, len - i);
+}
+
+#endif
+
+typedef bool (*utf8_decode_fn)(uint8_t*, size_t*, const uint8_t*, size_t);
+typedef size_t (*utf8_encode_fn)(char*, const uint8_t*, size_t);
+
+static bool (*utf8_valid_impl)(const uint8_t*, size_t);
+static utf8_encode_fn latin1_to_utf8_impl;
+static utf8_encode_fn utf16le_to_utf8_impl;
+static void (*ascii_to_utf8_impl)(char*, const uint8_t*, size_t);
+static utf8_decode_fn utf8_to_latin1_impl;
+static utf8_decode_fn utf8_to_utf16le_impl;
+
+static void utf_select(void) {
+  utf8_valid_impl = utf8_valid_scalar;
+  latin1_to_utf8_impl = latin1_to_utf8_scalar;
+  utf16le_to_utf8_impl = utf16le_to_utf8_scalar;
+  ascii_to_utf8_impl = ascii_to_utf8_scalar;
+  utf8_to_latin1_impl = utf8_to_latin1_scalar;
+  utf8_to_utf16le_impl = utf8_to_utf16le_scalar;
+
+#if BUFFER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    utf8_valid_impl = utf8_valid_avx2;
+    latin1_to_utf8_impl = latin1_to_utf8_avx2;
+    utf16le_to_utf8_impl = utf16le_to_utf8_avx2;
+    ascii_to_utf8_impl = ascii_to_utf8_avx2;
+    utf8_to_latin1_impl = utf8_to_latin1_avx2;
+    utf8_to_utf16le_impl = utf8_to_utf16le_avx2;
+  }
+#elif BUFFER_NEON
+  utf8_valid_impl = utf8_valid_neon;
+  ascii_to_utf8_impl = ascii_to_utf8_neon;
+#endif
+}
+
+bool buffer_utf8_valid(const uint8_t* p, size_t len) {
+  if (!utf8_valid_impl) utf_select();
+  return utf8_valid_impl(p, len);
+}
+
+size_t buffer_latin1_to_utf8(char* out, const uint8_t* data, size_t len) {
+  if (!latin1_to_utf8_impl) utf_select();
+  return latin1_to_utf8_impl(out, data, len);
+}
+
+size_t buffer_utf16le_to_utf8(char* out, const uint8_t* data, size_t len) {
+  if (!utf16le_to_utf8_impl) utf_select();
+  return utf16le_to_utf8_impl(out, data, len);
+}
+
+void buffer_ascii_to_utf8(char* out, const uint8_t* data, size_t len) {
+  if (!ascii_to_utf8_impl) utf_select();
+  ascii_to_utf8_impl(out, data, len);
+}
+
+bool buffer_utf8_to_latin1(uint8_t* out, size_t* out_len, const char* data,
+                           size_t len) {
+  if (!utf8_to_latin1_impl) utf_select();
+  return utf8_to_latin1_impl(out, out_len, (const uint8_t*)data, len);
+}
+
+bool buffer_utf8_to_utf16le(uint8_t* out, size_t* out_len, const char* data,
+                            size_t len) {
+  if (!utf8_to_utf16le_impl) utf_select();
+  return utf8_to_utf16le_impl(out, out_len, (const uint8_t*)data, len);
+}
+
+// buffer.isUtf8(input) -> boolean, for a Buffer or a string
+int l_buffer_is_utf8(lua_State* L) {
+  Buffer* buf = luaL_testudata(L, 1, BUFFER_MT);
+  const uint8_t* p;
+  size_t len;
+
+  if (buf) {
+    p = buf->buffer;
+    len = buf->size;
+  } else {
+    p = (const uint8_t*)luaL_checklstring(L, 1, &len);
+  }
+
+  lua_pushboolean(L, buffer_utf8_valid(p, len));
+  return 1;
+}
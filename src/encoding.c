@@ -0,0 +1,200 @@
+#include "encoding.h"
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "base64lib.h"
+#include "buffer.h"
+#include "buffer_utf.h"
+#include "errors.h"
+#include "hexlib.h"
+
+static size_t same_len(size_t len) { return len; }
+
+static size_t utf8_encode(char* out, const uint8_t* data, size_t len) {
+  memcpy(out, data, len);
+  return len;
+}
+
+static bool utf8_decode(uint8_t* out, size_t* out_len, const char* data,
+                        size_t len) {
+  memcpy(out, data, len);
+  *out_len = len;
+  return true;
+}
+
+static size_t hex_encoded_len(size_t len) { return 2 * len; }
+static size_t hex_decoded_maxlen(size_t len) { return len / 2; }
+
+static size_t hex_encode_codec(char* out, const uint8_t* data, size_t len) {
+  hex_encode_to(out, data, len);
+  return 2 * len;
+}
+
+static bool hex_decode_codec(uint8_t* out, size_t* out_len, const char* data,
+                             size_t len) {
+  *out_len = len / 2;
+  return hex_decode_to(out, data, len);
+}
+
+static size_t base64_std_len(size_t len) {
+  return base64_encoded_len(len, false);
+}
+
+static size_t base64_url_len(size_t len) {
+  return base64_encoded_len(len, true);
+}
+
+static size_t base64_std_encode(char* out, const uint8_t* data, size_t len) {
+  base64_encode_to(out, data, len, false);
+  return base64_encoded_len(len, false);
+}
+
+static size_t base64_url_encode(char* out, const uint8_t* data, size_t len) {
+  base64_encode_to(out, data, len, true);
+  return base64_encoded_len(len, true);
+}
+
+// Every code unit becomes at most 3 UTF-8 bytes, every UTF-8 byte at most one
+// code unit.
+static size_t utf16le_encoded_len(size_t len) { return 3 * (len / 2); }
+static size_t utf16le_decoded_maxlen(size_t len) { return 2 * len; }
+
+static size_t latin1_encoded_len(size_t len) { return 2 * len; }
+
+static size_t ascii_encode(char* out, const uint8_t* data, size_t len) {
+  buffer_ascii_to_utf8(out, data, len);
+  return len;
+}
+
+const Codec CODECS[ENCODING_COUNT] = {
+    [ENCODING_ID_UTF8] = {ENCODING_UTF8, "UTF8", NULL, true, same_len,
+                          utf8_encode, same_len, utf8_decode},
+    [ENCODING_ID_HEX] = {ENCODING_BASE16, "HEX", ERR_INVALID_HEX_STRING, false,
+                         hex_encoded_len, hex_encode_codec, hex_decoded_maxlen,
+                         hex_decode_codec},
+    [ENCODING_ID_BASE64] = {ENCODING_BASE64, "BASE64",
+                            ERR_INVALID_BASE64_STRING, false, base64_std_len,
+                            base64_std_encode, base64_decoded_maxlen,
+                            base64_decode_to},
+    [ENCODING_ID_BASE64URL] = {ENCODING_BASE64URL, "BASE64URL",
+                               ERR_INVALID_BASE64_STRING, false,
+                               base64_url_len, base64_url_encode,
+                               base64_decoded_maxlen, base64_decode_to},
+    [ENCODING_ID_UTF16LE] = {ENCODING_UTF16LE, "UTF16LE",
+                             ERR_INVALID_UTF8_STRING, false,
+                             utf16le_encoded_len, buffer_utf16le_to_utf8,
+                             utf16le_decoded_maxlen, buffer_utf8_to_utf16le},
+    // latin1 and ascii read Lua strings as UTF-8 text, one code point per
+    // byte; binary keeps them byte for byte
+    [ENCODING_ID_LATIN1] = {ENCODING_LATIN1, "LATIN1", ERR_INVALID_UTF8_STRING,
+                            false, latin1_encoded_len, buffer_latin1_to_utf8,
+                            same_len, buffer_utf8_to_latin1},
+    // decodes like latin1, as Node does
+    [ENCODING_ID_ASCII] = {ENCODING_ASCII, "ASCII", ERR_INVALID_UTF8_STRING,
+                           false, same_len, ascii_encode, same_len,
+                           buffer_utf8_to_latin1},
+    [ENCODING_ID_BINARY] = {ENCODING_BINARY, "BINARY", NULL, true, same_len,
+                            utf8_encode, same_len, utf8_decode},
+};
+
+// Alternative spellings, resolved like the codec names.
+static const struct {
+  const char* name;
+  EncodingId id;
+} ALIASES[] = {
+    {"utf-16le", ENCODING_ID_UTF16LE},
+    {"ucs2", ENCODING_ID_UTF16LE},
+    {"ucs-2", ENCODING_ID_UTF16LE},
+};
+
+#define ALIAS_COUNT (sizeof(ALIASES) / sizeof(ALIASES[0]))
+
+// name -> EncodingId for the spellings seen in practice; anything else falls
+// back to a case-insensitive scan in check_encoding().
+void encoding_push_lookup(lua_State* L) {
+  lua_createtable(L, 0, 2 * ENCODING_COUNT + (int)ALIAS_COUNT);
+
+  for (int id = 0; id < ENCODING_COUNT; id++) {
+    lua_pushinteger(L, id);
+    lua_setfield(L, -2, CODECS[id].name);
+    lua_pushinteger(L, id);
+    lua_setfield(L, -2, CODECS[id].constant);
+  }
+
+  for (size_t i = 0; i < ALIAS_COUNT; i++) {
+    lua_pushinteger(L, ALIASES[i].id);
+    lua_setfield(L, -2, ALIASES[i].name);
+  }
+}
+
+void encoding_set_constants(lua_State* L, int idx) {
+  idx = lua_absindex(L, idx);
+
+  for (int id = 0; id < ENCODING_COUNT; id++) {
+    lua_pushinteger(L, id);
+    lua_setfield(L, idx, CODECS[id].constant);
+  }
+}
+
+const Codec* check_encoding(lua_State* L, int arg) {
+  switch (lua_type(L, arg)) {
+    case LUA_TNONE:
+    case LUA_TNIL:
+      return &CODECS[ENCODING_ID_UTF8];
+
+    case LUA_TNUMBER: {
+      lua_Integer id = luaL_checkinteger(L, arg);
+      luaL_argcheck(L, id >= 0 && id < ENCODING_COUNT, arg,
+                    "unknown encoding constant");
+      return &CODECS[id];
+    }
+
+    default: {
+      const char* name = luaL_checkstring(L, arg);
+
+      lua_pushvalue(L, arg);
+      if (lua_rawget(L, lua_upvalueindex(1)) == LUA_TNUMBER) {
+        lua_Integer id = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        return &CODECS[id];
+      }
+      lua_pop(L, 1);
+
+      for (int id = 0; id < ENCODING_COUNT; id++)
+        if (strcasecmp(name, CODECS[id].name) == 0) return &CODECS[id];
+      for (size_t i = 0; i < ALIAS_COUNT; i++)
+        if (strcasecmp(name, ALIASES[i].name) == 0)
+          return &CODECS[ALIASES[i].id];
+
+      luaL_error(L, ERR_UNSUPPORTED_ENCODING, name);
+      return NULL;
+    }
+  }
+}
+
+const uint8_t* codec_decode_alloc(lua_State* L, const Codec* codec,
+                                  const char* data, size_t len,
+                                  size_t* out_len) {
+  if (codec->identity) {
+    *out_len = len;
+    return (const uint8_t*)data;
+  }
+
+  size_t max_len = codec->decoded_maxlen(len);
+  uint8_t* decoded = malloc(max_len ? max_len : 1);
+  if (!decoded) throw_luaoom(L, max_len);
+
+  if (!codec->decode(decoded, out_len, data, len)) {
+    free(decoded);
+    luaL_error(L, "%s", codec->invalid);
+  }
+
+  return decoded;
+}
@@ -1,12 +1,23 @@
 #include "utils.h"
 
+#include <lua.h>
 #include <stddef.h>
 #include <stdint.h>
 
-void reverse_bytes(uint8_t* b, size_t n) {
-  for (size_t i = 0; i < n / 2; ++i) {
-    uint8_t tmp = b[i];
-    b[i] = b[n - 1 - i];
-    b[n - 1 - i] = tmp;
-  }
-}
\ No newline at end of file
+// Turns a 1-based inclusive [start, end] pair (negative values count from the
+// end, -1 being the last byte) into a 0-based offset and a length, clamped to
+// the buffer. Returns 0 for an empty range.
+size_t resolve_range(size_t size, lua_Integer start, lua_Integer end,
+                     size_t* offset) {
+  if (start < 0) start = (lua_Integer)size + start + 1;
+  if (end < 0) end = (lua_Integer)size + end + 1;
+
+  if (start < 1) start = 1;
+  if (end > (lua_Integer)size) end = (lua_Integer)size;
+
+  *offset = 0;
+  if (end < start) return 0;
+
+  *offset = (size_t)(start - 1);
+  return (size_t)(end - start + 1);
+}
@@ -12,3 +12,452 @@ function Buffer:readUInt32LE(offset) end
 ---@param offset integer?
 ---@return integer
 function Buffer:writeUInt32LE(value, offset) end
+
+---Reads an unsigned integer of 1..8 bytes (e.g. 3 or 6 for 24/48-bit).
+---`readIntLE`/`readIntBE`/`readUIntBE` work the same way.
+---@param offset integer?
+---@param byteLength integer
+---@return integer
+---@nodiscard
+function Buffer:readUIntLE(offset, byteLength) end
+
+---@param value integer
+---@param offset integer?
+---@param byteLength integer
+---@return integer nextOffset
+function Buffer:writeUIntLE(value, offset, byteLength) end
+
+---64-bit accessors return plain Lua integers; UInt64 values above
+---math.maxinteger wrap to negative numbers.
+---@param offset integer?
+---@return integer
+---@nodiscard
+function Buffer:readBigUInt64LE(offset) end
+
+---Fills `self[start..finish]` with repeats of `value`; an empty pattern
+---zero-fills. Returns `self`.
+---@param value integer | string | Buffer
+---@param start integer?
+---@param finish integer?
+---@param encoding Encoding?
+---@return Buffer
+function Buffer:fill(value, start, finish, encoding) end
+
+---@param value string
+---@param encoding Encoding
+---@return Buffer
+function Buffer:fill(value, encoding) end
+
+---Copies `self[sourceStart..sourceEnd]` into `target` at `targetStart`,
+---truncated to the room left in `target`. Ranges may overlap.
+---@param target Buffer
+---@param targetStart integer?
+---@param sourceStart integer?
+---@param sourceEnd integer?
+---@return integer copied
+function Buffer:copy(target, targetStart, sourceStart, sourceEnd) end
+
+---Moves `self[start..finish]` to position `target`. Returns `self`.
+---@param target integer
+---@param start integer?
+---@param finish integer?
+---@return Buffer
+function Buffer:copyWithin(target, start, finish) end
+
+---Orders `self[sStart..sEnd]` against `target[tStart..tEnd]`. Also returns the
+---index of the first differing byte within the range, or nil when equal.
+---@param target Buffer | string
+---@param tStart integer?
+---@param tEnd integer?
+---@param sStart integer?
+---@param sEnd integer?
+---@return -1 | 0 | 1 order
+---@return integer? index
+---@nodiscard
+function Buffer:compare(target, tStart, tEnd, sStart, sEnd) end
+
+---Whether `self[sStart..sEnd]` equals `other[tStart..tEnd]`.
+---@param other Buffer | string
+---@param tStart integer?
+---@param tEnd integer?
+---@param sStart integer?
+---@param sEnd integer?
+---@return boolean
+---@nodiscard
+function Buffer:equals(other, tStart, tEnd, sStart, sEnd) end
+
+---CRC-32 (zlib/PNG) of `self[start..finish]`. Pass a previous result as
+---`seed` to continue across chunks.
+---@param start integer?
+---@param finish integer?
+---@param seed integer?
+---@return integer
+---@nodiscard
+function Buffer:crc32(start, finish, seed) end
+
+---CRC-32C (Castagnoli) of `self[start..finish]`, seedable like crc32.
+---@param start integer?
+---@param finish integer?
+---@param seed integer?
+---@return integer
+---@nodiscard
+function Buffer:crc32c(start, finish, seed) end
+
+---Adler-32 of `self[start..finish]`. The seed defaults to 1.
+---@param start integer?
+---@param finish integer?
+---@param seed integer?
+---@return integer
+---@nodiscard
+function Buffer:adler32(start, finish, seed) end
+
+---Reverses the byte order of every 16-bit element of `self[start..finish]`
+---in place. The range length must be a multiple of 2.
+---@param start integer?
+---@param finish integer?
+---@return Buffer
+function Buffer:swap16(start, finish) end
+
+---Reverses the byte order of every 32-bit element of `self[start..finish]`
+---in place. The range length must be a multiple of 4.
+---@param start integer?
+---@param finish integer?
+---@return Buffer
+function Buffer:swap32(start, finish) end
+
+---Reverses the byte order of every 64-bit element of `self[start..finish]`
+---in place. The range length must be a multiple of 8.
+---@param start integer?
+---@param finish integer?
+---@return Buffer
+function Buffer:swap64(start, finish) end
+
+---XORs `self[start..finish]` with `operand`, a byte or bytes repeated from the
+---start of the range. Writes in place, or into `target` when given.
+---@param operand integer | string | Buffer
+---@param start integer?
+---@param finish integer?
+---@param target Buffer?
+---@return Buffer
+function Buffer:xor(operand, start, finish, target) end
+
+---ANDs `self[start..finish]` with `operand`, a byte or bytes repeated from the
+---start of the range. Writes in place, or into `target` when given.
+---@param operand integer | string | Buffer
+---@param start integer?
+---@param finish integer?
+---@param target Buffer?
+---@return Buffer
+function Buffer:band(operand, start, finish, target) end
+
+---ORs `self[start..finish]` with `operand`, a byte or bytes repeated from the
+---start of the range. Writes in place, or into `target` when given.
+---@param operand integer | string | Buffer
+---@param start integer?
+---@param finish integer?
+---@param target Buffer?
+---@return Buffer
+function Buffer:bor(operand, start, finish, target) end
+
+---Inverts every bit of `self[start..finish]`, in place or into `target`.
+---@param start integer?
+---@param finish integer?
+---@param target Buffer?
+---@return Buffer
+function Buffer:bnot(start, finish, target) end
+
+---Number of set bits in `self[start..finish]`.
+---@param start integer?
+---@param finish integer?
+---@return integer
+---@nodiscard
+function Buffer:popcount(start, finish) end
+
+---XXH3 64-bit hash of `self[start..finish]`, stable across platforms. Values
+---above math.maxinteger wrap to negative numbers.
+---@param seed integer?
+---@param start integer?
+---@param finish integer?
+---@return integer
+---@nodiscard
+function Buffer:hash64(seed, start, finish) end
+
+---XXH3 128-bit hash of `self[start..finish]` as two 64-bit halves.
+---@param seed integer?
+---@param start integer?
+---@param finish integer?
+---@return integer low
+---@return integer high
+---@nodiscard
+function Buffer:hash128(seed, start, finish) end
+
+---Index of the first occurrence of `value` at or after `start`, or nil.
+---Integers search for a single byte.
+---@param value integer | string | Buffer
+---@param start integer?
+---@param encoding Encoding?
+---@return integer?
+---@nodiscard
+function Buffer:indexOf(value, start, encoding) end
+
+---Index of the last occurrence of `value` starting at or before `start`.
+---@param value integer | string | Buffer
+---@param start integer?
+---@param encoding Encoding?
+---@return integer?
+---@nodiscard
+function Buffer:lastIndexOf(value, start, encoding) end
+
+---@param value integer | string | Buffer
+---@param start integer?
+---@param encoding Encoding?
+---@return boolean
+---@nodiscard
+function Buffer:includes(value, start, encoding) end
+
+---Iterates over views of the pieces between separators.
+---@param sep integer | string | Buffer
+---@param encoding Encoding?
+---@return fun(): Buffer?
+function Buffer:split(sep, encoding) end
+
+---Cursor reading consecutive fields starting at `offset`.
+---@param offset integer?
+---@return BufferReader
+---@nodiscard
+function Buffer:reader(offset) end
+
+---Cursor writing consecutive fields starting at `offset`.
+---@param offset integer?
+---@return BufferWriter
+---@nodiscard
+function Buffer:writer(offset) end
+
+---Writes buf[start..end] to a file handle or descriptor without copying it
+---into a Lua string first. `position` writes at a 0-based file offset.
+---@param target file* | integer
+---@param start integer?
+---@param finish integer?
+---@param position integer?
+---@return integer? written
+---@return string? err
+function Buffer:writeTo(target, start, finish, position) end
+
+---Reads up to `length` bytes into the buffer at `offset`; 0 at end of file.
+---@param source file* | integer
+---@param offset integer?
+---@param length integer?
+---@param position integer?
+---@return integer? read
+---@return string? err
+function Buffer:readFrom(source, offset, length, position) end
+
+---Queues a read into buf[offset .. offset + length - 1] on `engine`. The
+---buffer stays alive until the request is returned by `engine:poll()`.
+---
+---Without a `position` the thread backend claims the next `length` bytes
+---from the file position when the request is queued, so requests on one file
+---cover consecutive ranges in submission order; a read cut short by EOF still
+---advances the position by `length`. Unseekable files need a single-thread
+---engine. io_uring uses the file position when the request runs instead, and
+---leaves requests queued together on one file unordered.
+---@param engine BufferEngine
+---@param source file* | integer
+---@param position integer? 0-based file offset (default: current position)
+---@param offset integer?
+---@param length integer?
+---@return integer id
+function Buffer:readAsync(engine, source, position, offset, length) end
+
+---Queues a write of buf[start..finish] on `engine`. Without a `position`
+---it appends at the file position, as in `Buffer:readAsync`.
+---@param engine BufferEngine
+---@param target file* | integer
+---@param position integer? 0-based file offset (default: current position)
+---@param start integer?
+---@param finish integer?
+---@return integer id
+function Buffer:writeAsync(engine, target, position, start, finish) end
+
+---Flushes a memory-mapped buffer (or view of one) to its file.
+---@param async boolean?
+---@return true? ok
+---@return string? err
+function Buffer:sync(async) end
+
+---Passes an access pattern hint for a memory-mapped buffer to the kernel.
+---@param hint "normal" | "sequential" | "random" | "willneed" | "dontneed"
+---@return true? ok
+---@return string? err
+function Buffer:advise(hint) end
+
+---Returns a view sharing memory with this buffer (1-based, inclusive range).
+---@param start integer?
+---@param finish integer?
+---@return Buffer
+---@nodiscard
+function Buffer:slice(start, finish) end
+
+---Alias of `Buffer:slice`.
+---@param start integer?
+---@param finish integer?
+---@return Buffer
+---@nodiscard
+function Buffer:subarray(start, finish) end
+
+---Reads `count` consecutive Int16LE values (default: as many as fit).
+---The same `read<Type>Array`/`write<Type>Array` pair exists for every
+---fixed-width accessor.
+---@param offset integer?
+---@param count integer?
+---@return number[]
+---@nodiscard
+function Buffer:readInt16LEArray(offset, count) end
+
+---Writes `values[first..last]` as consecutive Int16LE values.
+---@param values number[]
+---@param offset integer?
+---@param first integer?
+---@param last integer?
+---@return integer nextOffset
+function Buffer:writeInt16LEArray(values, offset, first, last) end
+
+---Reads an unsigned LEB128 varint (at most 10 bytes).
+---`readVarInt` reads a zigzag-encoded signed varint.
+---@param offset integer?
+---@return integer value
+---@return integer nextOffset
+---@nodiscard
+function Buffer:readVarUInt(offset) end
+
+---`writeVarInt` writes a zigzag-encoded signed varint.
+---@param value integer
+---@param offset integer?
+---@return integer nextOffset
+function Buffer:writeVarUInt(value, offset) end
+
+---Decodes `count` consecutive varints (default: to the end of the buffer).
+---`readVarIntArray` is the zigzag-decoding variant.
+---@param offset integer?
+---@param count integer?
+---@return integer[]
+---@return integer nextOffset
+---@nodiscard
+function Buffer:readVarUIntArray(offset, count) end
+
+---Reads advance an internal position. Besides the methods below there is one
+---accessor per fixed-width type: u8, i8, u16le, u16be, i16le, i16be, u32le,
+---u32be, i32le, i32be, u64le, u64be, i64le, i64be, f32le, f32be, f64le, f64be.
+---@class BufferReader
+local BufferReader = {}
+
+---@return integer
+function BufferReader:u32le() end
+
+---@param n integer
+---@return string
+function BufferReader:bytes(n) end
+
+---@param n integer
+---@return BufferReader
+function BufferReader:skip(n) end
+
+---@param offset integer
+---@return BufferReader
+function BufferReader:seek(offset) end
+
+---@return integer
+function BufferReader:remaining() end
+
+---1-based offset of the next byte.
+---@return integer
+function BufferReader:tell() end
+
+---Writers have the same per-type methods as readers, taking the value and
+---returning the writer so calls can be chained.
+---@class BufferWriter
+local BufferWriter = {}
+
+---@param value integer
+---@return BufferWriter
+function BufferWriter:u32le(value) end
+
+---@param data string | Buffer
+---@return BufferWriter
+function BufferWriter:bytes(data) end
+
+---@param n integer
+---@return BufferWriter
+function BufferWriter:skip(n) end
+
+---@return integer
+function BufferWriter:remaining() end
+
+---@return integer
+function BufferWriter:tell() end
+
+---Appends a string or Buffer, or a number encoded with one of the typed
+---writer formats ("u8", "i32be", "f64le", ...).
+---@param value string | Buffer | number
+---@param format string?
+---@return BufferWriter
+function BufferWriter:append(value, format) end
+
+---Makes room for `n` more bytes up front.
+---@param n integer
+---@return BufferWriter
+function BufferWriter:reserve(n) end
+
+---Turns everything written so far into a Buffer without copying and resets
+---the writer. Only for writers created with `buffer.writer`.
+---@return Buffer
+function BufferWriter:finish() end
+
+---@class BufferCompletion
+---@field id integer
+---@field bytes integer? Bytes transferred
+---@field error string?
+---@field errno integer?
+
+---@class BufferEngine
+local BufferEngine = {}
+
+---Completed requests since the last call; never blocks.
+---@return BufferCompletion[]
+function BufferEngine:poll() end
+
+---Like poll(), but blocks until at least one request has finished.
+---@return BufferCompletion[]
+function BufferEngine:wait() end
+
+---@return integer
+function BufferEngine:pending() end
+
+---@return "io_uring" | "threads"
+function BufferEngine:backend() end
+
+---Waits for outstanding requests and stops the engine.
+function BufferEngine:close() end
+
+---Streaming XXH3 state; see `buffer.hasher`.
+---@class BufferHasher
+local BufferHasher = {}
+
+---@param data Buffer | string
+---@return BufferHasher
+function BufferHasher:update(data) end
+
+---Same value as `hash64` over everything passed to update(). Does not reset.
+---@return integer
+---@nodiscard
+function BufferHasher:digest() end
+
+---@return integer low
+---@return integer high
+---@nodiscard
+function BufferHasher:digest128() end
+
+---Starts over, keeping the current seed unless a new one is given.
+---@param seed integer?
+---@return BufferHasher
+function BufferHasher:reset(seed) end
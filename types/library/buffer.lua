@@ -1,8 +1,16 @@
 ---@meta
 
----@alias Encoding "utf8" | "UTF8" | "hex" | "HEX" | "base64" | "BASE64"
+---@alias Encoding integer | "utf8" | "UTF8" | "hex" | "HEX" | "base64" | "BASE64" | "base64url" | "BASE64URL" | "utf16le" | "UTF16LE" | "ucs2" | "latin1" | "LATIN1" | "ascii" | "ASCII" | "binary" | "BINARY"
 
 ---@class buffer
+---@field UTF8 integer
+---@field HEX integer
+---@field BASE64 integer
+---@field BASE64URL integer
+---@field UTF16LE integer
+---@field LATIN1 integer Lua strings are UTF-8 text, one code point per byte
+---@field ASCII integer decodes like LATIN1
+---@field BINARY integer raw bytes, kept byte for byte
 local buffer = {}
 
 ---@param size integer
@@ -25,4 +33,138 @@ function buffer.alloc(size, fill) end
 ---@return Buffer
 function buffer.alloc(size, fill, encoding) end
 
+---@class BufferPoolStats
+---@field limit integer Max bytes kept on the freelists (0 = pool disabled)
+---@field cached integer Bytes currently parked on the freelists
+---@field hits integer Allocations served from a recycled block
+---@field misses integer Allocations that needed a fresh block
+---@field classes table<integer, integer> Parked blocks per size class
+
+---@return BufferPoolStats
+function buffer.poolStats() end
+
+---Frees every parked block.
+---@return integer freed
+function buffer.poolTrim() end
+
+---Gets or sets how many bytes the pool may keep around (0 disables it).
+---@param limit integer?
+---@return integer previous
+function buffer.poolLimit(limit) end
+
+---Bytes of buffer payloads allocated outside of Lua objects.
+---@return integer
+function buffer.externalMemory() end
+
+---Creates a writer whose storage doubles whenever a write doesn't fit.
+---@param capacity integer?
+---@return BufferWriter
+---@nodiscard
+function buffer.writer(capacity) end
+
+---Same as `buffer.writer`, for assembling messages with `append`.
+---@param capacity integer?
+---@return BufferWriter
+---@nodiscard
+function buffer.builder(capacity) end
+
+---Joins Buffers and strings with one allocation, truncated or zero-padded
+---to `totalLength` when given.
+---@param list (Buffer | string)[]
+---@param totalLength integer?
+---@return Buffer
+---@nodiscard
+function buffer.concat(list, totalLength) end
+
+---Orders `a` against `b` bytewise (-1, 0 or 1). Also returns the index of the
+---first differing byte, or nil when equal.
+---@param a Buffer | string
+---@param b Buffer | string
+---@return -1 | 0 | 1 order
+---@return integer? index
+---@nodiscard
+function buffer.compare(a, b) end
+
+---Constant-time equality for MACs and tokens. Errors if the lengths differ.
+---@param a Buffer | string
+---@param b Buffer | string
+---@return boolean
+---@nodiscard
+function buffer.timingSafeEqual(a, b) end
+
+---True when `input` is well-formed UTF-8.
+---@param input Buffer | string
+---@return boolean
+---@nodiscard
+function buffer.isUtf8(input) end
+
+---Streaming XXH3 hasher for payloads that arrive in chunks.
+---@param seed integer?
+---@return BufferHasher
+function buffer.hasher(seed) end
+
+---Maps `length` bytes of a file starting at the 0-based `offset`. "r" maps
+---copy-on-write, "rw" writes through to the file.
+---@param path string
+---@param mode ("r" | "rw")?
+---@param offset integer?
+---@param length integer?
+---@return Buffer? buf
+---@return string? err
+---@return integer? errno
+function buffer.mmap(path, mode, offset, length) end
+
+---Writes a list of Buffers and strings with as few syscalls as possible.
+---@param target file* | integer
+---@param list (Buffer | string)[]
+---@param position integer?
+---@return integer? written
+---@return string? err
+function buffer.writev(target, list, position) end
+
+---Fills a list of Buffers in order, stopping early at end of file.
+---@param source file* | integer
+---@param list Buffer[]
+---@param position integer?
+---@return integer? read
+---@return string? err
+function buffer.readv(source, list, position) end
+
+---Creates an async I/O engine: io_uring when built with `make URING=1`,
+---otherwise a pool of `threads` workers.
+---@param threads integer?
+---@return BufferEngine
+function buffer.engine(threads) end
+
+---Compiles a record layout (`<`/`>`/`=` endianness, `bBhHiIlLjJ`, `f`/`d`, `cN`, `xN`).
+---@param format string
+---@return BufferLayout
+---@nodiscard
+function buffer.compile(format) end
+
+---@class BufferLayout
+---@operator len: integer
+local BufferLayout = {}
+
+---Decodes one record; returns its values followed by the next offset.
+---@param buf Buffer
+---@param offset integer?
+---@return any ...
+function BufferLayout:unpack(buf, offset) end
+
+---Encodes one record; returns the next offset.
+---@param buf Buffer
+---@param offset integer
+---@param ... any
+---@return integer
+function BufferLayout:pack(buf, offset, ...) end
+
+---Decodes `n` consecutive records into one table per field.
+---@param buf Buffer
+---@param offset integer?
+---@param n integer
+---@return any[][] columns
+---@return integer next
+function BufferLayout:unpackMany(buf, offset, n) end
+
 return buffer